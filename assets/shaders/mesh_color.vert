@@ -0,0 +1,47 @@
+#version 430
+layout (location = 0) in vec3 vPos;
+layout (location = 1) in vec2 vTcoord;
+layout (location = 2) in vec3 vNorm;
+
+out vec3 color;
+#if defined(COLOR_TEXTURE) || defined(COLOR_ATLAS)
+out vec2 tcoord;
+#endif
+#if defined(LIGHTING) || defined(SHADOWS)
+out vec3 view_position;
+out vec3 view_normal;
+#endif
+
+uniform mat4 u_mvp;
+#if defined(COLOR_ATLAS)
+uniform vec4 u_uv_rect;     // (u0, v0, u1, v1) of this draw's image within its atlas page
+#endif
+#if defined(LIGHTING) || defined(SHADOWS)
+uniform mat4 u_mv;
+uniform mat3 u_normal;      // Inverse transpose of u_mv
+#endif
+
+// COLOR_*, LIGHTING & SHADOWS defines are injected by the variant key (see ShaderFeature in Shader.h)
+void main()
+{
+    vec4 pos = vec4(vPos, 1.0);
+#if defined(COLOR_POSITION)
+    color = pos.xyz;
+#elif defined(COLOR_TCOORD)
+    color = vec3(vTcoord, 0.0);
+#elif defined(COLOR_NORMAL)
+    color = vNorm;
+#else
+    color = vec3(1.0);
+#endif
+#if defined(COLOR_TEXTURE)
+    tcoord = vTcoord;
+#elif defined(COLOR_ATLAS)
+    tcoord = mix(u_uv_rect.xy, u_uv_rect.zw, vTcoord);
+#endif
+#if defined(LIGHTING) || defined(SHADOWS)
+    view_position = (u_mv * pos).xyz;
+    view_normal = u_normal * vNorm;
+#endif
+    gl_Position = u_mvp * pos;
+}
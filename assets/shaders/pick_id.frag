@@ -0,0 +1,12 @@
+#version 430
+
+uniform int u_object;       // Pickable + 1; the target clears to 0, nothing there
+uniform int u_generation;   // Tells a reused handle's new pickable from the one this pick rendered
+
+layout (location = 0) out uvec4 FragId;
+
+void main()
+{
+    // Counts the draw's triangles from 0, so it's the mesh triangle (index / 3)
+    FragId = uvec4(uint(u_object), uint(gl_PrimitiveID), uint(u_generation), 0u);
+}
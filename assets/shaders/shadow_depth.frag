@@ -0,0 +1,6 @@
+#version 430
+
+// Depth only; the atlas framebuffers have no colour attachments
+void main()
+{
+}
@@ -0,0 +1,34 @@
+#version 430
+in vec2 tcoord;
+out vec4 fragColor;
+
+uniform sampler2D u_tex;
+uniform vec2 u_texel;       // 1 / render target size
+uniform vec2 u_uv_max;      // Last texel centre of the rendered region
+uniform float u_sharpness;  // 0 = plain bilinear
+
+// Taps are clamped to the rendered region so filtering never reads the unused part of the target
+vec3 Tap(vec2 uv)
+{
+    return texture(u_tex, clamp(uv, 0.5 * u_texel, u_uv_max)).rgb;
+}
+
+void main()
+{
+    vec3 c = Tap(tcoord);
+    if (u_sharpness <= 0.0)
+    {
+        fragColor = vec4(c, 1.0);
+        return;
+    }
+
+    // Unsharp mask over the 4 neighbours, clamped to their range so edges don't ring
+    vec3 n = Tap(tcoord + vec2(0.0, u_texel.y));
+    vec3 s = Tap(tcoord - vec2(0.0, u_texel.y));
+    vec3 e = Tap(tcoord + vec2(u_texel.x, 0.0));
+    vec3 w = Tap(tcoord - vec2(u_texel.x, 0.0));
+    vec3 lo = min(c, min(min(n, s), min(e, w)));
+    vec3 hi = max(c, max(max(n, s), max(e, w)));
+    vec3 sharp = c + u_sharpness * (4.0 * c - n - s - e - w) * 0.25;
+    fragColor = vec4(clamp(sharp, lo, hi), 1.0);
+}
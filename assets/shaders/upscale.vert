@@ -0,0 +1,12 @@
+#version 430
+out vec2 tcoord;
+
+uniform vec2 u_uv_scale;    // Rendered region / render target size
+
+void main()
+{
+    // One triangle covering the screen: (-1,-1), (3,-1), (-1,3); no vertex buffer needed
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    tcoord = position * u_uv_scale;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -1,8 +1,141 @@
 #version 430
 in vec3 color;
+#if defined(COLOR_TEXTURE)
+in vec2 tcoord;
+uniform sampler2D u_tex;
+#elif defined(COLOR_ATLAS)
+in vec2 tcoord;
+uniform sampler2DArray u_atlas;
+uniform int u_layer;
+#endif
 out vec4 fragColor;
 
+#if defined(LIGHTING) || defined(SHADOWS)
+in vec3 view_position;
+in vec3 view_normal;
+#endif
+
+#if defined(LIGHTING)
+// Written each frame by UpdateClusteredLighting (Lighting.cpp), everything in view space
+struct PointLight
+{
+    vec4 position_radius;
+    vec4 color;
+};
+
+layout(std430, binding = 0) readonly buffer Lights
+{
+    PointLight lights[];
+};
+
+layout(std430, binding = 1) readonly buffer Clusters
+{
+    uvec4 cluster_dims;     // Tiles x, tiles y, slices, light count
+    vec4 cluster_params;    // Tiles per pixel x & y; slice = log(depth) * z + w
+    vec4 ambient;
+    uvec2 clusters[];       // Offset & count into light_indices
+};
+
+layout(std430, binding = 2) readonly buffer LightIndices
+{
+    uint light_indices[];
+};
+
+// Only the lights binned into this fragment's cluster
+vec3 ClusteredLight(vec3 position, vec3 normal)
+{
+    uvec3 cluster;
+    cluster.xy = min(uvec2(gl_FragCoord.xy * cluster_params.xy), cluster_dims.xy - 1u);
+    cluster.z = uint(clamp(log(-position.z) * cluster_params.z + cluster_params.w, 0.0, float(cluster_dims.z - 1u)));
+    uvec2 range = clusters[(cluster.z * cluster_dims.y + cluster.y) * cluster_dims.x + cluster.x];
+
+    vec3 n = normalize(normal);
+    vec3 result = ambient.rgb;
+    for (uint i = 0u; i < range.y; i++)
+    {
+        PointLight light = lights[light_indices[range.x + i]];
+        vec3 to_light = light.position_radius.xyz - position;
+        float distance2 = max(dot(to_light, to_light), 1e-6);
+        float radius2 = light.position_radius.w * light.position_radius.w;
+
+        // Windowed inverse square: reaches exactly zero at the radius, so binning by radius is lossless
+        float window = clamp(1.0 - distance2 / radius2, 0.0, 1.0);
+        float attenuation = window * window / (distance2 + 1.0);
+        float lambert = max(dot(n, to_light * inversesqrt(distance2)), 0.0);
+        result += light.color.rgb * (lambert * attenuation);
+    }
+    return result;
+}
+#endif
+
+#if defined(SHADOWS)
+// Written each frame by UpdateShadowMaps (Shadows.cpp)
+layout(std430, binding = 3) readonly buffer Shadows
+{
+    mat4 shadow_cascades[4];    // View space to atlas uv & depth
+    vec4 shadow_splits;         // Far view depth of each cascade
+    vec4 shadow_texels;         // World size of a texel in each cascade
+    vec4 sun_direction;         // View space, towards the light
+    vec4 sun_color;
+    vec4 shadow_params;         // Cascade count, atlas texel size
+};
+
+layout(binding = 1) uniform sampler2DShadow u_shadow_atlas;
+
+float SunShadow(vec3 position, vec3 n)
+{
+    int count = int(shadow_params.x);
+    float depth = -position.z;
+    if (depth > shadow_splits[count - 1])
+        return 1.0;
+
+    int cascade = 0;
+    while (cascade < count - 1 && depth > shadow_splits[cascade])
+        cascade++;
+
+    // Pushed out along the normal by about a texel, so surfaces don't shadow themselves
+    vec3 coord = (shadow_cascades[cascade] * vec4(position + n * shadow_texels[cascade] * 1.5, 1.0)).xyz;
+
+    // 4 bilinear comparisons, kept inside the cascade's tile of the atlas
+    float texel = shadow_params.y;
+    vec2 tile = vec2(cascade & 1, cascade >> 1) * 0.5;
+    vec2 uv_min = tile + texel;
+    vec2 uv_max = tile + 0.5 - texel;
+    float lit = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+        vec2 offset = (vec2(i & 1, i >> 1) - 0.5) * texel;
+        lit += texture(u_shadow_atlas, vec3(clamp(coord.xy + offset, uv_min, uv_max), coord.z));
+    }
+    return lit * 0.25;
+}
+
+vec3 SunLight(vec3 position, vec3 normal)
+{
+    vec3 n = normalize(normal);
+    float lambert = dot(n, sun_direction.xyz);
+    return lambert > 0.0 ? sun_color.rgb * (lambert * SunShadow(position, n)) : vec3(0.0);
+}
+#endif
+
 void main()
 {
-    fragColor = vec4(color, 1.0);
+#if defined(COLOR_TEXTURE)
+    vec4 base = texture(u_tex, tcoord);
+#elif defined(COLOR_ATLAS)
+    vec4 base = texture(u_atlas, vec3(tcoord, u_layer));
+#else
+    vec4 base = vec4(color, 1.0);
+#endif
+#if defined(LIGHTING) || defined(SHADOWS)
+    vec3 light = vec3(0.0);
+#if defined(LIGHTING)
+    light += ClusteredLight(view_position, view_normal);
+#endif
+#if defined(SHADOWS)
+    light += SunLight(view_position, view_normal);
+#endif
+    base.rgb *= light;
+#endif
+    fragColor = base;
 }
@@ -0,0 +1,464 @@
+#include "Allocations.h"
+#include <imgui/imgui.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_MSC_VER)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <dbghelp.h>
+#include <intrin.h>
+#include <malloc.h>
+#include <crtdbg.h>
+#pragma comment(lib, "dbghelp.lib")
+#define CALLER_ADDRESS() _ReturnAddress()
+#else
+#include <dlfcn.h>
+#include <malloc.h>
+#define CALLER_ADDRESS() __builtin_return_address(0)
+#endif
+
+// Open-addressed by address; sites past the table's capacity are counted under the nullptr site.
+// Nothing here may allocate, since it runs inside operator new.
+constexpr int SITE_TABLE_SIZE = 4096;
+constexpr int SITE_NAME_CACHE = 64;
+
+struct SiteCounters
+{
+    std::atomic<uintptr_t> address;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> frame_count;
+    std::atomic<uint64_t> frame_bytes;
+};
+
+struct SiteName
+{
+    const void* address;
+    char name[128];
+};
+
+static SiteCounters f_sites[SITE_TABLE_SIZE];
+static SiteCounters f_unknown_site;
+
+static std::atomic<uint64_t> f_allocations{ 0 };
+static std::atomic<uint64_t> f_bytes{ 0 };
+static std::atomic<uint64_t> f_frame_allocations{ 0 };
+static std::atomic<uint64_t> f_frame_bytes{ 0 };
+static std::atomic<uint64_t> f_frame_frees{ 0 };
+static std::atomic<int64_t> f_live_allocations{ 0 };
+static std::atomic<int64_t> f_live_bytes{ 0 };
+
+static AllocationStats f_stats;
+static bool f_zero_frames = false;
+static int f_warmup_frames = 0;
+
+static SiteName f_names[SITE_NAME_CACHE];
+static int f_name_count = 0;
+
+#ifdef ALLOCATION_TRACKING
+
+static SiteCounters* FindSite(const void* address)
+{
+    uintptr_t key = reinterpret_cast<uintptr_t>(address);
+    if (key == 0)
+        return &f_unknown_site;
+
+    // Fibonacci hash; return addresses are at least byte-distinct, so keep the high bits of the product
+    uint32_t slot = (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 52);
+    for (int probe = 0; probe < SITE_TABLE_SIZE; probe++)
+    {
+        SiteCounters& site = f_sites[(slot + probe) & (SITE_TABLE_SIZE - 1)];
+        uintptr_t current = site.address.load(std::memory_order_acquire);
+        if (current == key)
+            return &site;
+        if (current == 0)
+        {
+            uintptr_t empty = 0;
+            if (site.address.compare_exchange_strong(empty, key, std::memory_order_acq_rel) || empty == key)
+                return &site;
+        }
+    }
+    return &f_unknown_site;
+}
+
+static void RecordAllocation(const void* caller, size_t bytes, size_t usable)
+{
+    f_allocations.fetch_add(1, std::memory_order_relaxed);
+    f_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    f_frame_allocations.fetch_add(1, std::memory_order_relaxed);
+    f_frame_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    f_live_allocations.fetch_add(1, std::memory_order_relaxed);
+    f_live_bytes.fetch_add((int64_t)usable, std::memory_order_relaxed);
+
+    SiteCounters* site = FindSite(caller);
+    site->count.fetch_add(1, std::memory_order_relaxed);
+    site->bytes.fetch_add(bytes, std::memory_order_relaxed);
+    site->frame_count.fetch_add(1, std::memory_order_relaxed);
+    site->frame_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static void RecordFree(size_t usable)
+{
+    f_frame_frees.fetch_add(1, std::memory_order_relaxed);
+    f_live_allocations.fetch_sub(1, std::memory_order_relaxed);
+    f_live_bytes.fetch_sub((int64_t)usable, std::memory_order_relaxed);
+}
+
+// Set while the tracker itself calls into the heap, so the CRT hook doesn't count those allocations twice
+static thread_local bool t_inside_tracker = false;
+
+#if defined(_MSC_VER)
+static size_t UsableSize(void* memory) { return _msize(memory); }
+static size_t UsableSizeAligned(void* memory, size_t align) { return _aligned_msize(memory, align, 0); }
+static void* HeapAllocAligned(size_t bytes, size_t align) { return _aligned_malloc(bytes, align); }
+static void HeapFreeAligned(void* memory) { _aligned_free(memory); }
+#else
+static size_t UsableSize(void* memory) { return malloc_usable_size(memory); }
+static size_t UsableSizeAligned(void* memory, size_t) { return malloc_usable_size(memory); }
+static void* HeapAllocAligned(size_t bytes, size_t align)
+{
+    void* memory = nullptr;
+    return posix_memalign(&memory, std::max(align, sizeof(void*)), bytes) == 0 ? memory : nullptr;
+}
+static void HeapFreeAligned(void* memory) { free(memory); }
+#endif
+
+static void* TrackedAlloc(size_t bytes, size_t align, const void* caller)
+{
+    // operator new must return a unique pointer even for 0 bytes
+    size_t size = bytes > 0 ? bytes : 1;
+    t_inside_tracker = true;
+    void* memory = align > alignof(std::max_align_t) ? HeapAllocAligned(size, align) : malloc(size);
+    t_inside_tracker = false;
+    if (memory != nullptr)
+        RecordAllocation(caller, bytes, align > alignof(std::max_align_t) ? UsableSizeAligned(memory, align) : UsableSize(memory));
+    return memory;
+}
+
+static void TrackedFree(void* memory, size_t align)
+{
+    if (memory == nullptr)
+        return;
+    bool aligned = align > alignof(std::max_align_t);
+    RecordFree(aligned ? UsableSizeAligned(memory, align) : UsableSize(memory));
+    t_inside_tracker = true;
+    if (aligned)
+        HeapFreeAligned(memory);
+    else
+        free(memory);
+    t_inside_tracker = false;
+}
+
+static void* TrackedNew(size_t bytes, size_t align, const void* caller)
+{
+    void* memory = TrackedAlloc(bytes, align, caller);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t bytes) { return TrackedNew(bytes, 0, CALLER_ADDRESS()); }
+void* operator new[](size_t bytes) { return TrackedNew(bytes, 0, CALLER_ADDRESS()); }
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept { return TrackedAlloc(bytes, 0, CALLER_ADDRESS()); }
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept { return TrackedAlloc(bytes, 0, CALLER_ADDRESS()); }
+void* operator new(size_t bytes, std::align_val_t align) { return TrackedNew(bytes, (size_t)align, CALLER_ADDRESS()); }
+void* operator new[](size_t bytes, std::align_val_t align) { return TrackedNew(bytes, (size_t)align, CALLER_ADDRESS()); }
+void* operator new(size_t bytes, std::align_val_t align, const std::nothrow_t&) noexcept { return TrackedAlloc(bytes, (size_t)align, CALLER_ADDRESS()); }
+void* operator new[](size_t bytes, std::align_val_t align, const std::nothrow_t&) noexcept { return TrackedAlloc(bytes, (size_t)align, CALLER_ADDRESS()); }
+
+void operator delete(void* memory) noexcept { TrackedFree(memory, 0); }
+void operator delete[](void* memory) noexcept { TrackedFree(memory, 0); }
+void operator delete(void* memory, size_t) noexcept { TrackedFree(memory, 0); }
+void operator delete[](void* memory, size_t) noexcept { TrackedFree(memory, 0); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { TrackedFree(memory, 0); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { TrackedFree(memory, 0); }
+void operator delete(void* memory, std::align_val_t align) noexcept { TrackedFree(memory, (size_t)align); }
+void operator delete[](void* memory, std::align_val_t align) noexcept { TrackedFree(memory, (size_t)align); }
+void operator delete(void* memory, size_t, std::align_val_t align) noexcept { TrackedFree(memory, (size_t)align); }
+void operator delete[](void* memory, size_t, std::align_val_t align) noexcept { TrackedFree(memory, (size_t)align); }
+void operator delete(void* memory, std::align_val_t align, const std::nothrow_t&) noexcept { TrackedFree(memory, (size_t)align); }
+void operator delete[](void* memory, std::align_val_t align, const std::nothrow_t&) noexcept { TrackedFree(memory, (size_t)align); }
+
+// ImGui calls these through a single wrapper, so its allocations share one call site
+static void* ImGuiAlloc(size_t bytes, void*)
+{
+    return TrackedAlloc(bytes, 0, CALLER_ADDRESS());
+}
+
+static void ImGuiFree(void* memory, void*)
+{
+    TrackedFree(memory, 0);
+}
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+// Sees every CRT heap operation; the tracker's own (operator new, ImGui) are already counted
+static int CrtAllocHook(int type, void* data, size_t bytes, int block, long, const unsigned char*, int)
+{
+    if (t_inside_tracker || block == _CRT_BLOCK)
+        return TRUE;
+
+    switch (type)
+    {
+    case _HOOK_ALLOC:
+        RecordAllocation(nullptr, bytes, bytes);
+        break;
+    case _HOOK_REALLOC:
+        if (data != nullptr)
+            RecordFree(_msize_dbg(data, block));
+        RecordAllocation(nullptr, bytes, bytes);
+        break;
+    case _HOOK_FREE:
+        if (data != nullptr)
+            RecordFree(_msize_dbg(data, block));
+        break;
+    }
+    return TRUE;
+}
+#endif
+
+// Before main, so ImGui's context (made in CreateWindow) is allocated through the tracker too
+static const bool f_hooks_installed = []()
+{
+    ImGui::SetAllocatorFunctions(ImGuiAlloc, ImGuiFree);
+#if defined(_MSC_VER) && defined(_DEBUG)
+    _CrtSetAllocHook(CrtAllocHook);
+#endif
+    return true;
+}();
+
+#endif
+
+void BeginAllocationFrame()
+{
+    f_frame_allocations.store(0, std::memory_order_relaxed);
+    f_frame_bytes.store(0, std::memory_order_relaxed);
+    f_frame_frees.store(0, std::memory_order_relaxed);
+    f_unknown_site.frame_count.store(0, std::memory_order_relaxed);
+    f_unknown_site.frame_bytes.store(0, std::memory_order_relaxed);
+    for (SiteCounters& site : f_sites)
+    {
+        site.frame_count.store(0, std::memory_order_relaxed);
+        site.frame_bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+static void AddTopSite(AllocationStats* stats, const SiteCounters& site)
+{
+    uint64_t count = site.frame_count.load(std::memory_order_relaxed);
+    if (count == 0)
+        return;
+    stats->frame_sites++;
+
+    // Insertion into the short sorted list
+    AllocationSite entry;
+    entry.address = reinterpret_cast<const void*>(site.address.load(std::memory_order_relaxed));
+    entry.count = count;
+    entry.bytes = site.frame_bytes.load(std::memory_order_relaxed);
+    int listed = std::min(stats->frame_sites, ALLOCATION_TOP_SITES);
+    int i = listed - 1;
+    if (i == ALLOCATION_TOP_SITES - 1 && stats->frame_sites > ALLOCATION_TOP_SITES)
+    {
+        if (stats->top_sites[i].count >= count)
+            return;
+    }
+    while (i > 0 && stats->top_sites[i - 1].count < count)
+    {
+        stats->top_sites[i] = stats->top_sites[i - 1];
+        i--;
+    }
+    stats->top_sites[i] = entry;
+}
+
+bool EndAllocationFrame()
+{
+    AllocationStats& stats = f_stats;
+#ifdef ALLOCATION_TRACKING
+    stats.tracking = true;
+#endif
+    stats.frames++;
+    stats.frame_allocations = f_frame_allocations.load(std::memory_order_relaxed);
+    stats.frame_bytes = f_frame_bytes.load(std::memory_order_relaxed);
+    stats.frame_frees = f_frame_frees.load(std::memory_order_relaxed);
+    stats.total_allocations = f_allocations.load(std::memory_order_relaxed);
+    stats.total_bytes = f_bytes.load(std::memory_order_relaxed);
+    stats.live_allocations = f_live_allocations.load(std::memory_order_relaxed);
+    stats.live_bytes = f_live_bytes.load(std::memory_order_relaxed);
+
+    stats.frame_sites = 0;
+    std::fill(stats.top_sites, stats.top_sites + ALLOCATION_TOP_SITES, AllocationSite());
+    if (stats.frame_allocations > 0)
+    {
+        AddTopSite(&stats, f_unknown_site);
+        for (const SiteCounters& site : f_sites)
+            AddTopSite(&stats, site);
+    }
+
+    if (!f_zero_frames || stats.frames <= (uint64_t)f_warmup_frames || stats.frame_allocations == 0)
+        return true;
+
+    printf("Zero-allocation frame %llu allocated:\n", (unsigned long long)stats.frames);
+    PrintAllocationStats();
+    fflush(stdout);
+    assert(false && "Heap allocation during a warmed-up frame");
+    return false;
+}
+
+void SetZeroAllocationFrames(bool enabled, int warmup_frames)
+{
+    assert(warmup_frames >= 0);
+#ifndef ALLOCATION_TRACKING
+    if (enabled)
+        printf("Warning: zero-allocation frames need ALLOCATION_TRACKING, nothing will be checked\n");
+#endif
+    f_zero_frames = enabled;
+    f_warmup_frames = (int)std::min<uint64_t>(f_stats.frames + warmup_frames, INT32_MAX);
+}
+
+AllocationStats GetAllocationStats()
+{
+    return f_stats;
+}
+
+void PrintAllocationStats()
+{
+    const AllocationStats& stats = f_stats;
+    printf("Allocations: %llu (%.1fKB) & %llu frees in frame %llu, %lld live (%.1fKB), %llu total\n",
+        (unsigned long long)stats.frame_allocations, stats.frame_bytes / 1024.0, (unsigned long long)stats.frame_frees,
+        (unsigned long long)stats.frames, (long long)stats.live_allocations, stats.live_bytes / 1024.0,
+        (unsigned long long)stats.total_allocations);
+
+    int listed = std::min(stats.frame_sites, ALLOCATION_TOP_SITES);
+    for (int i = 0; i < listed; i++)
+    {
+        char name[128];
+        AllocationSiteName(stats.top_sites[i].address, name, sizeof(name));
+        printf("  %6llu x %8.1fKB  %s\n", (unsigned long long)stats.top_sites[i].count,
+            stats.top_sites[i].bytes / 1024.0, name);
+    }
+    if (stats.frame_sites > listed)
+        printf("  ... %i more sites\n", stats.frame_sites - listed);
+}
+
+static void ResolveSiteName(const void* address, char* name, size_t size)
+{
+#if defined(_MSC_VER)
+    static bool s_initialized = false;
+    static bool s_symbols = false;
+    HANDLE process = GetCurrentProcess();
+    if (!s_initialized)
+    {
+        SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES);
+        s_symbols = SymInitialize(process, nullptr, TRUE) == TRUE;
+        s_initialized = true;
+    }
+
+    alignas(SYMBOL_INFO) char buffer[sizeof(SYMBOL_INFO) + 256];
+    SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(buffer);
+    memset(buffer, 0, sizeof(buffer));
+    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+    symbol->MaxNameLen = 255;
+    DWORD64 displacement = 0;
+    if (s_symbols && SymFromAddr(process, (DWORD64)address, &displacement, symbol))
+    {
+        IMAGEHLP_LINE64 line = {};
+        line.SizeOfStruct = sizeof(line);
+        DWORD line_displacement = 0;
+        if (SymGetLineFromAddr64(process, (DWORD64)address, &line_displacement, &line))
+        {
+            const char* file = std::max(strrchr(line.FileName, '\\'), strrchr(line.FileName, '/'));
+            snprintf(name, size, "%s (%s:%lu)", symbol->Name, file != nullptr ? file + 1 : line.FileName, line.LineNumber);
+        }
+        else
+        {
+            snprintf(name, size, "%s+0x%llx", symbol->Name, (unsigned long long)displacement);
+        }
+        return;
+    }
+#else
+    // Only exported symbols resolve (link with -rdynamic)
+    Dl_info info;
+    if (dladdr(address, &info) != 0 && info.dli_sname != nullptr)
+    {
+        snprintf(name, size, "%s+0x%llx", info.dli_sname,
+            (unsigned long long)(static_cast<const char*>(address) - static_cast<const char*>(info.dli_saddr)));
+        return;
+    }
+#endif
+    snprintf(name, size, "%p", address);
+}
+
+void AllocationSiteName(const void* address, char* name, size_t size)
+{
+    if (address == nullptr)
+    {
+        snprintf(name, size, "(C runtime / untracked site)");
+        return;
+    }
+
+    for (int i = 0; i < f_name_count; i++)
+    {
+        if (f_names[i].address == address)
+        {
+            snprintf(name, size, "%s", f_names[i].name);
+            return;
+        }
+    }
+
+    // Once full, an entry picked by address makes way
+    SiteName& entry = f_names[f_name_count < SITE_NAME_CACHE ? f_name_count++ : (int)(reinterpret_cast<uintptr_t>(address) % SITE_NAME_CACHE)];
+    entry.address = address;
+    ResolveSiteName(address, entry.name, sizeof(entry.name));
+    snprintf(name, size, "%s", entry.name);
+}
+
+void DrawAllocationOverlay()
+{
+    const AllocationStats& stats = f_stats;
+    if (!stats.tracking)
+        return;
+
+    ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.75f);
+    if (ImGui::Begin("Allocations", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::Text("Frame %llu: %llu allocations (%.1f KB), %llu frees", (unsigned long long)stats.frames,
+            (unsigned long long)stats.frame_allocations, stats.frame_bytes / 1024.0, (unsigned long long)stats.frame_frees);
+        ImGui::Text("Live: %lld (%.1f MB)   Total: %llu (%.1f MB)", (long long)stats.live_allocations,
+            stats.live_bytes / (1024.0 * 1024.0), (unsigned long long)stats.total_allocations,
+            stats.total_bytes / (1024.0 * 1024.0));
+        if (f_zero_frames)
+            ImGui::Text("Zero-allocation frames enforced after frame %i", f_warmup_frames);
+
+        int listed = std::min(stats.frame_sites, ALLOCATION_TOP_SITES);
+        if (listed > 0 && ImGui::BeginTable("sites", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+        {
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("KB");
+            ImGui::TableSetupColumn("Site");
+            ImGui::TableHeadersRow();
+            for (int i = 0; i < listed; i++)
+            {
+                char name[128];
+                AllocationSiteName(stats.top_sites[i].address, name, sizeof(name));
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)stats.top_sites[i].count);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", stats.top_sites[i].bytes / 1024.0);
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(name);
+            }
+            ImGui::EndTable();
+        }
+        if (stats.frame_sites > listed)
+            ImGui::Text("... %i more sites", stats.frame_sites - listed);
+    }
+    ImGui::End();
+}
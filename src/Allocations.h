@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Opt-in heap instrumentation. Define ALLOCATION_TRACKING for the whole project to replace the global operator
+// new/delete, route ImGui's allocations through the tracker and, in MSVC debug builds, hook the CRT heap so plain
+// malloc/free are seen too (elsewhere only C++ allocations and ImGui's are). Without it the functions below still
+// work but see nothing, and the overlay isn't drawn.
+// Every allocation is attributed to its call site, the return address of the allocating call (for containers that's
+// usually the std allocator or an inlined member), and to the frame it happened in: the allocations between
+// BeginAllocationFrame & EndAllocationFrame on any thread. C runtime allocations have no call site of their own.
+
+constexpr int ALLOCATION_TOP_SITES = 8;
+
+struct AllocationSite
+{
+	const void* address = nullptr;		// nullptr: C runtime allocations, or sites that didn't fit the table
+	uint64_t count = 0;
+	uint64_t bytes = 0;
+};
+
+struct AllocationStats
+{
+	bool tracking = false;				// Built with ALLOCATION_TRACKING
+	uint64_t frames = 0;				// Ended so far
+	uint64_t frame_allocations = 0;		// During the last frame
+	uint64_t frame_bytes = 0;
+	uint64_t frame_frees = 0;
+	uint64_t total_allocations = 0;		// Since startup
+	uint64_t total_bytes = 0;
+	int64_t live_allocations = 0;
+	int64_t live_bytes = 0;				// Usable sizes, so a little over what was asked for
+	int frame_sites = 0;				// Call sites that allocated during the last frame, busiest first:
+	AllocationSite top_sites[ALLOCATION_TOP_SITES];
+};
+
+// Main thread, around everything a frame does (presenting & event polling can be left out: the driver allocates there)
+void BeginAllocationFrame();
+
+// Returns false when zero-allocation frames are enforced and this warmed-up frame allocated
+bool EndAllocationFrame();
+
+// Test mode: once warmup_frames have ended, every frame that allocates is reported with its call sites & asserts
+void SetZeroAllocationFrames(bool enabled, int warmup_frames = 60);
+
+AllocationStats GetAllocationStats();
+void PrintAllocationStats();
+
+// Function (+ offset) containing a call site, or its bare address when there are no symbols. Cached per address.
+void AllocationSiteName(const void* address, char* name, size_t size);
+
+// ImGui window with the last frame's counts & busiest sites; between BeginGui & EndGui
+void DrawAllocationOverlay();
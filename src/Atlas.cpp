@@ -0,0 +1,168 @@
+#include "Atlas.h"
+#include "Buffer.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#define STB_RECT_PACK_IMPLEMENTATION
+#define STBRP_STATIC
+#include <imgui/imstb_rectpack.h>
+
+static int AlignUp(int value, int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Copies image into its cell, extending edge texels out to the cell's border
+static void BlitPadded(const Image& image, Image* page, int cell_x, int cell_y, int cell_w, int cell_h, int padding)
+{
+    for (int y = 0; y < cell_h; y++)
+    {
+        int sy = std::min(std::max(y - padding, 0), image.height - 1);
+        const Color* src = image.pixels + (size_t)sy * image.width;
+        Color* dst = page->pixels + (size_t)(cell_y + y) * page->width + cell_x;
+        for (int x = 0; x < cell_w; x++)
+            dst[x] = src[std::min(std::max(x - padding, 0), image.width - 1)];
+    }
+}
+
+static void LoadAtlasTexture(Atlas* atlas)
+{
+    Texture* texture = &atlas->texture;
+    int levels = 1;
+    for (int p = atlas->padding; p > 1; p >>= 1)
+        levels++;
+
+    texture->target = GL_TEXTURE_2D_ARRAY;
+    texture->format = GL_RGBA8;
+    texture->width = atlas->page_size;
+    texture->height = atlas->page_size;
+    texture->levels = std::min(levels, MipmapCount(atlas->page_size, atlas->page_size));
+    texture->layers = (int)atlas->pages.size();
+
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture->id);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, texture->levels, texture->format, texture->width, texture->height, texture->layers);
+
+    std::vector<Image> mips;
+    for (int layer = 0; layer < texture->layers; layer++)
+    {
+        const Image& page = atlas->pages[layer];
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, page.width, page.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, page.pixels);
+
+        GenerateMipmaps(page, &mips);
+        for (int level = 1; level < texture->levels; level++)
+        {
+            const Image& mip = mips[level - 1];
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, mip.width, mip.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels);
+        }
+        UnloadMipmaps(&mips);
+    }
+
+    // Clamp so sampling near a page edge never wraps around to the opposite image
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, GL_NONE);
+}
+
+void BuildAtlas(Atlas* atlas, const Image* images, int count, int page_size, int padding)
+{
+    assert(padding > 0 && (padding & (padding - 1)) == 0);
+    assert(page_size % padding == 0);
+    atlas->page_size = page_size;
+    atlas->padding = padding;
+    atlas->rects.assign(count, AtlasRect{});
+
+    // Pack in units of padding so every cell starts on a padding-aligned texel
+    int grid = page_size / padding;
+    std::vector<stbrp_rect> pending;
+    pending.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        int w = AlignUp(images[i].width + 2 * padding, padding) / padding;
+        int h = AlignUp(images[i].height + 2 * padding, padding) / padding;
+        if (w > grid || h > grid)
+        {
+            printf("Warning: %ix%i image doesn't fit in a %i atlas page\n", images[i].width, images[i].height, page_size);
+            continue;
+        }
+
+        stbrp_rect rect{};
+        rect.id = i;
+        rect.w = w;
+        rect.h = h;
+        pending.push_back(rect);
+    }
+
+    std::vector<stbrp_node> nodes(grid);
+    while (!pending.empty())
+    {
+        stbrp_context context;
+        stbrp_init_target(&context, grid, grid, nodes.data(), (int)nodes.size());
+        stbrp_pack_rects(&context, pending.data(), (int)pending.size());
+
+        int page_index = (int)atlas->pages.size();
+        atlas->pages.emplace_back();
+        Image* page = &atlas->pages.back();
+        LoadImage(page, page_size, page_size);
+
+        // Whatever didn't fit carries over to a fresh page
+        std::vector<stbrp_rect> leftover;
+        leftover.reserve(pending.size());
+        for (const stbrp_rect& rect : pending)
+        {
+            if (!rect.was_packed)
+            {
+                leftover.push_back(rect);
+                continue;
+            }
+
+            const Image& image = images[rect.id];
+            int cell_x = rect.x * padding;
+            int cell_y = rect.y * padding;
+            BlitPadded(image, page, cell_x, cell_y, rect.w * padding, rect.h * padding, padding);
+
+            AtlasRect& out = atlas->rects[rect.id];
+            out.page = page_index;
+            out.uv.x = (cell_x + padding) / (float)page_size;
+            out.uv.y = (cell_y + padding) / (float)page_size;
+            out.uv.z = (cell_x + padding + image.width) / (float)page_size;
+            out.uv.w = (cell_y + padding + image.height) / (float)page_size;
+        }
+        if (leftover.size() == pending.size())
+        {
+            printf("Warning: atlas packing made no progress, %i images left unpacked\n", (int)leftover.size());
+            UnloadImage(page);
+            atlas->pages.pop_back();
+            break;
+        }
+        pending.swap(leftover);
+    }
+
+    LoadAtlasTexture(atlas);
+}
+
+void UnloadAtlas(Atlas* atlas)
+{
+    for (Image& page : atlas->pages)
+        UnloadImage(&page);
+    atlas->pages.clear();
+    atlas->rects.clear();
+    UnloadTexture(&atlas->texture);
+}
+
+void RemapMeshTcoords(Mesh* mesh, const AtlasRect& rect)
+{
+    // Shared (cached) geometry would remap every mesh referencing it
+    assert(mesh->shared == -1 && !mesh->tcoords.empty() && mesh->tbo != GL_NONE);
+    Vector2 offset = { rect.uv.x, rect.uv.y };
+    Vector2 scale = { rect.uv.z - rect.uv.x, rect.uv.w - rect.uv.y };
+    for (Vector2& tcoord : mesh->tcoords)
+        tcoord = offset + tcoord * scale;
+
+    BindVertexBuffer(mesh->tbo);
+    UpdateVertexBuffer(mesh->tcoords.data(), mesh->tcoords.size() * sizeof(Vector2));
+    UnbindVertexBuffer(mesh->tbo);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include "Image.h"
+#include "Texture.h"
+#include "Mesh.h"
+
+// Where one source image ended up: uv = (u0, v0, u1, v1) within page (array layer) page
+struct AtlasRect
+{
+	Vector4 uv = { 0.0f, 0.0f, 1.0f, 1.0f };
+	int page = -1;	// -1 if the image didn't fit on a page at all
+};
+
+// Many small images packed into a few large pages, uploaded as one GL_TEXTURE_2D_ARRAY
+// so draws that only differ by image can share one texture bind (select with u_uv_rect & u_layer).
+struct Atlas
+{
+	int page_size = 0;
+	int padding = 0;
+	std::vector<Image> pages;
+	std::vector<AtlasRect> rects;	// Same order as the source images
+	Texture texture;
+};
+
+// padding (a power of two) is the edge-extended border around every image.
+// Images are also aligned to padding, so mips are limited to log2(padding) + 1 levels, which is exactly
+// as far as they can go before a downsampled texel would straddle two neighbouring images.
+void BuildAtlas(Atlas* atlas, const Image* images, int count, int page_size, int padding);
+void UnloadAtlas(Atlas* atlas);
+
+// Bakes rect into the mesh's tcoords & re-uploads them, so it draws with u_uv_rect = (0, 0, 1, 1).
+// Tcoords must lie in [0, 1] (no wrapping inside an atlas); the page still comes from u_layer.
+void RemapMeshTcoords(Mesh* mesh, const AtlasRect& rect);
@@ -0,0 +1,927 @@
+#include "BlockCompression.h"
+#include "Parallel.h"
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCK_SSE2 1
+#endif
+
+// 16 texels in structure-of-arrays form so each SSE register holds one channel of 4 texels.
+// Texel i is at (i % 4, i / 4) within the block, rows in image order.
+struct alignas(16) BlockTexels
+{
+    float r[16];
+    float g[16];
+    float b[16];
+    float a[16];
+};
+
+// BC7 4-bit index interpolation weights (out of 64)
+static const int f_bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Weight of endpoint 0 for each BC1 index (palette order: e0, e1, 2/3 e0 + 1/3 e1, 1/3 e0 + 2/3 e1)
+static const float f_bc1_weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+int BlockBytes(BlockFormat format)
+{
+    return format == BLOCK_FORMAT_BC1 ? 8 : 16;
+}
+
+size_t CompressedSize(BlockFormat format, int width, int height)
+{
+    size_t blocks_x = (width + 3) / 4;
+    size_t blocks_y = (height + 3) / 4;
+    return blocks_x * blocks_y * BlockBytes(format);
+}
+
+static void LoadBlock(const Image& image, int bx, int by, BlockTexels* texels)
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sy = std::min(by * 4 + y, image.height - 1);
+        const Color* row = image.pixels + (size_t)sy * image.width;
+        for (int x = 0; x < 4; x++)
+        {
+            const Color& c = row[std::min(bx * 4 + x, image.width - 1)];
+            int i = y * 4 + x;
+            texels->r[i] = c.r;
+            texels->g[i] = c.g;
+            texels->b[i] = c.b;
+            texels->a[i] = c.a;
+        }
+    }
+}
+
+static inline int Clamp(int value, int lo, int hi)
+{
+    return std::min(hi, std::max(lo, value));
+}
+
+// Dominant direction of the block's colour distribution (power iteration on the covariance matrix)
+static void PrincipalAxis(const BlockTexels& t, int channels, float mean[4], float axis[4])
+{
+    const float* ch[4] = { t.r, t.g, t.b, t.a };
+    for (int c = 0; c < 4; c++)
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < 16; i++)
+            sum += ch[c][i];
+        mean[c] = c < channels ? sum / 16.0f : 0.0f;
+    }
+
+    float cov[4][4]{};
+    for (int i = 0; i < 16; i++)
+    {
+        float d[4];
+        for (int c = 0; c < channels; c++)
+            d[c] = ch[c][i] - mean[c];
+        for (int r = 0; r < channels; r++)
+            for (int c = r; c < channels; c++)
+                cov[r][c] += d[r] * d[c];
+    }
+    for (int r = 0; r < channels; r++)
+        for (int c = 0; c < r; c++)
+            cov[r][c] = cov[c][r];
+
+    // Start from the covariance column of the widest channel: a fixed start like (1,1,1) has no component along
+    // axes perpendicular to it (e.g. red rising as green falls) and the iteration collapses
+    int widest = 0;
+    for (int c = 1; c < channels; c++)
+    {
+        if (cov[c][c] > cov[widest][widest])
+            widest = c;
+    }
+    float v[4]{};
+    for (int c = 0; c < channels; c++)
+        v[c] = cov[c][widest];
+
+    // Degenerate start (flat block): the bounding box diagonal still orders the texels
+    float start = 0.0f;
+    for (int c = 0; c < channels; c++)
+        start += v[c] * v[c];
+    if (start < 1e-8f)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            float lo = ch[c][0];
+            float hi = ch[c][0];
+            for (int i = 1; i < 16; i++)
+            {
+                lo = std::min(lo, ch[c][i]);
+                hi = std::max(hi, ch[c][i]);
+            }
+            v[c] = hi - lo;
+        }
+    }
+
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4]{};
+        for (int r = 0; r < channels; r++)
+            for (int c = 0; c < channels; c++)
+                next[r] += cov[r][c] * v[c];
+
+        float length = 0.0f;
+        for (int c = 0; c < channels; c++)
+            length += next[c] * next[c];
+        if (length < 1e-8f)
+            break;
+
+        length = 1.0f / std::sqrt(length);
+        for (int c = 0; c < channels; c++)
+            v[c] = next[c] * length;
+    }
+
+    for (int c = 0; c < 4; c++)
+        axis[c] = c < channels ? v[c] : 0.0f;
+}
+
+// Finds the texels with the smallest & largest projection onto axis
+static void ProjectExtents(const BlockTexels& t, const float axis[4], int* lo, int* hi)
+{
+    alignas(16) float dots[16];
+
+#if BLOCK_SSE2
+    __m128 ax = _mm_set1_ps(axis[0]);
+    __m128 ay = _mm_set1_ps(axis[1]);
+    __m128 az = _mm_set1_ps(axis[2]);
+    __m128 aw = _mm_set1_ps(axis[3]);
+    __m128 min_dot = _mm_set1_ps(FLT_MAX);
+    __m128 max_dot = _mm_set1_ps(-FLT_MAX);
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 d = _mm_mul_ps(_mm_load_ps(t.r + i), ax);
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_load_ps(t.g + i), ay));
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_load_ps(t.b + i), az));
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_load_ps(t.a + i), aw));
+        min_dot = _mm_min_ps(min_dot, d);
+        max_dot = _mm_max_ps(max_dot, d);
+        _mm_store_ps(dots + i, d);
+    }
+
+    // Horizontal min/max, then find which texel produced them
+    min_dot = _mm_min_ps(min_dot, _mm_shuffle_ps(min_dot, min_dot, _MM_SHUFFLE(1, 0, 3, 2)));
+    min_dot = _mm_min_ps(min_dot, _mm_shuffle_ps(min_dot, min_dot, _MM_SHUFFLE(2, 3, 0, 1)));
+    max_dot = _mm_max_ps(max_dot, _mm_shuffle_ps(max_dot, max_dot, _MM_SHUFFLE(1, 0, 3, 2)));
+    max_dot = _mm_max_ps(max_dot, _mm_shuffle_ps(max_dot, max_dot, _MM_SHUFFLE(2, 3, 0, 1)));
+    float min_value = _mm_cvtss_f32(min_dot);
+    float max_value = _mm_cvtss_f32(max_dot);
+#else
+    float min_value = FLT_MAX;
+    float max_value = -FLT_MAX;
+    for (int i = 0; i < 16; i++)
+    {
+        dots[i] = t.r[i] * axis[0] + t.g[i] * axis[1] + t.b[i] * axis[2] + t.a[i] * axis[3];
+        min_value = std::min(min_value, dots[i]);
+        max_value = std::max(max_value, dots[i]);
+    }
+#endif
+
+    *lo = 0;
+    *hi = 0;
+    for (int i = 15; i >= 0; i--)
+    {
+        if (dots[i] == min_value)
+            *lo = i;
+        if (dots[i] == max_value)
+            *hi = i;
+    }
+}
+
+// Picks the nearest palette entry for every texel, returns the total squared error.
+// Alpha only counts if the palette entries' alpha is meaningful (alpha == true).
+static float SelectIndices(const BlockTexels& t, const float (*palette)[4], int count, bool alpha, uint8_t indices[16])
+{
+#if BLOCK_SSE2
+    __m128 total = _mm_setzero_ps();
+    __m128 alpha_mask = alpha ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : _mm_setzero_ps();
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 r = _mm_load_ps(t.r + i);
+        __m128 g = _mm_load_ps(t.g + i);
+        __m128 b = _mm_load_ps(t.b + i);
+        __m128 a = _mm_load_ps(t.a + i);
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128i best_index = _mm_setzero_si128();
+        for (int p = 0; p < count; p++)
+        {
+            __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+            __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+            __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+            __m128 da = _mm_and_ps(_mm_sub_ps(a, _mm_set1_ps(palette[p][3])), alpha_mask);
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+                _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+            best = _mm_min_ps(best, d);
+            best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, best_index));
+        }
+
+        alignas(16) int32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), best_index);
+        for (int j = 0; j < 4; j++)
+            indices[i + j] = (uint8_t)lanes[j];
+        total = _mm_add_ps(total, best);
+    }
+
+    alignas(16) float sums[4];
+    _mm_store_ps(sums, total);
+    return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float best = FLT_MAX;
+        for (int p = 0; p < count; p++)
+        {
+            float dr = t.r[i] - palette[p][0];
+            float dg = t.g[i] - palette[p][1];
+            float db = t.b[i] - palette[p][2];
+            float da = alpha ? t.a[i] - palette[p][3] : 0.0f;
+            float d = dr * dr + dg * dg + db * db + da * da;
+            if (d < best)
+            {
+                best = d;
+                indices[i] = (uint8_t)p;
+            }
+        }
+        total += best;
+    }
+    return total;
+#endif
+}
+
+// Least-squares endpoints for fixed indices: minimise sum |w_i e0 + (1 - w_i) e1 - x_i|^2,
+// where weights[index] is endpoint 0's weight. Returns false if the system is degenerate.
+static bool FitEndpoints(const BlockTexels& t, const uint8_t indices[16], const float* weights, int channels, float e0[4], float e1[4])
+{
+    const float* ch[4] = { t.r, t.g, t.b, t.a };
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4]{}, bx[4]{};
+    for (int i = 0; i < 16; i++)
+    {
+        float wa = weights[indices[i]];
+        float wb = 1.0f - wa;
+        aa += wa * wa;
+        ab += wa * wb;
+        bb += wb * wb;
+        for (int c = 0; c < channels; c++)
+        {
+            ax[c] += wa * ch[c][i];
+            bx[c] += wb * ch[c][i];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f)
+        return false;
+
+    float inv = 1.0f / det;
+    for (int c = 0; c < channels; c++)
+    {
+        e0[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) * inv));
+        e1[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) * inv));
+    }
+    return true;
+}
+
+static int RefinementPasses(BlockQuality quality)
+{
+    switch (quality)
+    {
+    case BLOCK_QUALITY_FAST: return 0;
+    case BLOCK_QUALITY_NORMAL: return 1;
+    default: return 3;
+    }
+}
+
+static inline uint16_t Pack565(const float c[4])
+{
+    int r = Clamp((int)std::lround(c[0] * 31.0f / 255.0f), 0, 31);
+    int g = Clamp((int)std::lround(c[1] * 63.0f / 255.0f), 0, 63);
+    int b = Clamp((int)std::lround(c[2] * 31.0f / 255.0f), 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline void Unpack565(uint16_t v, int c[3])
+{
+    int r = (v >> 11) & 31;
+    int g = (v >> 5) & 63;
+    int b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+static void WriteU16(uint8_t* dst, uint16_t value)
+{
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8);
+}
+
+// BC1 colour block, always in 4-colour mode (c0 > c1) so it's also valid inside BC3
+static void EncodeColorBlock(const BlockTexels& t, BlockQuality quality, uint8_t out[8])
+{
+    float mean[4], axis[4];
+    PrincipalAxis(t, 3, mean, axis);
+
+    int lo, hi;
+    ProjectExtents(t, axis, &lo, &hi);
+    float e0[4] = { t.r[hi], t.g[hi], t.b[hi], 0.0f };
+    float e1[4] = { t.r[lo], t.g[lo], t.b[lo], 0.0f };
+
+    float best_error = FLT_MAX;
+    int passes = RefinementPasses(quality);
+    for (int pass = 0; pass <= passes; pass++)
+    {
+        uint16_t c0 = Pack565(e0);
+        uint16_t c1 = Pack565(e1);
+        if (c0 < c1)
+            std::swap(c0, c1);
+
+        int p0[3], p1[3];
+        Unpack565(c0, p0);
+        Unpack565(c1, p1);
+        float palette[4][4];
+        for (int c = 0; c < 3; c++)
+        {
+            palette[0][c] = (float)p0[c];
+            palette[1][c] = (float)p1[c];
+            palette[2][c] = (float)((2 * p0[c] + p1[c]) / 3);
+            palette[3][c] = (float)((p0[c] + 2 * p1[c]) / 3);
+        }
+
+        // Equal endpoints would flip the block into 3-colour mode, so keep everything on index 0
+        uint8_t indices[16];
+        float error = SelectIndices(t, palette, c0 == c1 ? 1 : 4, false, indices);
+        if (error < best_error)
+        {
+            best_error = error;
+            uint32_t bits = 0;
+            for (int i = 0; i < 16; i++)
+                bits |= (uint32_t)indices[i] << (2 * i);
+
+            WriteU16(out + 0, c0);
+            WriteU16(out + 2, c1);
+            WriteU16(out + 4, (uint16_t)bits);
+            WriteU16(out + 6, (uint16_t)(bits >> 16));
+        }
+
+        if (pass == passes || c0 == c1 || !FitEndpoints(t, indices, f_bc1_weights, 3, e0, e1))
+            break;
+    }
+}
+
+// BC4-style alpha block (8 interpolated values, a0 > a1)
+static void EncodeAlphaBlock(const BlockTexels& t, uint8_t out[8])
+{
+    int a_min = 255, a_max = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        a_min = std::min(a_min, (int)t.a[i]);
+        a_max = std::max(a_max, (int)t.a[i]);
+    }
+
+    int palette[8];
+    palette[0] = a_max;
+    palette[1] = a_min;
+    for (int i = 2; i < 8; i++)
+        palette[i] = ((8 - i) * a_max + (i - 1) * a_min) / 7;
+
+    uint64_t bits = 0;
+    if (a_max != a_min)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int best_error = 256;
+            for (int p = 0; p < 8; p++)
+            {
+                int error = std::abs((int)t.a[i] - palette[p]);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best = p;
+                }
+            }
+            bits |= (uint64_t)best << (3 * i);
+        }
+    }
+
+    out[0] = (uint8_t)a_max;
+    out[1] = (uint8_t)a_min;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (uint8_t)(bits >> (8 * i));
+}
+
+// Appends bits LSB-first into a zeroed 128-bit block
+struct BitWriter
+{
+    uint8_t* data;
+    int position;
+};
+
+static void WriteBits(BitWriter* writer, uint32_t value, int count)
+{
+    for (int i = 0; i < count; i++, writer->position++)
+    {
+        if (value & (1u << i))
+            writer->data[writer->position >> 3] |= (uint8_t)(1u << (writer->position & 7));
+    }
+}
+
+static uint32_t ReadBits(const uint8_t* data, int* position, int count)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++, (*position)++)
+    {
+        if (data[*position >> 3] & (1u << (*position & 7)))
+            value |= 1u << i;
+    }
+    return value;
+}
+
+// BC7 mode 6: one subset, RGBA endpoints of 7 bits + a shared-per-endpoint p-bit, 4-bit indices
+static void EncodeBC7Block(const BlockTexels& t, BlockQuality quality, uint8_t out[16])
+{
+    float mean[4], axis[4];
+    PrincipalAxis(t, 4, mean, axis);
+
+    int lo, hi;
+    ProjectExtents(t, axis, &lo, &hi);
+    float e0[4] = { t.r[lo], t.g[lo], t.b[lo], t.a[lo] };
+    float e1[4] = { t.r[hi], t.g[hi], t.b[hi], t.a[hi] };
+
+    float weights[16];
+    for (int i = 0; i < 16; i++)
+        weights[i] = (64 - f_bc7_weights[i]) / 64.0f;
+
+    float best_error = FLT_MAX;
+    int best_q[2][4]{};
+    int best_p[2]{};
+    uint8_t best_indices[16]{};
+
+    int passes = RefinementPasses(quality);
+    for (int pass = 0; pass <= passes; pass++)
+    {
+        uint8_t pass_indices[16];
+        float pass_error = FLT_MAX;
+
+        // Try every p-bit pair: each shifts the reachable 8-bit endpoint values by one
+        for (int p = 0; p < 4; p++)
+        {
+            int pbit[2] = { p & 1, p >> 1 };
+            int q[2][4], e[2][4];
+            for (int c = 0; c < 4; c++)
+            {
+                q[0][c] = Clamp((int)std::lround((e0[c] - pbit[0]) * 0.5f), 0, 127);
+                q[1][c] = Clamp((int)std::lround((e1[c] - pbit[1]) * 0.5f), 0, 127);
+                e[0][c] = (q[0][c] << 1) | pbit[0];
+                e[1][c] = (q[1][c] << 1) | pbit[1];
+            }
+
+            float palette[16][4];
+            for (int i = 0; i < 16; i++)
+            {
+                int w = f_bc7_weights[i];
+                for (int c = 0; c < 4; c++)
+                    palette[i][c] = (float)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+            }
+
+            uint8_t indices[16];
+            float error = SelectIndices(t, palette, 16, true, indices);
+            if (error < pass_error)
+            {
+                pass_error = error;
+                memcpy(pass_indices, indices, sizeof(indices));
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                memcpy(best_q, q, sizeof(q));
+                memcpy(best_p, pbit, sizeof(pbit));
+                memcpy(best_indices, indices, sizeof(indices));
+            }
+        }
+
+        if (pass == passes || !FitEndpoints(t, pass_indices, weights, 4, e0, e1))
+            break;
+    }
+
+    // Texel 0's index is stored with an implicit 0 MSB, so swap the endpoints if it's >= 8
+    if (best_indices[0] >= 8)
+    {
+        for (int c = 0; c < 4; c++)
+            std::swap(best_q[0][c], best_q[1][c]);
+        std::swap(best_p[0], best_p[1]);
+        for (int i = 0; i < 16; i++)
+            best_indices[i] = (uint8_t)(15 - best_indices[i]);
+    }
+
+    memset(out, 0, 16);
+    BitWriter writer{ out, 0 };
+    WriteBits(&writer, 1u << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        WriteBits(&writer, best_q[0][c], 7);
+        WriteBits(&writer, best_q[1][c], 7);
+    }
+    WriteBits(&writer, best_p[0], 1);
+    WriteBits(&writer, best_p[1], 1);
+    WriteBits(&writer, best_indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        WriteBits(&writer, best_indices[i], 4);
+}
+
+void CompressImage(const Image& image, BlockFormat format, BlockQuality quality, CompressedImage* compressed)
+{
+    assert(image.pixels != nullptr);
+    int blocks_x = (image.width + 3) / 4;
+    int blocks_y = (image.height + 3) / 4;
+    int block_bytes = BlockBytes(format);
+
+    compressed->format = format;
+    compressed->width = image.width;
+    compressed->height = image.height;
+    compressed->blocks.resize(CompressedSize(format, image.width, image.height));
+
+    // Every block is independent, so block-rows are split across threads (~64x more work per byte than a fill)
+    uint8_t* blocks = compressed->blocks.data();
+    ParallelRows(blocks_y, (size_t)image.width * image.height * 64, [&](int y0, int y1)
+    {
+        BlockTexels texels;
+        for (int by = y0; by < y1; by++)
+        {
+            uint8_t* out = blocks + (size_t)by * blocks_x * block_bytes;
+            for (int bx = 0; bx < blocks_x; bx++, out += block_bytes)
+            {
+                LoadBlock(image, bx, by, &texels);
+                switch (format)
+                {
+                case BLOCK_FORMAT_BC1:
+                    EncodeColorBlock(texels, quality, out);
+                    break;
+
+                case BLOCK_FORMAT_BC3:
+                    EncodeAlphaBlock(texels, out);
+                    EncodeColorBlock(texels, quality, out + 8);
+                    break;
+
+                case BLOCK_FORMAT_BC7:
+                    EncodeBC7Block(texels, quality, out);
+                    break;
+
+                default:
+                    assert(false);
+                    break;
+                }
+            }
+        }
+    });
+}
+
+static void DecodeColorBlock(const uint8_t* in, bool four_color_only, Color out[16])
+{
+    uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8));
+    uint16_t c1 = (uint16_t)(in[2] | (in[3] << 8));
+    uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+
+    int p[4][4];
+    Unpack565(c0, p[0]);
+    Unpack565(c1, p[1]);
+    p[0][3] = p[1][3] = p[2][3] = p[3][3] = 255;
+    for (int c = 0; c < 3; c++)
+    {
+        if (c0 > c1 || four_color_only)
+        {
+            p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+            p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+        }
+        else
+        {
+            p[2][c] = (p[0][c] + p[1][c]) / 2;
+            p[3][c] = 0;
+        }
+    }
+    if (!(c0 > c1 || four_color_only))
+        p[3][3] = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        const int* c = p[(bits >> (2 * i)) & 3];
+        out[i] = { (uint8_t)c[0], (uint8_t)c[1], (uint8_t)c[2], (uint8_t)c[3] };
+    }
+}
+
+static void DecodeAlphaBlock(const uint8_t* in, Color out[16])
+{
+    int a0 = in[0], a1 = in[1];
+    int palette[8] = { a0, a1 };
+    if (a0 > a1)
+    {
+        for (int i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+    }
+    else
+    {
+        for (int i = 2; i < 6; i++)
+            palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= (uint64_t)in[2 + i] << (8 * i);
+    for (int i = 0; i < 16; i++)
+        out[i].a = (uint8_t)palette[(bits >> (3 * i)) & 7];
+}
+
+static void DecodeBC7Block(const uint8_t* in, Color out[16])
+{
+    // Only mode 6 is produced by this encoder; anything else decodes to magenta so it's obvious
+    if ((in[0] & 0x7F) != 0x40)
+    {
+        for (int i = 0; i < 16; i++)
+            out[i] = { 255, 0, 255, 255 };
+        return;
+    }
+
+    int position = 7;
+    int q[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+        q[0][c] = ReadBits(in, &position, 7);
+        q[1][c] = ReadBits(in, &position, 7);
+    }
+    int p0 = ReadBits(in, &position, 1);
+    int p1 = ReadBits(in, &position, 1);
+
+    int e[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+        e[0][c] = (q[0][c] << 1) | p0;
+        e[1][c] = (q[1][c] << 1) | p1;
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+        int index = ReadBits(in, &position, i == 0 ? 3 : 4);
+        int w = f_bc7_weights[index];
+        uint8_t v[4];
+        for (int c = 0; c < 4; c++)
+            v[c] = (uint8_t)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+        out[i] = { v[0], v[1], v[2], v[3] };
+    }
+}
+
+void DecompressImage(const CompressedImage& compressed, Image* image)
+{
+    LoadImage(image, compressed.width, compressed.height);
+    int blocks_x = (compressed.width + 3) / 4;
+    int blocks_y = (compressed.height + 3) / 4;
+    int block_bytes = BlockBytes(compressed.format);
+
+    for (int by = 0; by < blocks_y; by++)
+    {
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            const uint8_t* in = compressed.blocks.data() + ((size_t)by * blocks_x + bx) * block_bytes;
+            Color texels[16];
+            switch (compressed.format)
+            {
+            case BLOCK_FORMAT_BC1:
+                DecodeColorBlock(in, false, texels);
+                break;
+
+            case BLOCK_FORMAT_BC3:
+                DecodeColorBlock(in + 8, true, texels);
+                DecodeAlphaBlock(in, texels);
+                break;
+
+            case BLOCK_FORMAT_BC7:
+                DecodeBC7Block(in, texels);
+                break;
+
+            default:
+                assert(false);
+                break;
+            }
+
+            for (int y = 0; y < 4 && by * 4 + y < image->height; y++)
+            {
+                for (int x = 0; x < 4 && bx * 4 + x < image->width; x++)
+                    image->pixels[(size_t)(by * 4 + y) * image->width + bx * 4 + x] = texels[y * 4 + x];
+            }
+        }
+    }
+}
+
+double ImagePSNR(const Image& a, const Image& b, bool include_alpha)
+{
+    assert(a.width == b.width && a.height == b.height);
+    size_t count = (size_t)a.width * a.height;
+    int channels = include_alpha ? 4 : 3;
+
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t* pa = &a.pixels[i].r;
+        const uint8_t* pb = &b.pixels[i].r;
+        for (int c = 0; c < channels; c++)
+        {
+            double d = (double)pa[c] - (double)pb[c];
+            sum += d * d;
+        }
+    }
+
+    double mse = sum / (double)(count * channels);
+    if (mse == 0.0)
+        return std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+uint64_t HashImage(const Image& image)
+{
+    // FNV-1a over 8-byte words; fast enough to key a 4K image in a few milliseconds
+    const uint64_t prime = 1099511628211ull;
+    uint64_t hash = 14695981039346656037ull;
+    hash = (hash ^ (uint64_t)image.width) * prime;
+    hash = (hash ^ (uint64_t)image.height) * prime;
+
+    size_t bytes = (size_t)image.width * image.height * sizeof(Color);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(image.pixels);
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < bytes; i++)
+        hash = (hash ^ data[i]) * prime;
+    return hash;
+}
+
+static const uint32_t CACHE_MAGIC = 0x31434342; // "BCC1"
+
+static std::string CachePath(const char* directory, uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bcc", (unsigned long long)key);
+    return std::string(directory) + "/" + name;
+}
+
+bool LoadCompressedCache(const char* directory, uint64_t key, BlockFormat format, std::vector<CompressedImage>* levels)
+{
+    std::string path = CachePath(directory, key);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    uint32_t header[3];
+    bool valid = fread(header, sizeof(header), 1, file) == 1 &&
+        header[0] == CACHE_MAGIC && header[1] == (uint32_t)format && header[2] > 0;
+
+    if (valid)
+    {
+        levels->resize(header[2]);
+        for (CompressedImage& level : *levels)
+        {
+            uint32_t size[2];
+            valid = fread(size, sizeof(size), 1, file) == 1;
+            if (!valid)
+                break;
+
+            level.format = format;
+            level.width = (int)size[0];
+            level.height = (int)size[1];
+            level.blocks.resize(CompressedSize(format, level.width, level.height));
+            valid = fread(level.blocks.data(), 1, level.blocks.size(), file) == level.blocks.size();
+            if (!valid)
+                break;
+        }
+    }
+
+    fclose(file);
+    if (!valid)
+    {
+        printf("Warning: ignoring corrupt texture cache %s\n", path.c_str());
+        levels->clear();
+    }
+    return valid;
+}
+
+bool SaveCompressedCache(const char* directory, uint64_t key, const std::vector<CompressedImage>& levels)
+{
+    assert(!levels.empty());
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    std::string path = CachePath(directory, key);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        printf("Warning: failed to write texture cache %s\n", path.c_str());
+        return false;
+    }
+
+    uint32_t header[3] = { CACHE_MAGIC, (uint32_t)levels[0].format, (uint32_t)levels.size() };
+    fwrite(header, sizeof(header), 1, file);
+    for (const CompressedImage& level : levels)
+    {
+        uint32_t size[2] = { (uint32_t)level.width, (uint32_t)level.height };
+        fwrite(size, sizeof(size), 1, file);
+        fwrite(level.blocks.data(), 1, level.blocks.size(), file);
+    }
+
+    fclose(file);
+    return true;
+}
+
+void BenchmarkBlockCompression()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    const int width = 3840;
+    const int height = 2160;
+    const double mpix = width * (double)height * 1e-6;
+
+    // Gradient + per-texel noise (with a noisy alpha) so blocks aren't trivially flat
+    Image source;
+    LoadImage(&source, width, height);
+    LoadImageGradient(&source, Vector3Zeros, Vector3UnitX, Vector3UnitY, Vector3Ones);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        int noise = (int)(seed >> 28) - 8;
+        Color& c = source.pixels[i];
+        c.r = (uint8_t)Clamp(c.r + noise, 0, 255);
+        c.g = (uint8_t)Clamp(c.g - noise, 0, 255);
+        c.a = (uint8_t)Clamp(192 + noise * 4, 0, 255);
+    }
+
+    const char* names[BLOCK_FORMAT_COUNT] = { "BC1", "BC3", "BC7" };
+    printf("Block compression benchmark (%ix%i, %i threads):\n", width, height, (int)std::thread::hardware_concurrency());
+    for (int f = 0; f < BLOCK_FORMAT_COUNT; f++)
+    {
+        for (int q = BLOCK_QUALITY_FAST; q <= BLOCK_QUALITY_HIGH; q++)
+        {
+            BlockFormat format = (BlockFormat)f;
+            CompressedImage compressed;
+            auto begin = Clock::now();
+            CompressImage(source, format, (BlockQuality)q, &compressed);
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+            Image decoded;
+            DecompressImage(compressed, &decoded);
+            double psnr = ImagePSNR(source, decoded, format != BLOCK_FORMAT_BC1);
+            UnloadImage(&decoded);
+
+            printf("  %s q%i: %8.2f ms  %8.1f MPix/s  PSNR %6.2f dB\n",
+                names[f], q, seconds * 1e3, mpix / seconds, psnr);
+        }
+    }
+
+    UnloadImage(&source);
+
+    // Red falling as green rises, in every block: the colour axis is perpendicular to the grey diagonal.
+    // 16 steps on one line cap BC1/BC3's 4-entry palettes near 24 dB; a missed axis collapses to a flat block (~7 dB).
+    Image ramp;
+    LoadImage(&ramp, 256, 256);
+    for (int y = 0; y < ramp.height; y++)
+    {
+        for (int x = 0; x < ramp.width; x++)
+        {
+            int i = (y & 3) * 4 + (x & 3);
+            ramp.pixels[y * ramp.width + x] = { (uint8_t)(16 * i), (uint8_t)(255 - 16 * i), 128, 255 };
+        }
+    }
+
+    printf("Anti-correlated ramp PSNR:\n");
+    for (int f = 0; f < BLOCK_FORMAT_COUNT; f++)
+    {
+        for (int q = BLOCK_QUALITY_FAST; q <= BLOCK_QUALITY_HIGH; q++)
+        {
+            CompressedImage compressed;
+            CompressImage(ramp, (BlockFormat)f, (BlockQuality)q, &compressed);
+            Image decoded;
+            DecompressImage(compressed, &decoded);
+            double psnr = ImagePSNR(ramp, decoded, false);
+            UnloadImage(&decoded);
+
+            printf("  %s q%i: PSNR %6.2f dB%s\n", names[f], q, psnr, psnr < 20.0 ? "  (axis fit failed)" : "");
+        }
+    }
+
+    UnloadImage(&ramp);
+}
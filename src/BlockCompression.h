@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Image.h"
+
+// GPU block-compressed formats (4x4 texel blocks)
+enum BlockFormat
+{
+    BLOCK_FORMAT_BC1,   // 8 bytes/block, RGB 565 endpoints + 2-bit indices (alpha ignored)
+    BLOCK_FORMAT_BC3,   // 16 bytes/block, BC1 colour + 8-bit interpolated alpha
+    BLOCK_FORMAT_BC7,   // 16 bytes/block, mode 6 (RGBA 7.7.7.7 + p-bit endpoints, 4-bit indices)
+    BLOCK_FORMAT_COUNT
+};
+
+// Higher levels spend more least-squares refinement passes on the endpoints
+enum BlockQuality
+{
+    BLOCK_QUALITY_FAST,
+    BLOCK_QUALITY_NORMAL,
+    BLOCK_QUALITY_HIGH
+};
+
+struct CompressedImage
+{
+    BlockFormat format = BLOCK_FORMAT_BC1;
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> blocks;
+};
+
+int BlockBytes(BlockFormat format);
+size_t CompressedSize(BlockFormat format, int width, int height);
+
+// Blocks are encoded in parallel by block-row; edge blocks clamp to the last row/column
+void CompressImage(const Image& image, BlockFormat format, BlockQuality quality, CompressedImage* compressed);
+void DecompressImage(const CompressedImage& compressed, Image* image);
+
+// Peak signal-to-noise ratio over RGB (and A if include_alpha) in dB, infinity when identical
+double ImagePSNR(const Image& a, const Image& b, bool include_alpha);
+
+// Offline cache: files are named by a hash of the source pixels, format & quality
+uint64_t HashImage(const Image& image);
+bool LoadCompressedCache(const char* directory, uint64_t key, BlockFormat format, std::vector<CompressedImage>* levels);
+bool SaveCompressedCache(const char* directory, uint64_t key, const std::vector<CompressedImage>& levels);
+
+// Prints encode throughput (MPix/s) and PSNR for each format on a 3840x2160 image, then PSNR on an
+// anti-correlated red/green ramp that a badly started axis fit collapses to one colour
+void BenchmarkBlockCompression();
@@ -89,13 +89,13 @@ void SetVertexAttribute(GLuint index, GLint compSize, GLenum type, GLsizei strid
 	glVertexAttribPointer(index, compSize, type, GL_FALSE, stride, nullptr);
 }
 
-void UpdateVertexBuffer(void* data, int data_size)
+void UpdateVertexBuffer(const void* data, int data_size)
 {
 	assert(f_vbo != GL_NONE);
 	glBufferData(GL_ARRAY_BUFFER, data_size, data, GL_STATIC_DRAW);
 }
 
-void UpdateElementBuffer(void* data, int data_size)
+void UpdateElementBuffer(const void* data, int data_size)
 {
 	assert(f_ibo != GL_NONE);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, data_size, data, GL_STATIC_DRAW);
@@ -22,5 +22,5 @@ void DisableVertexAttribute(GLuint index);
 
 void SetVertexAttribute(GLuint index, GLint compSize, GLenum type, GLsizei stride);
 
-void UpdateVertexBuffer(void* data, int data_size);
-void UpdateElementBuffer(void* data, int data_size);
\ No newline at end of file
+void UpdateVertexBuffer(const void* data, int data_size);
+void UpdateElementBuffer(const void* data, int data_size);
\ No newline at end of file
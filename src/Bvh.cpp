@@ -0,0 +1,933 @@
+#include "Bvh.h"
+#include "Jobs.h"
+#include "Memory.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BVH_SSE2 1
+#endif
+
+constexpr int BVH_BINS = 16;
+constexpr int BVH_MAX_LEAF = 8;                 // However cheap SAH says a bigger leaf would be
+constexpr int BVH_MAX_DEPTH = 60;               // Deeper nodes become leaves, so traversal stacks can't overflow
+constexpr int BVH_STACK = BVH_MAX_DEPTH + 4;
+constexpr float BVH_TRAVERSAL_COST = 1.0f;      // Relative to one triangle test
+
+// Nodes above this bin & partition across the job system; subtrees above BVH_JOB_TRIANGLES build as jobs
+constexpr uint32_t BVH_PARALLEL_TRIANGLES = 64 * 1024;
+constexpr uint32_t BVH_JOB_TRIANGLES = 4 * 1024;
+constexpr int BVH_MAX_PIECES = 64;
+
+constexpr float BVH_FAR = 3.402823466e+38f;
+
+struct Aabb
+{
+    Vector3 min;
+    Vector3 max;
+};
+
+struct Bin
+{
+    Aabb box;
+    uint32_t count;
+};
+
+// Partitioned in place (rather than indices into per-triangle arrays), so every pass over a node streams through memory
+struct BuildTriangle
+{
+    Aabb box;
+    Vector3 centroid;
+    uint32_t id;                        // Mesh triangle
+};
+
+struct BvhBuild
+{
+    std::vector<BuildTriangle> triangles;   // Leaf order once built
+    BvhNode* nodes = nullptr;
+    std::atomic<uint32_t> node_count{ 0 };
+};
+
+struct BuildTask
+{
+    BvhBuild* build;
+    uint32_t node;
+    int depth;
+};
+
+static const Aabb EMPTY_BOX = { { BVH_FAR, BVH_FAR, BVH_FAR }, { -BVH_FAR, -BVH_FAR, -BVH_FAR } };
+
+// std::min rather than Vector3Min: fminf's NaN handling keeps it from compiling to a single instruction,
+// and these run a few times per triangle per tree level
+static Vector3 Min(Vector3 a, Vector3 b)
+{
+    return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) };
+}
+
+static Vector3 Max(Vector3 a, Vector3 b)
+{
+    return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) };
+}
+
+static void Grow(Aabb* box, const Aabb& other)
+{
+    box->min = Min(box->min, other.min);
+    box->max = Max(box->max, other.max);
+}
+
+static void Grow(Aabb* box, Vector3 point)
+{
+    box->min = Min(box->min, point);
+    box->max = Max(box->max, point);
+}
+
+static float HalfArea(const Aabb& box)
+{
+    Vector3 size = Vector3Subtract(box.max, box.min);
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+static float HalfArea(const BvhNode& node)
+{
+    Aabb box = { { node.min[0], node.min[1], node.min[2] }, { node.max[0], node.max[1], node.max[2] } };
+    return HalfArea(box);
+}
+
+static float Axis(Vector3 v, int axis)
+{
+    return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+// Runs fn(piece, begin, end) over up to BVH_MAX_PIECES even slices of [begin, end): across the job system for big
+// ranges, as one piece otherwise. Returns the number of pieces; each gets called, even when its slice is empty.
+template<typename Fn>
+static int ForPieces(uint32_t begin, uint32_t end, Fn fn)
+{
+    uint32_t count = end - begin;
+    int pieces = 1;
+    if (count >= BVH_PARALLEL_TRIANGLES && JobThreadIndex() >= 0)
+        pieces = std::min(JobThreadCount() * 4, BVH_MAX_PIECES);
+
+    uint32_t size = (count + pieces - 1) / pieces;
+    ParallelFor(pieces, 1, [&](int p0, int p1)
+    {
+        for (int piece = p0; piece < p1; piece++)
+        {
+            uint32_t first = std::min(end, begin + piece * size);
+            fn(piece, first, std::min(end, first + size));
+        }
+    });
+    return pieces;
+}
+
+static int BinIndex(const BuildTriangle& triangle, int axis, float origin, float scale)
+{
+    int bin = (int)((Axis(triangle.centroid, axis) - origin) * scale);
+    return std::min(std::max(bin, 0), BVH_BINS - 1);
+}
+
+static void BuildNode(BvhBuild* build, uint32_t index, uint32_t begin, uint32_t end, int depth);
+
+static void BuildNodeJob(void* data, int begin, int end)
+{
+    BuildTask* task = static_cast<BuildTask*>(data);
+    BuildNode(task->build, task->node, (uint32_t)begin, (uint32_t)end, task->depth);
+}
+
+static void MakeLeaf(BvhNode* node, uint32_t begin, uint32_t end)
+{
+    node->first = begin;
+    node->count = end - begin;
+}
+
+static void BuildNode(BvhBuild* build, uint32_t index, uint32_t begin, uint32_t end, int depth)
+{
+    BvhNode& node = build->nodes[index];
+    uint32_t count = end - begin;
+    uint32_t mid = begin + count / 2;
+
+    {
+        ArenaScope scope(ScratchArena());
+        Aabb* partials = ArenaAllocArray<Aabb>(scope.arena, BVH_MAX_PIECES * 2);
+
+        // Node bounds & the bounds of its centroids, which the bins divide
+        int pieces = ForPieces(begin, end, [&](int piece, uint32_t first, uint32_t last)
+        {
+            Aabb bounds = EMPTY_BOX;
+            Aabb centroids = EMPTY_BOX;
+            for (uint32_t i = first; i < last; i++)
+            {
+                const BuildTriangle& triangle = build->triangles[i];
+                Grow(&bounds, triangle.box);
+                Grow(&centroids, triangle.centroid);
+            }
+            partials[piece * 2 + 0] = bounds;
+            partials[piece * 2 + 1] = centroids;
+        });
+
+        Aabb bounds = EMPTY_BOX;
+        Aabb centroids = EMPTY_BOX;
+        for (int piece = 0; piece < pieces; piece++)
+        {
+            Grow(&bounds, partials[piece * 2 + 0]);
+            Grow(&centroids, partials[piece * 2 + 1]);
+        }
+        memcpy(node.min, &bounds.min, sizeof(node.min));
+        memcpy(node.max, &bounds.max, sizeof(node.max));
+
+        if (count == 1 || depth >= BVH_MAX_DEPTH)
+        {
+            MakeLeaf(&node, begin, end);
+            return;
+        }
+
+        Vector3 extent = Vector3Subtract(centroids.max, centroids.min);
+        float origins[3] = { centroids.min.x, centroids.min.y, centroids.min.z };
+        // Small nodes get no more bins than triangles: most nodes are small, and clearing & sweeping bins dominates there
+        int bin_count = std::min(BVH_BINS, (int)count);
+        float scales[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float size = Axis(extent, axis);
+            scales[axis] = size > 0.0f ? bin_count * 0.9999f / size : 0.0f;
+        }
+
+        if (scales[0] == 0.0f && scales[1] == 0.0f && scales[2] == 0.0f)
+        {
+            // Every centroid in one spot: nothing to bin, so split the range in half unless it's small enough
+            if (count <= BVH_MAX_LEAF)
+            {
+                MakeLeaf(&node, begin, end);
+                return;
+            }
+        }
+        else
+        {
+            Bin* bins = ArenaAllocArray<Bin>(scope.arena, BVH_MAX_PIECES * 3 * BVH_BINS);
+            ForPieces(begin, end, [&](int piece, uint32_t first, uint32_t last)
+            {
+                Bin* own = bins + piece * 3 * BVH_BINS;
+                for (int i = 0; i < 3 * BVH_BINS; i++)
+                {
+                    if (i % BVH_BINS < bin_count)
+                        own[i] = { EMPTY_BOX, 0 };
+                }
+                for (uint32_t i = first; i < last; i++)
+                {
+                    const BuildTriangle& triangle = build->triangles[i];
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        if (scales[axis] == 0.0f)
+                            continue;
+                        Bin& bin = own[axis * BVH_BINS + BinIndex(triangle, axis, origins[axis], scales[axis])];
+                        Grow(&bin.box, triangle.box);
+                        bin.count++;
+                    }
+                }
+            });
+            for (int piece = 1; piece < pieces; piece++)
+            {
+                for (int i = 0; i < 3 * BVH_BINS; i++)
+                {
+                    if (i % BVH_BINS >= bin_count)
+                        continue;
+                    Bin& bin = bins[piece * 3 * BVH_BINS + i];
+                    Grow(&bins[i].box, bin.box);
+                    bins[i].count += bin.count;
+                }
+            }
+
+            // Sweep each axis from both ends: splitting after bin i costs left area * left count + right area * right count
+            int best_axis = -1;
+            int best_split = 0;
+            float best_cost = BVH_FAR;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (scales[axis] == 0.0f)
+                    continue;
+
+                const Bin* axis_bins = bins + axis * BVH_BINS;
+                float right_costs[BVH_BINS];
+                Aabb right = EMPTY_BOX;
+                uint32_t right_count = 0;
+                for (int i = bin_count - 1; i > 0; i--)
+                {
+                    Grow(&right, axis_bins[i].box);
+                    right_count += axis_bins[i].count;
+                    right_costs[i - 1] = right_count > 0 ? HalfArea(right) * right_count : 0.0f;
+                }
+
+                Aabb left = EMPTY_BOX;
+                uint32_t left_count = 0;
+                for (int i = 0; i < bin_count - 1; i++)
+                {
+                    Grow(&left, axis_bins[i].box);
+                    left_count += axis_bins[i].count;
+                    if (left_count == 0 || left_count == count)
+                        continue;
+                    float cost = HalfArea(left) * left_count + right_costs[i];
+                    if (cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_split = i;
+                    }
+                }
+            }
+            assert(best_axis >= 0);
+
+            float split_cost = BVH_TRAVERSAL_COST + best_cost / HalfArea(bounds);
+            if (count <= BVH_MAX_LEAF && (float)count <= split_cost)
+            {
+                MakeLeaf(&node, begin, end);
+                return;
+            }
+
+            float origin = origins[best_axis];
+            float scale = scales[best_axis];
+            BuildTriangle* first = build->triangles.data();
+            BuildTriangle* split = std::partition(first + begin, first + end, [&](const BuildTriangle& triangle)
+            {
+                return BinIndex(triangle, best_axis, origin, scale) <= best_split;
+            });
+            mid = (uint32_t)(split - first);
+        }
+    }
+
+    uint32_t left = build->node_count.fetch_add(2, std::memory_order_relaxed);
+    node.first = left;
+    node.count = 0;
+
+    // One child builds as a job while this thread takes the other
+    if (count >= BVH_JOB_TRIANGLES && JobThreadIndex() >= 0 && JobThreadCount() > 1)
+    {
+        JobCounter counter;
+        BuildTask task = { build, left, depth + 1 };
+        RunJob(BuildNodeJob, &task, (int)begin, (int)mid, &counter);
+        BuildNode(build, left + 1, mid, end, depth + 1);
+        WaitForCounter(&counter);
+    }
+    else
+    {
+        BuildNode(build, left, begin, mid, depth + 1);
+        BuildNode(build, left + 1, mid, end, depth + 1);
+    }
+}
+
+void BuildBvh(Bvh* bvh, const Mesh& mesh)
+{
+    MeshStreams streams = MeshGeometry(mesh);
+    int triangle_count = (streams.indices != nullptr ? streams.index_count : streams.vertex_count) / 3;
+    BuildBvh(bvh, streams.positions, streams.indices, triangle_count);
+}
+
+void BuildBvh(Bvh* bvh, const Vector3* positions, const uint32_t* indices, int triangle_count)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto begin = Clock::now();
+    DestroyBvh(bvh);
+    if (triangle_count <= 0)
+        return;
+
+    BvhBuild build;
+    build.triangles.resize(triangle_count);
+    ParallelFor(triangle_count, 4096, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            Vector3 a = positions[indices != nullptr ? indices[i * 3 + 0] : i * 3 + 0];
+            Vector3 b = positions[indices != nullptr ? indices[i * 3 + 1] : i * 3 + 1];
+            Vector3 c = positions[indices != nullptr ? indices[i * 3 + 2] : i * 3 + 2];
+            Aabb box = { Min(a, Min(b, c)), Max(a, Max(b, c)) };
+            build.triangles[i] = { box, Vector3Scale(Vector3Add(box.min, box.max), 0.5f), (uint32_t)i };
+        }
+    });
+
+    // A binary tree over n leaves (at least one triangle each) has at most 2n - 1 nodes
+    bvh->nodes.resize((size_t)triangle_count * 2 - 1);
+    build.nodes = bvh->nodes.data();
+    build.node_count = 1;
+    BuildNode(&build, 0, 0, (uint32_t)triangle_count, 0);
+    bvh->nodes.resize(build.node_count);
+    bvh->nodes.shrink_to_fit();
+
+    bvh->triangles.resize(triangle_count);
+    bvh->ids.resize(triangle_count);
+    ParallelFor(triangle_count, 4096, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            uint32_t triangle = build.triangles[i].id;
+            Vector3 a = positions[indices != nullptr ? indices[triangle * 3 + 0] : triangle * 3 + 0];
+            Vector3 b = positions[indices != nullptr ? indices[triangle * 3 + 1] : triangle * 3 + 1];
+            Vector3 c = positions[indices != nullptr ? indices[triangle * 3 + 2] : triangle * 3 + 2];
+            bvh->triangles[i] = { a, Vector3Subtract(b, a), Vector3Subtract(c, a) };
+            bvh->ids[i] = triangle;
+        }
+    });
+
+    bvh->build_ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+void DestroyBvh(Bvh* bvh)
+{
+    *bvh = Bvh();
+}
+
+BvhStats GetBvhStats(const Bvh& bvh)
+{
+    BvhStats stats;
+    stats.triangles = (int)bvh.triangles.size();
+    stats.nodes = (int)bvh.nodes.size();
+    stats.build_ms = bvh.build_ms;
+    if (bvh.nodes.empty())
+        return stats;
+
+    uint32_t stack[BVH_STACK];
+    int depths[BVH_STACK];
+    int top = 0;
+    stack[top] = 0;
+    depths[top++] = 1;
+    float root_area = std::max(HalfArea(bvh.nodes[0]), 1e-30f);
+    while (top > 0)
+    {
+        top--;
+        const BvhNode& node = bvh.nodes[stack[top]];
+        int depth = depths[top];
+        stats.depth = std::max(stats.depth, depth);
+        float weight = HalfArea(node) / root_area;
+        if (node.count > 0)
+        {
+            stats.leaves++;
+            stats.sah_cost += weight * node.count;
+            continue;
+        }
+        stats.sah_cost += weight * BVH_TRAVERSAL_COST;
+        stack[top] = node.first;
+        depths[top++] = depth + 1;
+        stack[top] = node.first + 1;
+        depths[top++] = depth + 1;
+    }
+    return stats;
+}
+
+// Möller-Trumbore. Rejects only an exactly zero determinant (ray in the triangle's plane or a degenerate triangle),
+// so the test doesn't depend on the mesh's scale.
+static bool IntersectTriangle(const BvhTriangle& triangle, Vector3 origin, Vector3 direction, float max_t, RayHit* hit)
+{
+    Vector3 p = Vector3CrossProduct(direction, triangle.e2);
+    float det = Vector3DotProduct(triangle.e1, p);
+    if (det == 0.0f)
+        return false;
+
+    float inv_det = 1.0f / det;
+    Vector3 s = Vector3Subtract(origin, triangle.v0);
+    float u = Vector3DotProduct(s, p) * inv_det;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+
+    Vector3 q = Vector3CrossProduct(s, triangle.e1);
+    float v = Vector3DotProduct(direction, q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+
+    float t = Vector3DotProduct(triangle.e2, q) * inv_det;
+    if (t <= 0.0f || t > max_t)
+        return false;
+
+    hit->t = t;
+    hit->u = u;
+    hit->v = v;
+    return true;
+}
+
+// Slab test of one ray against one box. With SSE the three axes go in lanes 0-2; the fourth lane (the node's
+// first/count fields) is zeroed by a zero inverse direction, which also clamps the entry distance at 0.
+struct RayBoxTest
+{
+#if BVH_SSE2
+    __m128 origin;
+    __m128 inv_direction;
+#else
+    Vector3 origin;
+    Vector3 inv_direction;
+#endif
+};
+
+static RayBoxTest PrepareRay(Ray ray)
+{
+    // Division by a zero component gives an infinity of the right sign, which the slab test handles
+    Vector3 inv = { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+    RayBoxTest test;
+#if BVH_SSE2
+    test.origin = _mm_set_ps(0.0f, ray.origin.z, ray.origin.y, ray.origin.x);
+    test.inv_direction = _mm_set_ps(0.0f, inv.z, inv.y, inv.x);
+#else
+    test.origin = ray.origin;
+    test.inv_direction = inv;
+#endif
+    return test;
+}
+
+static bool IntersectBox(const RayBoxTest& ray, const BvhNode& node, float max_t, float* t_near)
+{
+#if BVH_SSE2
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.min), ray.origin), ray.inv_direction);
+    __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.max), ray.origin), ray.inv_direction);
+    __m128 lo = _mm_min_ps(t1, t2);
+    __m128 hi = _mm_max_ps(t1, t2);
+
+    // Exit distance: lane 3 becomes max_t rather than 0
+    const __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    hi = _mm_or_ps(_mm_and_ps(hi, xyz), _mm_set_ps(max_t, 0.0f, 0.0f, 0.0f));
+
+    lo = _mm_max_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    lo = _mm_max_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1, 0, 3, 2)));
+    hi = _mm_min_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_min_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1, 0, 3, 2)));
+    float enter = _mm_cvtss_f32(lo);
+    float exit = _mm_cvtss_f32(hi);
+#else
+    float enter = 0.0f;
+    float exit = max_t;
+    const float* origin = &ray.origin.x;
+    const float* inv = &ray.inv_direction.x;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float t1 = (node.min[axis] - origin[axis]) * inv[axis];
+        float t2 = (node.max[axis] - origin[axis]) * inv[axis];
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+    }
+#endif
+    *t_near = enter;
+    return enter <= exit;
+}
+
+// Nearer child first; the farther one waits on the stack with its entry distance, and is skipped if a closer hit
+// turns up meanwhile. any_hit returns at the first triangle hit.
+static bool TraceRay(const Bvh& bvh, Ray ray, float max_t, bool any_hit, RayHit* hit)
+{
+    if (bvh.nodes.empty())
+        return false;
+
+    RayBoxTest test = PrepareRay(ray);
+    float t_near;
+    if (!IntersectBox(test, bvh.nodes[0], max_t, &t_near))
+        return false;
+
+    uint32_t stack[BVH_STACK];
+    float distances[BVH_STACK];
+    int top = 0;
+    uint32_t index = 0;
+    int found = -1;
+    for (;;)
+    {
+        const BvhNode& node = bvh.nodes[index];
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; i++)
+            {
+                if (IntersectTriangle(bvh.triangles[i], ray.origin, ray.direction, max_t, hit))
+                {
+                    max_t = hit->t;
+                    found = (int)i;
+                    if (any_hit)
+                        return true;
+                }
+            }
+        }
+        else
+        {
+            float near0, near1;
+            bool hit0 = IntersectBox(test, bvh.nodes[node.first], max_t, &near0);
+            bool hit1 = IntersectBox(test, bvh.nodes[node.first + 1], max_t, &near1);
+            if (hit0 && hit1)
+            {
+                bool swap = near1 < near0;
+                stack[top] = node.first + (swap ? 0 : 1);
+                distances[top++] = swap ? near0 : near1;
+                index = node.first + (swap ? 1 : 0);
+                continue;
+            }
+            if (hit0 || hit1)
+            {
+                index = node.first + (hit0 ? 0 : 1);
+                continue;
+            }
+        }
+
+        // Pop the next subtree that can still hold a closer hit
+        while (top > 0 && distances[top - 1] > max_t)
+            top--;
+        if (top == 0)
+            break;
+        index = stack[--top];
+    }
+
+    if (found < 0)
+        return false;
+    hit->triangle = (int)bvh.ids[found];
+    return true;
+}
+
+bool RaycastBvh(const Bvh& bvh, Ray ray, RayHit* hit, float max_t)
+{
+    *hit = RayHit();
+    return TraceRay(bvh, ray, max_t, false, hit);
+}
+
+bool OccludedBvh(const Bvh& bvh, Ray ray, float max_t)
+{
+    RayHit hit;
+    return TraceRay(bvh, ray, max_t, true, &hit);
+}
+
+#if BVH_SSE2
+// Four rays, one per lane
+struct RayPacket
+{
+    __m128 ox, oy, oz;
+    __m128 dx, dy, dz;
+    __m128 ix, iy, iz;
+    __m128 t, u, v;
+    int triangles[4];
+    int active;             // Lanes holding a ray
+};
+
+// Returns the lanes whose rays enter the box before their current closest hit; near gets their entry distances
+// (BVH_FAR in the other lanes)
+static int IntersectBoxPacket(const RayPacket& packet, const BvhNode& node, __m128* near)
+{
+    __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min[0]), packet.ox), packet.ix);
+    __m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max[0]), packet.ox), packet.ix);
+    __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min[1]), packet.oy), packet.iy);
+    __m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max[1]), packet.oy), packet.iy);
+    __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min[2]), packet.oz), packet.iz);
+    __m128 tz2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max[2]), packet.oz), packet.iz);
+    __m128 lo = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_max_ps(_mm_min_ps(tz1, tz2), _mm_setzero_ps()));
+    __m128 hi = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_min_ps(_mm_max_ps(tz1, tz2), packet.t));
+    __m128 hit = _mm_cmple_ps(lo, hi);
+    *near = _mm_or_ps(_mm_and_ps(hit, lo), _mm_andnot_ps(hit, _mm_set1_ps(BVH_FAR)));
+    return _mm_movemask_ps(hit) & packet.active;
+}
+
+static void IntersectTrianglePacket(RayPacket* packet, const BvhTriangle& triangle, int index)
+{
+    __m128 e1x = _mm_set1_ps(triangle.e1.x), e1y = _mm_set1_ps(triangle.e1.y), e1z = _mm_set1_ps(triangle.e1.z);
+    __m128 e2x = _mm_set1_ps(triangle.e2.x), e2y = _mm_set1_ps(triangle.e2.y), e2z = _mm_set1_ps(triangle.e2.z);
+
+    // p = d x e2, det = e1 . p
+    __m128 px = _mm_sub_ps(_mm_mul_ps(packet->dy, e2z), _mm_mul_ps(packet->dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(packet->dz, e2x), _mm_mul_ps(packet->dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(packet->dx, e2y), _mm_mul_ps(packet->dy, e2x));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    __m128 sx = _mm_sub_ps(packet->ox, _mm_set1_ps(triangle.v0.x));
+    __m128 sy = _mm_sub_ps(packet->oy, _mm_set1_ps(triangle.v0.y));
+    __m128 sz = _mm_sub_ps(packet->oz, _mm_set1_ps(triangle.v0.z));
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv_det);
+
+    // q = s x e1
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(packet->dx, qx), _mm_mul_ps(packet->dy, qy)), _mm_mul_ps(packet->dz, qz)), inv_det);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv_det);
+
+    // A zero determinant makes everything infinite or NaN, which fails these comparisons
+    const __m128 zero = _mm_setzero_ps();
+    __m128 mask = _mm_and_ps(_mm_cmpneq_ps(det, zero), _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+    mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmple_ps(t, packet->t)));
+    int hits = _mm_movemask_ps(mask) & packet->active;
+    if (hits == 0)
+        return;
+
+    packet->t = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, packet->t));
+    packet->u = _mm_or_ps(_mm_and_ps(mask, u), _mm_andnot_ps(mask, packet->u));
+    packet->v = _mm_or_ps(_mm_and_ps(mask, v), _mm_andnot_ps(mask, packet->v));
+    for (int lane = 0; lane < 4; lane++)
+    {
+        if (hits & (1 << lane))
+            packet->triangles[lane] = index;
+    }
+}
+
+// Descends wherever any lane's ray enters a box, nearer child first (by the closest entering lane)
+static void TracePacket(const Bvh& bvh, RayPacket* packet)
+{
+    __m128 near;
+    if (IntersectBoxPacket(*packet, bvh.nodes[0], &near) == 0)
+        return;
+
+    uint32_t stack[BVH_STACK];
+    int top = 0;
+    uint32_t index = 0;
+    for (;;)
+    {
+        const BvhNode& node = bvh.nodes[index];
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; i++)
+                IntersectTrianglePacket(packet, bvh.triangles[i], (int)i);
+        }
+        else
+        {
+            __m128 near0, near1;
+            int mask0 = IntersectBoxPacket(*packet, bvh.nodes[node.first], &near0);
+            int mask1 = IntersectBoxPacket(*packet, bvh.nodes[node.first + 1], &near1);
+            if (mask0 != 0 && mask1 != 0)
+            {
+                near0 = _mm_min_ps(near0, _mm_shuffle_ps(near0, near0, _MM_SHUFFLE(2, 3, 0, 1)));
+                near0 = _mm_min_ps(near0, _mm_shuffle_ps(near0, near0, _MM_SHUFFLE(1, 0, 3, 2)));
+                near1 = _mm_min_ps(near1, _mm_shuffle_ps(near1, near1, _MM_SHUFFLE(2, 3, 0, 1)));
+                near1 = _mm_min_ps(near1, _mm_shuffle_ps(near1, near1, _MM_SHUFFLE(1, 0, 3, 2)));
+                bool swap = _mm_cvtss_f32(near1) < _mm_cvtss_f32(near0);
+                stack[top++] = node.first + (swap ? 0 : 1);
+                index = node.first + (swap ? 1 : 0);
+                continue;
+            }
+            if (mask0 != 0 || mask1 != 0)
+            {
+                index = node.first + (mask0 != 0 ? 0 : 1);
+                continue;
+            }
+        }
+
+        // Pop the next subtree some lane can still find a closer hit in
+        while (top > 0 && IntersectBoxPacket(*packet, bvh.nodes[stack[top - 1]], &near) == 0)
+            top--;
+        if (top == 0)
+            break;
+        index = stack[--top];
+    }
+}
+#endif
+
+void RaycastBvhBatch(const Bvh& bvh, const Ray* rays, RayHit* hits, int count, float max_t)
+{
+#if BVH_SSE2
+    int packets = (count + 3) / 4;
+    ParallelFor(packets, 64, [&](int first, int last)
+    {
+        for (int p = first; p < last; p++)
+        {
+            RayPacket packet;
+            alignas(16) float lanes[12][4];
+            packet.active = 0;
+            for (int lane = 0; lane < 4; lane++)
+            {
+                // Missing lanes repeat the first ray but stay inactive
+                int i = p * 4 + lane;
+                const Ray& ray = rays[i < count ? i : p * 4];
+                packet.active |= (i < count ? 1 : 0) << lane;
+                packet.triangles[lane] = -1;
+                const float values[12] = { ray.origin.x, ray.origin.y, ray.origin.z, ray.direction.x, ray.direction.y, ray.direction.z,
+                    1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z, max_t, 0.0f, 0.0f };
+                for (int k = 0; k < 12; k++)
+                    lanes[k][lane] = values[k];
+            }
+            packet.ox = _mm_load_ps(lanes[0]); packet.oy = _mm_load_ps(lanes[1]); packet.oz = _mm_load_ps(lanes[2]);
+            packet.dx = _mm_load_ps(lanes[3]); packet.dy = _mm_load_ps(lanes[4]); packet.dz = _mm_load_ps(lanes[5]);
+            packet.ix = _mm_load_ps(lanes[6]); packet.iy = _mm_load_ps(lanes[7]); packet.iz = _mm_load_ps(lanes[8]);
+            packet.t = _mm_load_ps(lanes[9]); packet.u = _mm_load_ps(lanes[10]); packet.v = _mm_load_ps(lanes[11]);
+
+            if (!bvh.nodes.empty())
+                TracePacket(bvh, &packet);
+
+            _mm_store_ps(lanes[9], packet.t);
+            _mm_store_ps(lanes[10], packet.u);
+            _mm_store_ps(lanes[11], packet.v);
+            for (int lane = 0; lane < 4 && p * 4 + lane < count; lane++)
+            {
+                RayHit& hit = hits[p * 4 + lane];
+                hit = RayHit();
+                if (packet.triangles[lane] < 0)
+                    continue;
+                hit.t = lanes[9][lane];
+                hit.u = lanes[10][lane];
+                hit.v = lanes[11][lane];
+                hit.triangle = (int)bvh.ids[packet.triangles[lane]];
+            }
+        }
+    });
+#else
+    ParallelFor(count, 256, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+            RaycastBvh(bvh, rays[i], &hits[i], max_t);
+    });
+#endif
+}
+
+Ray ScreenRay(Vector2 position, int width, int height, Matrix view, Matrix proj)
+{
+    // Window y points down, NDC y up
+    float x = 2.0f * position.x / width - 1.0f;
+    float y = 1.0f - 2.0f * position.y / height;
+    Vector3 near = Vector3Unproject({ x, y, -1.0f }, proj, view);
+    Vector3 far = Vector3Unproject({ x, y, 1.0f }, proj, view);
+
+    Ray ray;
+    ray.origin = near;
+    ray.direction = Vector3Normalize(Vector3Subtract(far, near));
+    return ray;
+}
+
+Ray TransformRay(Ray ray, Matrix transform)
+{
+    Matrix linear = transform;
+    linear.m12 = linear.m13 = linear.m14 = 0.0f;
+
+    Ray result;
+    result.origin = Vector3Transform(ray.origin, transform);
+    result.direction = Vector3Transform(ray.direction, linear);
+    return result;
+}
+
+static bool SameHit(const RayHit& a, const RayHit& b)
+{
+    if (a.triangle < 0 || b.triangle < 0)
+        return a.triangle == b.triangle;
+
+    // Rays through a shared edge may report either triangle
+    return fabsf(a.t - b.t) <= 1e-4f * std::max(1.0f, a.t);
+}
+
+void BenchmarkBvh()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    const int slices = 720;
+    const int stacks = 720;
+    const int resolution = 1024;
+
+    Mesh sphere;
+    GenerateMeshSurface(&sphere, MESH_SHAPE_SPHERE, slices, stacks);
+    int threads = JobThreadIndex() >= 0 ? JobThreadCount() : 1;
+    printf("BVH benchmark (%.2fM triangle sphere, %i threads):\n", sphere.indices.size() / 3 / 1e6, threads);
+
+    // Built from a thread the job system doesn't own, the same build runs serially
+    Bvh bvh;
+    double serial_ms = 0.0;
+    std::thread serial([&]()
+    {
+        BuildBvh(&bvh, sphere);
+        serial_ms = bvh.build_ms;
+    });
+    serial.join();
+    BuildBvh(&bvh, sphere);
+
+    BvhStats stats = GetBvhStats(bvh);
+    printf("  build: %.1f ms (serial %.1f ms, %.1fx)  nodes: %i  leaves: %i  depth: %i  SAH cost: %.1f\n",
+        stats.build_ms, serial_ms, serial_ms / stats.build_ms, stats.nodes, stats.leaves, stats.depth, stats.sah_cost);
+
+    // Primary rays of a 1024x1024 view from z = 3 (in 2x2 pixel quads, so packets are coherent), and rays between
+    // random points around the sphere in random directions
+    std::vector<Ray> coherent((size_t)resolution * resolution);
+    Matrix view = MatrixLookAt({ 0.0f, 0.0f, 3.0f }, Vector3Zeros, { 0.0f, 1.0f, 0.0f });
+    Matrix proj = MatrixPerspective(45.0f * DEG2RAD, 1.0f, 0.1f, 100.0f);
+    for (int y = 0; y < resolution; y += 2)
+    {
+        for (int x = 0; x < resolution; x += 2)
+        {
+            Ray* quad = &coherent[((size_t)y * resolution + x * 2)];
+            for (int i = 0; i < 4; i++)
+                quad[i] = ScreenRay({ x + (i & 1) + 0.5f, y + (i >> 1) + 0.5f }, resolution, resolution, view, proj);
+        }
+    }
+
+    std::vector<Ray> random(coherent.size());
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (Ray& ray : random)
+    {
+        ray.origin = Vector3Scale({ unit(rng), unit(rng), unit(rng) }, 2.0f);
+        ray.direction = Vector3Normalize({ unit(rng), unit(rng), unit(rng) + 1e-3f });
+    }
+
+    struct RaySet
+    {
+        const char* name;
+        const std::vector<Ray>* rays;
+    };
+    const RaySet sets[] = { { "coherent", &coherent }, { "random", &random } };
+    for (const RaySet& set : sets)
+    {
+        const std::vector<Ray>& rays = *set.rays;
+        int count = (int)rays.size();
+        std::vector<RayHit> single(count);
+        std::vector<RayHit> packets(count);
+
+        auto begin = Clock::now();
+        int hit_count = 0;
+        for (int i = 0; i < count; i++)
+            hit_count += RaycastBvh(bvh, rays[i], &single[i]);
+        double single_s = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        begin = Clock::now();
+        int occluded = 0;
+        for (int i = 0; i < count; i++)
+            occluded += OccludedBvh(bvh, rays[i], BVH_FAR);
+        double occluded_s = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        begin = Clock::now();
+        ParallelFor(count, 1024, [&](int first, int last)
+        {
+            for (int i = first; i < last; i++)
+                RaycastBvh(bvh, rays[i], &single[i]);
+        });
+        double parallel_s = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        begin = Clock::now();
+        RaycastBvhBatch(bvh, rays.data(), packets.data(), count);
+        double packet_s = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        int mismatches = occluded != hit_count ? 1 : 0;
+        for (int i = 0; i < count; i++)
+            mismatches += !SameHit(single[i], packets[i]);
+
+        printf("  %-8s %4.1f%% hit  1 thread: %6.2f Mrays/s (occlusion %6.2f)  %i threads: %6.2f Mrays/s  packets: %6.2f Mrays/s%s\n",
+            set.name, 100.0 * hit_count / count, count / single_s / 1e6, count / occluded_s / 1e6, threads,
+            count / parallel_s / 1e6, count / packet_s / 1e6, mismatches > 0 ? "  <- MISMATCH" : "");
+        if (mismatches > 0)
+            printf("    %i rays differ between single & packet traversal\n", mismatches);
+    }
+
+    // Brute force over every triangle for a handful of the random rays
+    MeshStreams geometry = MeshGeometry(sphere);
+    int brute_mismatches = 0;
+    const int brute_rays = 64;
+    for (int r = 0; r < brute_rays; r++)
+    {
+        const Ray& ray = random[r * 997];
+        RayHit closest;
+        for (int i = 0; i < geometry.index_count / 3; i++)
+        {
+            Vector3 a = geometry.positions[geometry.indices[i * 3 + 0]];
+            Vector3 b = geometry.positions[geometry.indices[i * 3 + 1]];
+            Vector3 c = geometry.positions[geometry.indices[i * 3 + 2]];
+            BvhTriangle triangle = { a, Vector3Subtract(b, a), Vector3Subtract(c, a) };
+            RayHit candidate;
+            if (IntersectTriangle(triangle, ray.origin, ray.direction, closest.triangle < 0 ? BVH_FAR : closest.t, &candidate))
+            {
+                closest = candidate;
+                closest.triangle = i;
+            }
+        }
+
+        RayHit hit;
+        RaycastBvh(bvh, ray, &hit);
+        brute_mismatches += !SameHit(hit, closest);
+    }
+    printf("  brute force: %i of %i rays differ\n", brute_mismatches, brute_rays);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Mesh.h"
+
+// Bounding volume hierarchy over a mesh's triangles, for picking & line-of-sight queries on the CPU.
+// Built top-down with binned SAH (surface area heuristic): large nodes bin & partition in parallel and their
+// subtrees build as jobs. Nodes are 32 bytes, a node's children are adjacent, and triangles are copied into leaf
+// order as (vertex, edge, edge) so the Möller-Trumbore test reads one contiguous record.
+// Single rays test boxes with SSE across x/y/z; batches go through 4-ray packets (one ray per SSE lane) that
+// share a traversal and test each box & triangle for all four rays at once.
+
+struct Ray
+{
+	Vector3 origin = Vector3Zeros;
+	Vector3 direction = { 0.0f, 0.0f, -1.0f };	// Needn't be normalized; hit distances are in its units
+};
+
+struct RayHit
+{
+	float t = 0.0f;			// origin + direction * t
+	float u = 0.0f;			// Barycentrics of the hit: weight of the triangle's second & third vertex
+	float v = 0.0f;
+	int triangle = -1;		// Mesh triangle (index / 3); -1 on a miss
+};
+
+// Leaves: count > 0 triangles from first. Interior: count == 0, children at first & first + 1.
+struct BvhNode
+{
+	float min[3];
+	uint32_t first;
+	float max[3];
+	uint32_t count;
+};
+
+struct BvhTriangle
+{
+	Vector3 v0;
+	Vector3 e1;		// v1 - v0
+	Vector3 e2;		// v2 - v0
+};
+
+struct Bvh
+{
+	std::vector<BvhNode> nodes;				// Root first
+	std::vector<BvhTriangle> triangles;		// Leaf order
+	std::vector<uint32_t> ids;				// Mesh triangle of each
+	double build_ms = 0.0;					// Last BuildBvh
+};
+
+struct BvhStats
+{
+	int triangles = 0;
+	int nodes = 0;
+	int leaves = 0;
+	int depth = 0;
+	float sah_cost = 0.0f;		// Expected cost of a random ray, in triangle tests
+	double build_ms = 0.0;
+};
+
+// From the mesh's CPU geometry (MeshGeometry); non-indexed meshes are read as consecutive vertex triples
+void BuildBvh(Bvh* bvh, const Mesh& mesh);
+void BuildBvh(Bvh* bvh, const Vector3* positions, const uint32_t* indices, int triangle_count);
+void DestroyBvh(Bvh* bvh);
+
+BvhStats GetBvhStats(const Bvh& bvh);
+
+// Closest hit within (0, max_t]
+bool RaycastBvh(const Bvh& bvh, Ray ray, RayHit* hit, float max_t = 3.402823466e+38f);
+
+// Any hit within (0, max_t]: cheaper than RaycastBvh, for line-of-sight
+bool OccludedBvh(const Bvh& bvh, Ray ray, float max_t);
+
+// Closest hits of count rays, traced as 4-ray packets spread across the job system.
+// Rays that start together & point the same way (a screen region, a bundle of probes) share most of their work.
+void RaycastBvhBatch(const Bvh& bvh, const Ray* rays, RayHit* hits, int count, float max_t = 3.402823466e+38f);
+
+// World-space ray through a window position (pixels, top-left origin) for a camera's view & projection
+Ray ScreenRay(Vector2 position, int width, int height, Matrix view, Matrix proj);
+
+// Into another space (e.g. by a mesh's inverse world matrix). The direction isn't renormalized, so hit distances
+// in the new space are still distances along the original ray.
+Ray TransformRay(Ray ray, Matrix transform);
+
+// Builds a 1M+ triangle sphere and prints build time & tree quality, then Mrays/s for coherent & random rays
+// (single, occlusion, packets) checked against each other & a brute-force reference (no GL needed)
+void BenchmarkBvh();
@@ -0,0 +1,357 @@
+#include "Capture.h"
+#include "Image.h"
+#include "Window.h"
+#include <glad/glad.h>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One readback target; busy while its fence is set
+struct CaptureSlot
+{
+    GLuint pbo = GL_NONE;
+    size_t size = 0;
+    GLsync fence = nullptr;
+    int width = 0;
+    int height = 0;
+    std::string path;
+    CaptureFormat format = CAPTURE_FORMAT_PNG;
+};
+
+struct CaptureRequest
+{
+    std::string path;
+    CaptureFormat format;
+};
+
+// Pixels as glReadPixels returns them: bottom row first, as in every Image
+struct CaptureJob
+{
+    Image image;
+    std::string path;
+    CaptureFormat format;
+};
+
+struct FrameCapture
+{
+    std::vector<CaptureSlot> slots;
+    int next = 0;               // Round robin, so slots also retire in this order
+    std::vector<CaptureRequest> requests;
+
+    std::string sequence_path;
+    CaptureFormat sequence_format = CAPTURE_FORMAT_PNG;
+    int sequence_frame = 0;
+    int sequence_count = -1;
+    bool sequence = false;
+
+    // Shared with the writer thread
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<CaptureJob> jobs;
+    std::vector<Image> free_images;     // Recycled, so a steady sequence doesn't allocate
+    size_t queued_bytes = 0;
+    size_t max_queued_bytes = 0;
+    double write_ms = 0.0;              // Total
+    bool quit = false;
+
+    CaptureStats stats;
+};
+
+static FrameCapture f_capture;
+
+static bool WriteCapture(CaptureJob* job)
+{
+    std::filesystem::path directory = std::filesystem::path(job->path).parent_path();
+    if (!directory.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+    }
+
+    // Images are bottom-up like GL's readback; every format here stores the top row first
+    const Image& image = job->image;
+    if (job->format == CAPTURE_FORMAT_PNG)
+        return SaveImage(job->path.c_str(), image);
+
+    FILE* file = fopen(job->path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        printf("Failed to save capture: %s\n", job->path.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    if (job->format == CAPTURE_FORMAT_PPM)
+    {
+        fprintf(file, "P6\n%i %i\n255\n", image.width, image.height);
+        std::vector<uint8_t> rgb((size_t)image.width * 3);
+        for (int y = image.height - 1; y >= 0 && ok; y--)
+        {
+            const Color* src = image.pixels + (size_t)y * image.width;
+            for (int x = 0; x < image.width; x++)
+            {
+                rgb[x * 3 + 0] = src[x].r;
+                rgb[x * 3 + 1] = src[x].g;
+                rgb[x * 3 + 2] = src[x].b;
+            }
+            ok = fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+        }
+    }
+    else
+    {
+        size_t row_bytes = (size_t)image.width * sizeof(Color);
+        for (int y = image.height - 1; y >= 0 && ok; y--)
+            ok = fwrite(image.pixels + (size_t)y * image.width, 1, row_bytes, file) == row_bytes;
+    }
+
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+        printf("Failed to write capture: %s\n", job->path.c_str());
+    return ok;
+}
+
+static void WriterMain()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    std::unique_lock<std::mutex> lock(f_capture.mutex);
+    for (;;)
+    {
+        f_capture.wake.wait(lock, [] { return f_capture.quit || !f_capture.jobs.empty(); });
+        if (f_capture.jobs.empty())
+            return;
+
+        CaptureJob job = std::move(f_capture.jobs.front());
+        f_capture.jobs.pop_front();
+        lock.unlock();
+
+        auto begin = Clock::now();
+        bool ok = WriteCapture(&job);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+        lock.lock();
+        f_capture.queued_bytes -= (size_t)job.image.width * job.image.height * sizeof(Color);
+        f_capture.write_ms += ms;
+        if (ok)
+            f_capture.stats.written++;
+        else
+            f_capture.stats.failed++;
+        f_capture.free_images.push_back(job.image);
+    }
+}
+
+void CreateFrameCapture(int ring_size, size_t max_queued_bytes)
+{
+    assert(f_capture.slots.empty() && ring_size > 0);
+    f_capture.slots.resize(ring_size);
+    for (CaptureSlot& slot : f_capture.slots)
+        glGenBuffers(1, &slot.pbo);
+    f_capture.max_queued_bytes = max_queued_bytes;
+    f_capture.quit = false;
+    f_capture.writer = std::thread(WriterMain);
+}
+
+// Maps a finished readback and queues it for the writer (or drops it if the writer is too far behind)
+static void RetireSlot(CaptureSlot* slot)
+{
+    glDeleteSync(slot->fence);
+    slot->fence = nullptr;
+    size_t bytes = (size_t)slot->width * slot->height * sizeof(Color);
+
+    Image image;
+    {
+        std::lock_guard<std::mutex> lock(f_capture.mutex);
+        if (f_capture.queued_bytes + bytes > f_capture.max_queued_bytes)
+        {
+            f_capture.stats.dropped++;
+            return;
+        }
+        f_capture.queued_bytes += bytes;
+
+        // Any pooled image of the right size; others are kept for when the window goes back to their size
+        for (size_t i = 0; i < f_capture.free_images.size(); i++)
+        {
+            if (f_capture.free_images[i].width == slot->width && f_capture.free_images[i].height == slot->height)
+            {
+                image = f_capture.free_images[i];
+                f_capture.free_images[i] = f_capture.free_images.back();
+                f_capture.free_images.pop_back();
+                break;
+            }
+        }
+    }
+    if (image.pixels == nullptr)
+        LoadImage(&image, slot->width, slot->height);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    if (pixels != nullptr)
+        memcpy(image.pixels, pixels, bytes);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+
+    {
+        std::lock_guard<std::mutex> lock(f_capture.mutex);
+        if (pixels == nullptr)
+        {
+            f_capture.queued_bytes -= bytes;
+            f_capture.free_images.push_back(image);
+            f_capture.stats.failed++;
+            return;
+        }
+        f_capture.jobs.push_back({ image, std::move(slot->path), slot->format });
+    }
+    f_capture.wake.notify_one();
+}
+
+// Oldest first; stops at the first readback still running, since later ones were issued after it.
+// timeout_ns 0 polls, anything else waits (shutdown only).
+static void RetireReadbacks(GLuint64 timeout_ns)
+{
+    int count = (int)f_capture.slots.size();
+    for (int i = 0; i < count; i++)
+    {
+        CaptureSlot& slot = f_capture.slots[(f_capture.next + i) % count];
+        if (slot.fence == nullptr)
+            continue;
+
+        GLbitfield flags = timeout_ns > 0 ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+        GLenum status = glClientWaitSync(slot.fence, flags, timeout_ns);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        RetireSlot(&slot);
+    }
+}
+
+void DestroyFrameCapture()
+{
+    // Whatever is still in flight gets written; a second is far longer than any readback takes
+    RetireReadbacks(1000000000);
+
+    {
+        std::lock_guard<std::mutex> lock(f_capture.mutex);
+        f_capture.quit = true;
+    }
+    f_capture.wake.notify_one();
+    f_capture.writer.join();
+
+    for (CaptureSlot& slot : f_capture.slots)
+    {
+        if (slot.fence != nullptr)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.pbo);
+    }
+    for (Image& image : f_capture.free_images)
+        UnloadImage(&image);
+
+    f_capture.slots.clear();
+    f_capture.free_images.clear();
+    f_capture.requests.clear();
+    f_capture.queued_bytes = 0;
+    f_capture.write_ms = 0.0;
+    f_capture.sequence = false;
+    f_capture.stats = CaptureStats();
+}
+
+void CaptureFrame(const char* path, CaptureFormat format)
+{
+    f_capture.requests.push_back({ path, format });
+}
+
+void StartCaptureSequence(const char* path_format, CaptureFormat format, int frame_count)
+{
+    f_capture.sequence_path = path_format;
+    f_capture.sequence_format = format;
+    f_capture.sequence_frame = 0;
+    f_capture.sequence_count = frame_count;
+    f_capture.sequence = frame_count != 0;
+}
+
+void StopCaptureSequence()
+{
+    f_capture.sequence = false;
+}
+
+bool CaptureSequenceActive()
+{
+    return f_capture.sequence;
+}
+
+static void IssueReadback(std::string path, CaptureFormat format)
+{
+    f_capture.stats.requested++;
+    CaptureSlot& slot = f_capture.slots[f_capture.next];
+    int width = WindowWidth();
+    int height = WindowHeight();
+
+    // The GPU is a whole ring behind (or the window is minimized): skip rather than wait
+    if (slot.fence != nullptr || width <= 0 || height <= 0)
+    {
+        f_capture.stats.dropped++;
+        return;
+    }
+
+    size_t bytes = (size_t)width * height * sizeof(Color);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.size != bytes)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        slot.size = bytes;
+    }
+
+    // Into the buffer, not client memory, so this returns without waiting for the frame to finish
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, GL_NONE);
+    glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.path = std::move(path);
+    slot.format = format;
+    f_capture.next = (f_capture.next + 1) % (int)f_capture.slots.size();
+}
+
+void UpdateFrameCapture()
+{
+    assert(!f_capture.slots.empty());
+    RetireReadbacks(0);
+
+    for (CaptureRequest& request : f_capture.requests)
+        IssueReadback(std::move(request.path), request.format);
+    f_capture.requests.clear();
+
+    // Numbered by frame, so dropped frames show up as gaps
+    if (f_capture.sequence)
+    {
+        char path[512];
+        snprintf(path, sizeof(path), f_capture.sequence_path.c_str(), f_capture.sequence_frame++);
+        IssueReadback(path, f_capture.sequence_format);
+        if (f_capture.sequence_count > 0 && f_capture.sequence_frame >= f_capture.sequence_count)
+            f_capture.sequence = false;
+    }
+
+    f_capture.stats.in_flight = 0;
+    for (const CaptureSlot& slot : f_capture.slots)
+        f_capture.stats.in_flight += slot.fence != nullptr;
+}
+
+CaptureStats GetCaptureStats()
+{
+    std::lock_guard<std::mutex> lock(f_capture.mutex);
+    CaptureStats stats = f_capture.stats;
+    stats.queued = (int)f_capture.jobs.size();
+    uint64_t done = stats.written + stats.failed;
+    stats.write_ms = done > 0 ? f_capture.write_ms / done : 0.0;
+    return stats;
+}
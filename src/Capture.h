@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Frame capture without stalling: the backbuffer is read into a ring of pixel-pack buffers with glReadPixels,
+// each followed by a fence. A few frames later, once a fence has signalled, the buffer is mapped, copied into
+// a pooled image and handed to a writer thread that flips & encodes it. If every buffer is still in flight,
+// or the writer falls too far behind, the frame is dropped and counted rather than waited for.
+
+enum CaptureFormat
+{
+	CAPTURE_FORMAT_PNG,		// SaveImage (stored deflate: large files, cheap to encode)
+	CAPTURE_FORMAT_PPM,		// Binary P6, RGB
+	CAPTURE_FORMAT_RAW,		// RGBA8 rows, top row first, no header
+	CAPTURE_FORMAT_COUNT
+};
+
+struct CaptureStats
+{
+	uint64_t requested = 0;		// Frames asked for
+	uint64_t written = 0;
+	uint64_t dropped = 0;		// Every buffer in flight, or the writer's queue full
+	uint64_t failed = 0;		// Couldn't open or write the file
+	int in_flight = 0;			// Readbacks the GPU hasn't finished
+	int queued = 0;				// Frames waiting for the writer
+	double write_ms = 0.0;		// Writer's average flip + encode + write per frame
+};
+
+// ring_size readbacks may be in flight at once; max_queued_bytes bounds the writer's backlog
+void CreateFrameCapture(int ring_size = 3, size_t max_queued_bytes = 256 * 1024 * 1024);
+
+// Finishes outstanding readbacks and writes before returning
+void DestroyFrameCapture();
+
+// The next UpdateFrameCapture's frame, written to path
+void CaptureFrame(const char* path, CaptureFormat format);
+
+// Every frame from the next UpdateFrameCapture on, until stopped or frame_count frames (-1 = no limit).
+// path_format is a printf pattern taking the sequence's frame number, e.g. "./captures/frame_%05d.png";
+// missing directories are created.
+void StartCaptureSequence(const char* path_format, CaptureFormat format, int frame_count = -1);
+void StopCaptureSequence();
+bool CaptureSequenceActive();
+
+// Main thread, once per frame once the scene is in the backbuffer (before the GUI & swap): issues this frame's
+// readback if one is due and passes finished readbacks to the writer
+void UpdateFrameCapture();
+
+CaptureStats GetCaptureStats();
@@ -0,0 +1,316 @@
+#include "DrawList.h"
+#include "Jobs.h"
+#include "Memory.h"
+#include "Shader.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Starting capacity per thread; buffers double when a frame records more
+constexpr size_t DRAW_LIST_INITIAL_BYTES = 64 * 1024;
+
+struct DrawRef
+{
+    uint64_t key;
+    uint32_t list;
+    uint32_t offset;
+};
+
+static std::vector<DrawList> f_draw_lists;
+static DrawListStats f_draw_stats;
+
+void CreateDrawLists()
+{
+    assert(f_draw_lists.empty() && JobThreadCount() > 0);
+    f_draw_lists.resize(JobThreadCount());
+    for (DrawList& list : f_draw_lists)
+        list.buffer.resize(DRAW_LIST_INITIAL_BYTES);
+}
+
+void DestroyDrawLists()
+{
+    f_draw_lists.clear();
+}
+
+void ResetDrawLists()
+{
+    for (DrawList& list : f_draw_lists)
+    {
+        list.used = 0;
+        list.packet_count = 0;
+    }
+}
+
+static DrawList& ThreadDrawList()
+{
+    int index = JobThreadIndex();
+    assert(index >= 0 && index < (int)f_draw_lists.size() && "Draws can only be recorded from job system threads");
+    return f_draw_lists[index];
+}
+
+static uint8_t* Allocate(DrawList* list, size_t bytes)
+{
+    if (list->used + bytes > list->buffer.size())
+        list->buffer.resize(std::max(list->buffer.size() * 2, list->used + bytes));
+
+    uint8_t* memory = list->buffer.data() + list->used;
+    list->used += bytes;
+    return memory;
+}
+
+void RecordDraw(GLuint program, const Mesh& mesh, const Texture* texture, uint8_t layer)
+{
+    DrawList& list = ThreadDrawList();
+    list.last = list.used;
+    list.packet_count++;
+
+    DrawPacket* packet = reinterpret_cast<DrawPacket*>(Allocate(&list, sizeof(DrawPacket)));
+    packet->program = program;
+    packet->vao = mesh.vao;
+    packet->texture = texture != nullptr ? texture->id : GL_NONE;
+    packet->texture_target = texture != nullptr ? texture->target : GL_NONE;
+    packet->vertex_count = mesh.vertex_count;
+    packet->indexed = mesh.ibo != GL_NONE;
+    packet->uniform_count = 0;
+
+    // GL names are small sequential integers, so 16-24 bits each keeps them distinct in practice
+    packet->key =
+        (uint64_t)layer << 56 |
+        (uint64_t)(program & 0xFFFF) << 40 |
+        (uint64_t)(packet->texture & 0xFFFF) << 24 |
+        (uint64_t)(packet->vao & 0xFFFFFF);
+}
+
+static DrawUniform* RecordUniform(const char* name, DrawUniformType type)
+{
+    DrawList& list = ThreadDrawList();
+    assert(list.packet_count > 0 && "Record a draw before its uniforms");
+
+    DrawUniform* uniform = reinterpret_cast<DrawUniform*>(Allocate(&list, sizeof(DrawUniform)));
+    uniform->name = name;
+    uniform->type = type;
+    reinterpret_cast<DrawPacket*>(list.buffer.data() + list.last)->uniform_count++;
+    return uniform;
+}
+
+void RecordInt(int value, const char* name)
+{
+    RecordUniform(name, DRAW_UNIFORM_INT)->i = value;
+}
+
+void RecordFloat(float value, const char* name)
+{
+    RecordUniform(name, DRAW_UNIFORM_FLOAT)->f = value;
+}
+
+void RecordVec2(Vector2 value, const char* name)
+{
+    RecordUniform(name, DRAW_UNIFORM_VEC2)->v2 = value;
+}
+
+void RecordVec3(Vector3 value, const char* name)
+{
+    RecordUniform(name, DRAW_UNIFORM_VEC3)->v3 = value;
+}
+
+void RecordVec4(Vector4 value, const char* name)
+{
+    RecordUniform(name, DRAW_UNIFORM_VEC4)->v4 = value;
+}
+
+void RecordMat3(Matrix value, const char* name)
+{
+    RecordUniform(name, DRAW_UNIFORM_MAT3)->m = value;
+}
+
+void RecordMat4(Matrix value, const char* name)
+{
+    RecordUniform(name, DRAW_UNIFORM_MAT4)->m = value;
+}
+
+// Gathers every thread's packets into an array from arena, sorted by key then (thread, recording order)
+static int MergeDrawLists(Arena* arena, DrawRef** order)
+{
+    int count = 0;
+    for (const DrawList& list : f_draw_lists)
+        count += list.packet_count;
+    *order = ArenaAllocArray<DrawRef>(arena, count);
+
+    int next = 0;
+    for (uint32_t l = 0; l < (uint32_t)f_draw_lists.size(); l++)
+    {
+        const DrawList& list = f_draw_lists[l];
+        size_t offset = 0;
+        for (int p = 0; p < list.packet_count; p++)
+        {
+            const DrawPacket* packet = reinterpret_cast<const DrawPacket*>(list.buffer.data() + offset);
+            (*order)[next++] = { packet->key, l, (uint32_t)offset };
+            offset += sizeof(DrawPacket) + packet->uniform_count * sizeof(DrawUniform);
+        }
+    }
+
+    // (thread, offset) breaks ties in recording order, as a stable sort would, without stable_sort's heap buffer
+    std::sort(*order, *order + count, [](const DrawRef& a, const DrawRef& b)
+    {
+        if (a.key != b.key)
+            return a.key < b.key;
+        return a.list != b.list ? a.list < b.list : a.offset < b.offset;
+    });
+    return count;
+}
+
+static void SendUniform(const DrawUniform& uniform)
+{
+    switch (uniform.type)
+    {
+    case DRAW_UNIFORM_INT:
+        SendInt(uniform.i, uniform.name);
+        break;
+
+    case DRAW_UNIFORM_FLOAT:
+        SendFloat(uniform.f, uniform.name);
+        break;
+
+    case DRAW_UNIFORM_VEC2:
+        SendVec2(uniform.v2, uniform.name);
+        break;
+
+    case DRAW_UNIFORM_VEC3:
+        SendVec3(uniform.v3, uniform.name);
+        break;
+
+    case DRAW_UNIFORM_VEC4:
+        SendVec4(uniform.v4, uniform.name);
+        break;
+
+    case DRAW_UNIFORM_MAT3:
+        SendMat3(uniform.m, uniform.name);
+        break;
+
+    case DRAW_UNIFORM_MAT4:
+        SendMat4(uniform.m, uniform.name);
+        break;
+
+    default:
+        assert(false);
+        break;
+    }
+}
+
+void SubmitDrawLists()
+{
+    // Sort order is a frame temporary
+    DrawRef* order;
+    int count = MergeDrawLists(FrameArena(), &order);
+
+    DrawListStats stats;
+    GLuint program = GL_NONE;
+    Texture texture;
+
+    for (int i = 0; i < count; i++)
+    {
+        const DrawRef& ref = order[i];
+        const uint8_t* memory = f_draw_lists[ref.list].buffer.data() + ref.offset;
+        const DrawPacket& packet = *reinterpret_cast<const DrawPacket*>(memory);
+        const DrawUniform* uniforms = reinterpret_cast<const DrawUniform*>(memory + sizeof(DrawPacket));
+
+        if (packet.program != program)
+        {
+            if (program != GL_NONE)
+                EndShader();
+            program = packet.program;
+            BeginShader(program);
+            stats.program_binds++;
+        }
+
+        if (packet.texture != texture.id)
+        {
+            if (texture.id != GL_NONE)
+                EndTexture();
+            texture.id = packet.texture;
+            texture.target = packet.texture_target;
+            if (texture.id != GL_NONE)
+            {
+                BeginTexture(texture);
+                stats.texture_binds++;
+            }
+        }
+
+        for (int u = 0; u < packet.uniform_count; u++)
+            SendUniform(uniforms[u]);
+        DrawVertexArray(packet.vao, packet.vertex_count, packet.indexed != 0);
+
+        stats.packets++;
+        stats.uniforms += packet.uniform_count;
+    }
+
+    if (texture.id != GL_NONE)
+        EndTexture();
+    if (program != GL_NONE)
+        EndShader();
+
+    for (const DrawList& list : f_draw_lists)
+        stats.bytes += list.used;
+    f_draw_stats = stats;
+    ResetDrawLists();
+}
+
+DrawListStats GetDrawListStats()
+{
+    return f_draw_stats;
+}
+
+void BenchmarkDrawLists()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    const int count = 100000;
+    const int iterations = 10;
+
+    // Fake handles: recording never touches GL. Each chunk gets its own Mesh so jobs don't share one.
+    auto record = [](int begin, int end)
+    {
+        Mesh mesh;
+        mesh.ibo = 1;
+        mesh.vertex_count = 36;
+        for (int i = begin; i < end; i++)
+        {
+            mesh.vao = 1 + (i & 63);
+            RecordDraw(1 + (i & 7), mesh, nullptr);
+            RecordMat4(MatrixTranslate((float)i, 0.0f, 0.0f), "u_mvp");
+            RecordVec4({ 1.0f, 1.0f, 1.0f, 1.0f }, "u_color");
+        }
+    };
+
+    ResetDrawLists();
+    record(0, count);   // Warm up: buffers grow once
+    ResetDrawLists();
+
+    double serial = 0.0;
+    double parallel = 0.0;
+    double merge = 0.0;
+    for (int i = 0; i < iterations; i++)
+    {
+        auto begin = Clock::now();
+        record(0, count);
+        serial += std::chrono::duration<double>(Clock::now() - begin).count();
+        ResetDrawLists();
+
+        begin = Clock::now();
+        ParallelFor(count, 1024, record);
+        parallel += std::chrono::duration<double>(Clock::now() - begin).count();
+
+        ArenaScope scope(ScratchArena());
+        DrawRef* order;
+        begin = Clock::now();
+        MergeDrawLists(scope.arena, &order);
+        merge += std::chrono::duration<double>(Clock::now() - begin).count();
+        ResetDrawLists();
+    }
+
+    printf("Draw list benchmark (%i packets, %i threads):\n", count, JobThreadCount());
+    printf("  record 1 thread: %8.3f ms\n", serial / iterations * 1e3);
+    printf("  record parallel: %8.3f ms  (%.2fx)\n", parallel / iterations * 1e3, serial / parallel);
+    printf("  merge + sort:    %8.3f ms\n", merge / iterations * 1e3);
+}
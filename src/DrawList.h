@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include "raymath.h"
+#include "Mesh.h"
+#include "Texture.h"
+
+// Draw recording that doesn't need the GL context: any job system thread appends packets
+// (program, VAO, texture, counts + uniforms) to its own linear buffer, then the main thread
+// merges every buffer in key order and replays them, skipping redundant program/texture binds.
+
+enum DrawUniformType
+{
+	DRAW_UNIFORM_INT,
+	DRAW_UNIFORM_FLOAT,
+	DRAW_UNIFORM_VEC2,
+	DRAW_UNIFORM_VEC3,
+	DRAW_UNIFORM_VEC4,
+	DRAW_UNIFORM_MAT3,
+	DRAW_UNIFORM_MAT4,
+	DRAW_UNIFORM_TYPE_COUNT
+};
+
+// name must outlive the frame (string literals)
+struct DrawUniform
+{
+	const char* name;
+	DrawUniformType type;
+	union
+	{
+		int i;
+		float f;
+		Vector2 v2;
+		Vector3 v3;
+		Vector4 v4;
+		Matrix m;
+	};
+};
+
+// Followed in its buffer by uniform_count DrawUniforms
+struct DrawPacket
+{
+	uint64_t key;		// Replay order; see RecordDraw
+	GLuint program;
+	GLuint vao;
+	GLuint texture;
+	GLenum texture_target;
+	int vertex_count;
+	int indexed;
+	int uniform_count;
+};
+
+// One per job system thread. Reset keeps the memory, so steady-state recording doesn't allocate.
+struct DrawList
+{
+	std::vector<uint8_t> buffer;
+	size_t used = 0;
+	size_t last = 0;	// Offset of the packet uniforms attach to
+	int packet_count = 0;
+};
+
+struct DrawListStats
+{
+	int packets = 0;
+	int uniforms = 0;
+	int program_binds = 0;
+	int texture_binds = 0;
+	size_t bytes = 0;
+};
+
+void CreateDrawLists();		// After CreateJobSystem
+void DestroyDrawLists();
+
+// Main thread, once no recording is in flight (start of frame)
+void ResetDrawLists();
+
+// Packets replay sorted by (layer, program, texture, vao); equal keys keep recording order per thread.
+// texture may be nullptr.
+void RecordDraw(GLuint program, const Mesh& mesh, const Texture* texture, uint8_t layer = 0);
+
+// Attach to the calling thread's last RecordDraw
+void RecordInt(int value, const char* name);
+void RecordFloat(float value, const char* name);
+void RecordVec2(Vector2 value, const char* name);
+void RecordVec3(Vector3 value, const char* name);
+void RecordVec4(Vector4 value, const char* name);
+void RecordMat3(Matrix value, const char* name);
+void RecordMat4(Matrix value, const char* name);
+
+// Main thread: sorts every thread's packets, then issues them (DrawMesh-equivalent) and resets the lists
+void SubmitDrawLists();
+
+DrawListStats GetDrawListStats();	// Of the last submit
+
+// Prints recording throughput on one thread vs ParallelFor, and merge cost, for 100k packets (no GL needed)
+void BenchmarkDrawLists();
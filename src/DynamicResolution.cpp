@@ -0,0 +1,196 @@
+#include "DynamicResolution.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "Window.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// Queries in flight; results are read this many frames late, by which time the GPU is done with them
+constexpr int DYNAMIC_RES_QUERIES = 4;
+
+// Samples averaged per adjustment
+constexpr int DYNAMIC_RES_INTERVAL = 8;
+
+// Dead band as a fraction of the budget: above HIGH drops resolution, below LOW raises it, between does nothing
+constexpr double DYNAMIC_RES_HIGH = 0.95;
+constexpr double DYNAMIC_RES_LOW = 0.75;
+
+// Largest increase per adjustment; decreases are immediate so a spike is corrected within one interval
+constexpr float DYNAMIC_RES_STEP_UP = 1.1f;
+
+struct DynamicResolution
+{
+    GLuint program = GL_NONE;
+    GLuint vao = GL_NONE;       // Empty; the upscale triangle comes from gl_VertexID
+
+    GLuint queries[DYNAMIC_RES_QUERIES]{};
+    float query_scales[DYNAMIC_RES_QUERIES]{};
+    bool query_pending[DYNAMIC_RES_QUERIES]{};
+    int query_next = 0;
+
+    double budget_ms = 0.0;
+    float min_scale = 0.5f;
+    float scale = 1.0f;
+    float sharpness = 0.0f;
+    bool enabled = true;
+
+    double sample_sum = 0.0;
+    int sample_count = 0;
+
+    DynamicResolutionStats stats;
+};
+
+static DynamicResolution f_res;
+
+void CreateDynamicResolution(double budget_ms, float min_scale)
+{
+    assert(f_res.program == GL_NONE && budget_ms > 0.0 && min_scale > 0.0f && min_scale <= 1.0f);
+    f_res.budget_ms = budget_ms;
+    f_res.min_scale = min_scale;
+    f_res.scale = 1.0f;
+
+    GLuint vs = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/upscale.vert");
+    GLuint fs = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/upscale.frag");
+    f_res.program = CreateProgram(vs, fs);
+    DestroyShader(&vs);
+    DestroyShader(&fs);
+
+    glGenVertexArrays(1, &f_res.vao);
+    glGenQueries(DYNAMIC_RES_QUERIES, f_res.queries);
+}
+
+void DestroyDynamicResolution()
+{
+    glDeleteQueries(DYNAMIC_RES_QUERIES, f_res.queries);
+    glDeleteVertexArrays(1, &f_res.vao);
+    DestroyProgram(&f_res.program);
+    f_res = DynamicResolution();
+}
+
+void SetDynamicResolutionBudget(double budget_ms)
+{
+    f_res.budget_ms = budget_ms;
+}
+
+void SetDynamicResolutionSharpness(float sharpness)
+{
+    f_res.sharpness = sharpness;
+}
+
+void SetDynamicResolutionEnabled(bool enabled)
+{
+    f_res.enabled = enabled;
+    if (!enabled)
+        f_res.scale = 1.0f;
+}
+
+void DynamicResolutionSize(int* width, int* height)
+{
+    // A minimized window reports 0x0
+    f_res.stats.width = std::max(1, (int)lroundf(WindowWidth() * f_res.scale));
+    f_res.stats.height = std::max(1, (int)lroundf(WindowHeight() * f_res.scale));
+    f_res.stats.scale = f_res.scale;
+    *width = f_res.stats.width;
+    *height = f_res.stats.height;
+}
+
+void BeginDynamicResolution()
+{
+    // A slot still pending here means the GPU is >4 frames behind; its sample is dropped rather than waited on
+    int slot = f_res.query_next;
+    f_res.query_pending[slot] = false;
+    f_res.query_scales[slot] = f_res.scale;
+    glViewport(0, 0, f_res.stats.width, f_res.stats.height);
+    glBeginQuery(GL_TIME_ELAPSED, f_res.queries[slot]);
+}
+
+// Collects finished queries and moves the scale once an interval's worth of samples is in
+static void UpdateScale()
+{
+    for (int i = 0; i < DYNAMIC_RES_QUERIES; i++)
+    {
+        if (!f_res.query_pending[i])
+            continue;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(f_res.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(f_res.queries[i], GL_QUERY_RESULT, &elapsed);
+        f_res.query_pending[i] = false;
+
+        // Frames measured before the last change say nothing about the current scale
+        if (f_res.query_scales[i] != f_res.scale)
+            continue;
+        f_res.sample_sum += elapsed * 1e-6;
+        f_res.sample_count++;
+    }
+
+    if (f_res.sample_count < DYNAMIC_RES_INTERVAL)
+        return;
+
+    double average = f_res.sample_sum / f_res.sample_count;
+    f_res.stats.gpu_ms = average;
+    f_res.sample_sum = 0.0;
+    f_res.sample_count = 0;
+    if (!f_res.enabled)
+        return;
+
+    // GPU time scales roughly with pixel count, i.e. with scale squared
+    float scale = f_res.scale;
+    float ideal = scale * (float)sqrt(f_res.budget_ms * DYNAMIC_RES_HIGH / std::max(average, 1e-3));
+    if (average > f_res.budget_ms * DYNAMIC_RES_HIGH)
+        scale = ideal;
+    else if (average < f_res.budget_ms * DYNAMIC_RES_LOW)
+        scale = std::min(ideal, scale * DYNAMIC_RES_STEP_UP);
+
+    // Snap to 1/64 so tiny corrections don't count as changes
+    scale = std::min(std::max(roundf(scale * 64.0f) / 64.0f, f_res.min_scale), 1.0f);
+    if (scale != f_res.scale)
+    {
+        f_res.scale = scale;
+        f_res.stats.changes++;
+    }
+}
+
+void EndDynamicResolution()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    f_res.query_pending[f_res.query_next] = true;
+    f_res.query_next = (f_res.query_next + 1) % DYNAMIC_RES_QUERIES;
+    UpdateScale();
+}
+
+void DrawUpscale(const Texture& scene)
+{
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+
+    // The region rendered this frame, in the bottom-left of the window-sized target
+    Vector2 texel = { 1.0f / scene.width, 1.0f / scene.height };
+    float width = (float)std::min(f_res.stats.width, scene.width);
+    float height = (float)std::min(f_res.stats.height, scene.height);
+    BeginShader(f_res.program);
+    BeginTexture(scene);
+    SendInt(0, "u_tex");
+    SendVec2(texel, "u_texel");
+    SendVec2({ width * texel.x, height * texel.y }, "u_uv_scale");
+    SendVec2({ (width - 0.5f) * texel.x, (height - 0.5f) * texel.y }, "u_uv_max");
+    SendFloat(f_res.sharpness, "u_sharpness");
+    glBindVertexArray(f_res.vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(GL_NONE);
+    EndTexture();
+    EndShader();
+
+    if (depth_test)
+        glEnable(GL_DEPTH_TEST);
+}
+
+DynamicResolutionStats GetDynamicResolutionStats()
+{
+    return f_res.stats;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <glad/glad.h>
+#include "Texture.h"
+
+// Renders the scene at a fraction of the window's resolution, then upscales it to the backbuffer
+// (bilinear, optionally sharpened). The scene's targets come from the render graph at window size and only the
+// viewport shrinks, so scale changes never reallocate them.
+// GPU time of the scene is measured with timer queries (read a few frames late, never stalling);
+// every few frames the scale moves towards the budget, with a dead band so it doesn't oscillate.
+
+struct DynamicResolutionStats
+{
+	float scale = 1.0f;		// Per axis; pixel count is scale squared
+	int width = 0;			// Rendered region
+	int height = 0;
+	double gpu_ms = 0.0;	// Average over the last adjustment interval
+	int changes = 0;		// Scale adjustments since creation
+};
+
+// budget_ms is the GPU time the scene may take per frame
+void CreateDynamicResolution(double budget_ms, float min_scale = 0.5f);
+void DestroyDynamicResolution();
+
+void SetDynamicResolutionBudget(double budget_ms);
+void SetDynamicResolutionSharpness(float sharpness);	// 0 = bilinear, 1 = full unsharp mask
+void SetDynamicResolutionEnabled(bool enabled);			// Disabled pins the scale at 1
+
+// Size the scene renders at this frame: the window's, scaled. The region starts at the targets' origin.
+void DynamicResolutionSize(int* width, int* height);
+
+// Around the scene's passes: times them and, once enough samples are in, updates the scale.
+// Begin shrinks the bound (window-sized) target's viewport to the scaled region.
+void BeginDynamicResolution();
+void EndDynamicResolution();
+
+// Fullscreen pass: filters the rendered region of scene over the bound framebuffer's viewport
+void DrawUpscale(const Texture& scene);
+
+DynamicResolutionStats GetDynamicResolutionStats();
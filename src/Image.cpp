@@ -0,0 +1,628 @@
+#include "Image.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// x64 always has SSE2; AVX2 is used when the compiler targets it (/arch:AVX2 or -mavx2)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define IMAGE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMAGE_SSE2 1
+#endif
+
+// Fills larger than this bypass the cache (non-temporal stores), since the data won't be read back soon
+constexpr size_t STREAM_THRESHOLD = 1 << 22;
+
+static inline uint8_t ToByte(float value)
+{
+    // Matches _mm_cvtps_epi32 (round-to-nearest) + saturating packs in the SIMD paths
+    float rounded = std::nearbyint(value);
+    return (uint8_t)std::min(255.0f, std::max(0.0f, rounded));
+}
+
+void LoadImage(Image* image, int width, int height)
+{
+    assert(image->pixels == nullptr);
+    assert(width > 0 && height > 0);
+
+    size_t bytes = (size_t)width * height * sizeof(Color);
+    image->width = width;
+    image->height = height;
+    image->pixels = static_cast<Color*>(::operator new[](bytes, std::align_val_t(IMAGE_ALIGNMENT)));
+    memset(image->pixels, 0, bytes);
+}
+
+void UnloadImage(Image* image)
+{
+    if (image->pixels != nullptr)
+        ::operator delete[](image->pixels, std::align_val_t(IMAGE_ALIGNMENT));
+
+    image->pixels = nullptr;
+    image->width = 0;
+    image->height = 0;
+}
+
+void FillImage(Image* image, Color color)
+{
+    size_t count = (size_t)image->width * image->height;
+    Color* dst = image->pixels;
+    size_t i = 0;
+
+#if IMAGE_AVX2 || IMAGE_SSE2
+    int packed;
+    memcpy(&packed, &color, sizeof(Color));
+    bool stream = count * sizeof(Color) >= STREAM_THRESHOLD;
+#endif
+
+    // Aligned stores are safe: the base is 64-byte aligned and i advances in whole vectors
+#if IMAGE_AVX2
+    __m256i v = _mm256_set1_epi32(packed);
+    if (stream)
+    {
+        for (; i + 8 <= count; i += 8)
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), v);
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 8 <= count; i += 8)
+            _mm256_store_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+#elif IMAGE_SSE2
+    __m128i v = _mm_set1_epi32(packed);
+    if (stream)
+    {
+        for (; i + 4 <= count; i += 4)
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), v);
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 4 <= count; i += 4)
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+#endif
+
+    for (; i < count; i++)
+        dst[i] = color;
+}
+
+// left & step are RGBA already scaled to [0, 255]
+static void GradientRow(Color* dst, int width, const float left[4], const float step[4])
+{
+    int x = 0;
+
+#if IMAGE_AVX2
+    // Lane layout [px n | px n+4] so packs/packus leave 8 pixels in order without a permute
+    __m256 l = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(left));
+    __m256 d = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(step));
+    __m256 p0 = _mm256_add_ps(l, _mm256_mul_ps(d, _mm256_setr_ps(0, 0, 0, 0, 4, 4, 4, 4)));
+    __m256 p1 = _mm256_add_ps(p0, d);
+    __m256 p2 = _mm256_add_ps(p1, d);
+    __m256 p3 = _mm256_add_ps(p2, d);
+    __m256 d8 = _mm256_mul_ps(d, _mm256_set1_ps(8.0f));
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256i ab = _mm256_packs_epi32(_mm256_cvtps_epi32(p0), _mm256_cvtps_epi32(p1));
+        __m256i cd = _mm256_packs_epi32(_mm256_cvtps_epi32(p2), _mm256_cvtps_epi32(p3));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_packus_epi16(ab, cd));
+
+        p0 = _mm256_add_ps(p0, d8);
+        p1 = _mm256_add_ps(p1, d8);
+        p2 = _mm256_add_ps(p2, d8);
+        p3 = _mm256_add_ps(p3, d8);
+    }
+#elif IMAGE_SSE2
+    __m128 d = _mm_loadu_ps(step);
+    __m128 p0 = _mm_loadu_ps(left);
+    __m128 p1 = _mm_add_ps(p0, d);
+    __m128 p2 = _mm_add_ps(p1, d);
+    __m128 p3 = _mm_add_ps(p2, d);
+    __m128 d4 = _mm_mul_ps(d, _mm_set1_ps(4.0f));
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i ab = _mm_packs_epi32(_mm_cvtps_epi32(p0), _mm_cvtps_epi32(p1));
+        __m128i cd = _mm_packs_epi32(_mm_cvtps_epi32(p2), _mm_cvtps_epi32(p3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(ab, cd));
+
+        p0 = _mm_add_ps(p0, d4);
+        p1 = _mm_add_ps(p1, d4);
+        p2 = _mm_add_ps(p2, d4);
+        p3 = _mm_add_ps(p3, d4);
+    }
+#endif
+
+    for (; x < width; x++)
+    {
+        dst[x].r = ToByte(left[0] + step[0] * x);
+        dst[x].g = ToByte(left[1] + step[1] * x);
+        dst[x].b = ToByte(left[2] + step[2] * x);
+        dst[x].a = ToByte(left[3] + step[3] * x);
+    }
+}
+
+void LoadImageGradient(Image* image, Vector3 top_left, Vector3 top_right, Vector3 bottom_left, Vector3 bottom_right)
+{
+    assert(image->pixels != nullptr);
+    int width = image->width;
+    int height = image->height;
+
+    // Row 0 is the bottom row (OpenGL's texture origin)
+    Vector3 tl = top_left * 255.0f;
+    Vector3 tr = top_right * 255.0f;
+    Vector3 bl = bottom_left * 255.0f;
+    Vector3 br = bottom_right * 255.0f;
+    float inv_w = width > 1 ? 1.0f / (width - 1) : 0.0f;
+    float inv_h = height > 1 ? 1.0f / (height - 1) : 0.0f;
+
+    ParallelRows(height, (size_t)width * height * sizeof(Color), [=](int y0, int y1)
+    {
+        for (int y = y0; y < y1; y++)
+        {
+            float v = y * inv_h;
+            Vector3 l = Vector3Lerp(bl, tl, v);
+            Vector3 r = Vector3Lerp(br, tr, v);
+            Vector3 d = (r - l) * inv_w;
+
+            float left[4] = { l.x, l.y, l.z, 255.0f };
+            float step[4] = { d.x, d.y, d.z, 0.0f };
+            GradientRow(image->pixels + (size_t)y * width, width, left, step);
+        }
+    });
+}
+
+int MipmapCount(int width, int height)
+{
+    int levels = 1;
+    int size = std::max(width, height);
+    while (size > 1)
+    {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+// Source texels covered by one destination texel along one axis, weighted by overlap
+struct MipTaps
+{
+    int index[3];
+    float weight[3];
+    int count;
+};
+
+static void BuildMipTaps(int src, int dst, std::vector<MipTaps>* taps)
+{
+    // Odd sizes shrink to floor(src / 2), so a destination texel can straddle up to 3 source texels
+    taps->resize(dst);
+    float scale = (float)src / (float)dst;
+    for (int i = 0; i < dst; i++)
+    {
+        float a = i * scale;
+        float b = (i + 1) * scale;
+        MipTaps& t = (*taps)[i];
+        t.count = 0;
+        for (int s = (int)a; s < src && s < b && t.count < 3; s++)
+        {
+            float overlap = std::min(b, (float)(s + 1)) - std::max(a, (float)s);
+            if (overlap <= 0.0f)
+                continue;
+            t.index[t.count] = s;
+            t.weight[t.count] = overlap / scale;
+            t.count++;
+        }
+    }
+}
+
+// 2x2 box filter for even source dimensions (the common case), with exact rounding
+static void DownsampleEvenRows(const Image& src, Image* dst, int y0, int y1)
+{
+    for (int y = y0; y < y1; y++)
+    {
+        const Color* row0 = src.pixels + (size_t)(2 * y) * src.width;
+        const Color* row1 = row0 + src.width;
+        Color* out = dst->pixels + (size_t)y * dst->width;
+        int x = 0;
+
+#if IMAGE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        for (; x + 4 <= dst->width; x += 4)
+        {
+            __m128i r0a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x));
+            __m128i r0b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x + 4));
+            __m128i r1a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x));
+            __m128i r1b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x + 4));
+
+            // Vertical sums in 16 bits: [s0 s1], [s2 s3], [s4 s5], [s6 s7]
+            __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(r0a, zero), _mm_unpacklo_epi8(r1a, zero));
+            __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(r0a, zero), _mm_unpackhi_epi8(r1a, zero));
+            __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(r0b, zero), _mm_unpacklo_epi8(r1b, zero));
+            __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(r0b, zero), _mm_unpackhi_epi8(r1b, zero));
+
+            // Horizontal pairs: [s0+s1 s2+s3], [s4+s5 s6+s7]
+            __m128i d01 = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+            __m128i d23 = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67), _mm_unpackhi_epi64(s45, s67));
+            d01 = _mm_srli_epi16(_mm_add_epi16(d01, two), 2);
+            d23 = _mm_srli_epi16(_mm_add_epi16(d23, two), 2);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(d01, d23));
+        }
+#endif
+
+        for (; x < dst->width; x++)
+        {
+            const uint8_t* a = &row0[2 * x].r;
+            const uint8_t* b = &row1[2 * x].r;
+            uint8_t* o = &out[x].r;
+            for (int c = 0; c < 4; c++)
+                o[c] = (uint8_t)((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+        }
+    }
+}
+
+static void DownsampleRows(const Image& src, Image* dst, const MipTaps* xtaps, const MipTaps* ytaps, int y0, int y1)
+{
+    for (int y = y0; y < y1; y++)
+    {
+        const MipTaps& ty = ytaps[y];
+        Color* out = dst->pixels + (size_t)y * dst->width;
+        for (int x = 0; x < dst->width; x++)
+        {
+            const MipTaps& tx = xtaps[x];
+            float sum[4]{};
+            for (int j = 0; j < ty.count; j++)
+            {
+                const Color* row = src.pixels + (size_t)ty.index[j] * src.width;
+                for (int i = 0; i < tx.count; i++)
+                {
+                    const Color& c = row[tx.index[i]];
+                    float w = ty.weight[j] * tx.weight[i];
+                    sum[0] += c.r * w;
+                    sum[1] += c.g * w;
+                    sum[2] += c.b * w;
+                    sum[3] += c.a * w;
+                }
+            }
+            out[x] = { ToByte(sum[0]), ToByte(sum[1]), ToByte(sum[2]), ToByte(sum[3]) };
+        }
+    }
+}
+
+static void Downsample(const Image& src, Image* dst)
+{
+    size_t bytes = (size_t)src.width * src.height * sizeof(Color);
+    if (src.width % 2 == 0 && src.height % 2 == 0)
+    {
+        ParallelRows(dst->height, bytes, [&](int y0, int y1)
+        {
+            DownsampleEvenRows(src, dst, y0, y1);
+        });
+        return;
+    }
+
+    std::vector<MipTaps> xtaps, ytaps;
+    BuildMipTaps(src.width, dst->width, &xtaps);
+    BuildMipTaps(src.height, dst->height, &ytaps);
+    ParallelRows(dst->height, bytes, [&](int y0, int y1)
+    {
+        DownsampleRows(src, dst, xtaps.data(), ytaps.data(), y0, y1);
+    });
+}
+
+void GenerateMipmaps(const Image& image, std::vector<Image>* mips)
+{
+    // Each level depends on the previous one, so parallelism is within a level rather than across levels
+    int levels = MipmapCount(image.width, image.height);
+    mips->reserve(mips->size() + levels - 1);
+
+    const Image* src = &image;
+    for (int level = 1; level < levels; level++)
+    {
+        Image dst;
+        LoadImage(&dst, std::max(1, src->width >> 1), std::max(1, src->height >> 1));
+        Downsample(*src, &dst);
+        mips->push_back(dst);
+        src = &mips->back();
+    }
+}
+
+void UnloadMipmaps(std::vector<Image>* mips)
+{
+    for (Image& mip : *mips)
+        UnloadImage(&mip);
+    mips->clear();
+}
+
+static uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    // Function-local static: built once, thread-safely (the capture writer & main thread both save PNGs)
+    struct Table
+    {
+        uint32_t entries[256];
+    };
+    static const Table table = []
+    {
+        Table t;
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t.entries[n] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Streams PNG chunk data to disk while accumulating its CRC, so the image is never duplicated in memory
+struct PngWriter
+{
+    FILE* file;
+    uint32_t crc;
+};
+
+static void PngWrite(PngWriter* png, const void* data, size_t size)
+{
+    fwrite(data, 1, size, png->file);
+    png->crc = Crc32(png->crc, static_cast<const uint8_t*>(data), size);
+}
+
+static void PngWriteU32(PngWriter* png, uint32_t value)
+{
+    uint8_t bytes[4] = { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+    PngWrite(png, bytes, 4);
+}
+
+static void PngBeginChunk(PngWriter* png, const char* type, uint32_t length)
+{
+    uint8_t bytes[4] = { (uint8_t)(length >> 24), (uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)length };
+    fwrite(bytes, 1, 4, png->file);
+    png->crc = 0;
+    PngWrite(png, type, 4);
+}
+
+static void PngEndChunk(PngWriter* png)
+{
+    uint32_t crc = png->crc;
+    uint8_t bytes[4] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+    fwrite(bytes, 1, 4, png->file);
+}
+
+bool SaveImage(const char* path, const Image& image)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr)
+    {
+        printf("Failed to save image: %s\n", path);
+        return false;
+    }
+
+    PngWriter png{ file, 0 };
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, sizeof(signature), file);
+
+    PngBeginChunk(&png, "IHDR", 13);
+    PngWriteU32(&png, image.width);
+    PngWriteU32(&png, image.height);
+    const uint8_t format[5] = { 8, 6, 0, 0, 0 }; // 8-bit RGBA, deflate, no filter, no interlace
+    PngWrite(&png, format, sizeof(format));
+    PngEndChunk(&png);
+
+    // zlib stream of stored (uncompressed) deflate blocks, each at most 65535 bytes
+    const size_t max_block = 65535;
+    size_t row_bytes = (size_t)image.width * sizeof(Color);
+    size_t raw_bytes = (row_bytes + 1) * image.height;
+    size_t blocks = (raw_bytes + max_block - 1) / max_block;
+    PngBeginChunk(&png, "IDAT", (uint32_t)(2 + blocks * 5 + raw_bytes + 4));
+
+    const uint8_t zlib_header[2] = { 0x78, 0x01 };
+    PngWrite(&png, zlib_header, 2);
+
+    uint32_t adler_a = 1, adler_b = 0;
+    size_t block_left = 0;
+    size_t written = 0;
+    auto write_raw = [&](const uint8_t* data, size_t size)
+    {
+        while (size > 0)
+        {
+            if (block_left == 0)
+            {
+                block_left = std::min(max_block, raw_bytes - written);
+                uint8_t header[5] =
+                {
+                    (uint8_t)(written + block_left == raw_bytes ? 1 : 0),
+                    (uint8_t)block_left, (uint8_t)(block_left >> 8),
+                    (uint8_t)~block_left, (uint8_t)(~block_left >> 8)
+                };
+                PngWrite(&png, header, sizeof(header));
+            }
+
+            size_t n = std::min(size, block_left);
+            PngWrite(&png, data, n);
+            for (size_t i = 0; i < n; i++)
+            {
+                adler_a = (adler_a + data[i]) % 65521;
+                adler_b = (adler_b + adler_a) % 65521;
+            }
+
+            data += n;
+            size -= n;
+            block_left -= n;
+            written += n;
+        }
+    };
+
+    // PNG is top-down, our rows are bottom-up
+    for (int y = image.height - 1; y >= 0; y--)
+    {
+        const uint8_t filter = 0;
+        write_raw(&filter, 1);
+        write_raw(reinterpret_cast<const uint8_t*>(image.pixels + (size_t)y * image.width), row_bytes);
+    }
+
+    PngWriteU32(&png, (adler_b << 16) | adler_a);
+    PngEndChunk(&png);
+
+    PngBeginChunk(&png, "IEND", 0);
+    PngEndChunk(&png);
+
+    fclose(file);
+    return true;
+}
+
+static uint32_t PngReadU32(const uint8_t* bytes)
+{
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+}
+
+bool LoadImagePng(Image* image, const char* path)
+{
+    assert(image->pixels == nullptr);
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + read);
+    fclose(file);
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (data.size() < 8 || memcmp(data.data(), signature, 8) != 0)
+    {
+        printf("Failed to load image (not a PNG): %s\n", path);
+        return false;
+    }
+
+    // Chunks: IHDR must describe what SaveImage writes, IDATs concatenate into one zlib stream
+    int width = 0, height = 0;
+    std::vector<uint8_t> zlib;
+    size_t offset = 8;
+    while (offset + 12 <= data.size())
+    {
+        uint32_t length = PngReadU32(&data[offset]);
+        const uint8_t* type = &data[offset + 4];
+        const uint8_t* chunk = &data[offset + 8];
+        if (offset + 12 + (size_t)length > data.size())
+            break;
+
+        if (memcmp(type, "IHDR", 4) == 0 && length == 13)
+        {
+            width = (int)PngReadU32(chunk);
+            height = (int)PngReadU32(chunk + 4);
+            const uint8_t format[5] = { 8, 6, 0, 0, 0 };
+            if (memcmp(chunk + 8, format, 5) != 0)
+                width = height = 0;
+        }
+        else if (memcmp(type, "IDAT", 4) == 0)
+        {
+            zlib.insert(zlib.end(), chunk, chunk + length);
+        }
+        else if (memcmp(type, "IEND", 4) == 0)
+        {
+            break;
+        }
+        offset += 12 + (size_t)length;
+    }
+
+    size_t row_bytes = (size_t)width * sizeof(Color);
+    std::vector<uint8_t> raw;
+    raw.reserve((row_bytes + 1) * height);
+
+    // Stored blocks only: a header byte (final flag, type 0) then LEN & ~LEN, then the bytes themselves
+    bool valid = width > 0 && height > 0 && zlib.size() >= 2;
+    size_t at = 2;
+    for (bool final = false; valid && !final;)
+    {
+        if (at + 5 > zlib.size() || (zlib[at] >> 1 & 3) != 0)
+        {
+            valid = false;
+            break;
+        }
+        final = (zlib[at] & 1) != 0;
+        size_t length = zlib[at + 1] | (size_t)zlib[at + 2] << 8;
+        at += 5;
+        if (at + length > zlib.size())
+        {
+            valid = false;
+            break;
+        }
+        raw.insert(raw.end(), zlib.begin() + at, zlib.begin() + at + length);
+        at += length;
+    }
+    valid = valid && raw.size() == (row_bytes + 1) * height;
+
+    // PNG is top-down, our rows are bottom-up; every row must be unfiltered
+    if (valid)
+    {
+        LoadImage(image, width, height);
+        for (int y = 0; y < height && valid; y++)
+        {
+            const uint8_t* row = &raw[(row_bytes + 1) * y];
+            valid = row[0] == 0;
+            memcpy(image->pixels + (size_t)(height - 1 - y) * width, row + 1, row_bytes);
+        }
+        if (!valid)
+            UnloadImage(image);
+    }
+
+    if (!valid)
+        printf("Failed to load image (only SaveImage's stored-deflate RGBA PNGs are supported): %s\n", path);
+    return valid;
+}
+
+void BenchmarkImage()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    const int width = 3840;
+    const int height = 2160;
+    const int iterations = 10;
+    const double mpix = width * (double)height * 1e-6;
+    const double gb = width * (double)height * sizeof(Color) * 1e-9;
+
+    Image image;
+    LoadImage(&image, width, height);
+
+    auto begin = Clock::now();
+    for (int i = 0; i < iterations; i++)
+        FillImage(&image, { (uint8_t)i, 64, 128, 255 });
+    double fill = std::chrono::duration<double>(Clock::now() - begin).count() / iterations;
+
+    begin = Clock::now();
+    for (int i = 0; i < iterations; i++)
+        LoadImageGradient(&image, Vector3Zeros, Vector3UnitX, Vector3UnitY, Vector3Ones);
+    double gradient = std::chrono::duration<double>(Clock::now() - begin).count() / iterations;
+
+    std::vector<Image> mips;
+    begin = Clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        GenerateMipmaps(image, &mips);
+        UnloadMipmaps(&mips);
+    }
+    double mipmaps = std::chrono::duration<double>(Clock::now() - begin).count() / iterations;
+
+    printf("Image benchmark (%ix%i, %i threads):\n", width, height, (int)std::thread::hardware_concurrency());
+    printf("  fill:     %7.3f ms  %8.1f MPix/s  %6.2f GB/s\n", fill * 1e3, mpix / fill, gb / fill);
+    printf("  gradient: %7.3f ms  %8.1f MPix/s  %6.2f GB/s\n", gradient * 1e3, mpix / gradient, gb / gradient);
+    printf("  mipmaps:  %7.3f ms  %8.1f MPix/s  %6.2f GB/s\n", mipmaps * 1e3, mpix / mipmaps, gb / mipmaps);
+
+    UnloadImage(&image);
+}
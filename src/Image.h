@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "raymath.h"
+
+// 8-bit RGBA, matches GL_RGBA + GL_UNSIGNED_BYTE
+struct Color
+{
+	uint8_t r, g, b, a;
+};
+
+// Pixel rows are tightly packed and the allocation is 64-byte (cache-line) aligned,
+// so SIMD kernels can treat the whole image as one aligned run of width * height pixels.
+struct Image
+{
+	int width = 0;
+	int height = 0;
+	Color* pixels = nullptr;
+};
+
+constexpr size_t IMAGE_ALIGNMENT = 64;
+
+void LoadImage(Image* image, int width, int height);
+void UnloadImage(Image* image);
+
+void FillImage(Image* image, Color color);
+
+// Bilinear blend between the four corner colours (components in [0, 1]).
+void LoadImageGradient(Image* image, Vector3 top_left, Vector3 top_right, Vector3 bottom_left, Vector3 bottom_right);
+
+// Appends levels 1..n (down to 1x1) to mips; level 0 is the image itself.
+// Each level is an area-weighted box filter of the previous one (odd sizes are handled exactly),
+// with large levels split across threads by row.
+void GenerateMipmaps(const Image& image, std::vector<Image>* mips);
+void UnloadMipmaps(std::vector<Image>* mips);
+
+int MipmapCount(int width, int height);
+
+// Writes an uncompressed (stored-deflate) PNG
+bool SaveImage(const char* path, const Image& image);
+
+// Reads a PNG as SaveImage writes it (8-bit RGBA, stored deflate, unfiltered rows); anything else fails
+bool LoadImagePng(Image* image, const char* path);
+
+// Prints fill/gradient/mipmap throughput for a 3840x2160 image
+void BenchmarkImage();
@@ -0,0 +1,374 @@
+#include "Jobs.h"
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Per-thread capacity; RunJob runs jobs inline rather than queue more
+constexpr int64_t JOB_DEQUE_SIZE = 4096;
+
+// Spins before a worker sleeps; a frame's burst of jobs usually arrives within this window
+constexpr int JOB_IDLE_SPINS = 2048;
+
+struct Job
+{
+    JobFunction function = nullptr;
+    void* data = nullptr;
+    JobCounter* counter = nullptr;
+    int begin = 0;
+    int end = 0;
+};
+
+// A job stored in the ring by value. Thieves copy it out before claiming it and the owner may refill the slot
+// meanwhile, so every field is a (relaxed) atomic: a torn copy is possible but is never used, since the slot can
+// only be refilled once top has moved past it, which fails the thief's CAS.
+struct JobCell
+{
+    std::atomic<JobFunction> function{ nullptr };
+    std::atomic<void*> data{ nullptr };
+    std::atomic<JobCounter*> counter{ nullptr };
+    std::atomic<int> begin{ 0 };
+    std::atomic<int> end{ 0 };
+};
+
+// Chase-Lev deque (Le, Pop, Cohen & Zappa Nardelli's C11 formulation) over a fixed ring
+struct JobDeque
+{
+    alignas(64) std::atomic<int64_t> top{ 0 };
+    alignas(64) std::atomic<int64_t> bottom{ 0 };
+    JobCell jobs[JOB_DEQUE_SIZE];
+};
+
+struct JobSystem
+{
+    std::vector<JobDeque*> deques;      // [0] is the main thread's, then the workers', then the joinable slots
+    std::vector<std::thread> workers;
+    std::atomic<bool> joined[JOB_MAX_JOINED]{};
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<int> pending{ 0 };      // Queued, not yet taken
+    std::atomic<int> sleeping{ 0 };
+    std::atomic<bool> quit{ false };
+};
+
+static JobSystem f_jobs;
+static thread_local int t_index = -1;
+static thread_local uint32_t t_random = 0;
+
+static void StoreJob(JobCell* cell, const Job& job)
+{
+    cell->function.store(job.function, std::memory_order_relaxed);
+    cell->data.store(job.data, std::memory_order_relaxed);
+    cell->counter.store(job.counter, std::memory_order_relaxed);
+    cell->begin.store(job.begin, std::memory_order_relaxed);
+    cell->end.store(job.end, std::memory_order_relaxed);
+}
+
+static Job LoadJob(const JobCell& cell)
+{
+    Job job;
+    job.function = cell.function.load(std::memory_order_relaxed);
+    job.data = cell.data.load(std::memory_order_relaxed);
+    job.counter = cell.counter.load(std::memory_order_relaxed);
+    job.begin = cell.begin.load(std::memory_order_relaxed);
+    job.end = cell.end.load(std::memory_order_relaxed);
+    return job;
+}
+
+// False when the deque is full (a stale top only makes it look fuller)
+static bool Push(JobDeque* deque, const Job& job)
+{
+    int64_t b = deque->bottom.load(std::memory_order_relaxed);
+    int64_t t = deque->top.load(std::memory_order_acquire);
+    if (b - t >= JOB_DEQUE_SIZE)
+        return false;
+
+    // Release publishes the job's fields along with the slot to thieves that acquire bottom
+    StoreJob(&deque->jobs[b & (JOB_DEQUE_SIZE - 1)], job);
+    deque->bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+static bool Pop(JobDeque* deque, Job* job)
+{
+    int64_t b = deque->bottom.load(std::memory_order_relaxed) - 1;
+    deque->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = deque->top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        deque->bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    *job = LoadJob(deque->jobs[b & (JOB_DEQUE_SIZE - 1)]);
+    bool taken = true;
+    if (t == b)
+    {
+        // Last job: race any thief for it
+        taken = deque->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        deque->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return taken;
+}
+
+static bool Steal(JobDeque* deque, Job* job)
+{
+    int64_t t = deque->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = deque->bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return false;
+
+    // Copied before the claim: once top moves on, the owner is free to refill the slot
+    *job = LoadJob(deque->jobs[t & (JOB_DEQUE_SIZE - 1)]);
+    return deque->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+static void Execute(const Job& job)
+{
+    job.function(job.data, job.begin, job.end);
+    if (job.counter != nullptr)
+        job.counter->value.fetch_sub(1, std::memory_order_release);
+}
+
+// Own deque first (newest job, still warm in cache), then a sweep of the others from a random start
+static bool RunOneJob()
+{
+    int count = (int)f_jobs.deques.size();
+    Job job;
+    bool found = Pop(f_jobs.deques[t_index], &job);
+    if (!found)
+    {
+        t_random = t_random * 1664525u + 1013904223u;
+        int start = (int)(t_random >> 16) % count;
+        for (int i = 0; i < count && !found; i++)
+        {
+            int victim = (start + i) % count;
+            if (victim != t_index)
+                found = Steal(f_jobs.deques[victim], &job);
+        }
+    }
+
+    if (!found)
+        return false;
+
+    f_jobs.pending.fetch_sub(1, std::memory_order_relaxed);
+    Execute(job);
+    return true;
+}
+
+static void WorkerMain(int index)
+{
+    t_index = index;
+    t_random = 0x9e3779b9u * (index + 1);
+
+    int idle = 0;
+    while (!f_jobs.quit.load(std::memory_order_acquire))
+    {
+        if (RunOneJob())
+        {
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < JOB_IDLE_SPINS)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // The sleeping count is raised under the lock before re-checking, so RunJob either sees
+        // a sleeper and notifies, or this check sees its job
+        std::unique_lock<std::mutex> lock(f_jobs.mutex);
+        f_jobs.sleeping.fetch_add(1);
+        f_jobs.wake.wait(lock, [] { return f_jobs.pending.load() > 0 || f_jobs.quit.load(); });
+        f_jobs.sleeping.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void CreateJobSystem(int workers)
+{
+    assert(f_jobs.deques.empty());
+    if (workers <= 0)
+        workers = (int)std::thread::hardware_concurrency() - 1;
+    if (workers < 0)
+        workers = 0;
+
+    f_jobs.quit = false;
+    for (int i = 0; i <= workers + JOB_MAX_JOINED; i++)
+        f_jobs.deques.push_back(new JobDeque);
+
+    t_index = 0;
+    t_random = 0x9e3779b9u;
+    for (int i = 1; i <= workers; i++)
+        f_jobs.workers.emplace_back(WorkerMain, i);
+}
+
+void DestroyJobSystem()
+{
+    for (const std::atomic<bool>& joined : f_jobs.joined)
+        assert(!joined.load() && "A thread is still in the job system");
+
+    // Drain whatever is left so no counter is left waiting
+    while (RunOneJob()) {}
+
+    {
+        std::lock_guard<std::mutex> lock(f_jobs.mutex);
+        f_jobs.quit = true;
+    }
+    f_jobs.wake.notify_all();
+    for (std::thread& worker : f_jobs.workers)
+        worker.join();
+    f_jobs.workers.clear();
+
+    for (JobDeque* deque : f_jobs.deques)
+        delete deque;
+    f_jobs.deques.clear();
+    t_index = -1;
+}
+
+void JoinJobSystem()
+{
+    assert(t_index < 0 && !f_jobs.deques.empty());
+    int first = (int)f_jobs.workers.size() + 1;
+    for (int i = 0; i < JOB_MAX_JOINED; i++)
+    {
+        bool expected = false;
+        if (f_jobs.joined[i].compare_exchange_strong(expected, true))
+        {
+            t_index = first + i;
+            t_random = 0x9e3779b9u * (t_index + 1);
+            return;
+        }
+    }
+    printf("Warning: no free job system slot, this thread's parallel work will run serially\n");
+}
+
+void LeaveJobSystem()
+{
+    int first = (int)f_jobs.workers.size() + 1;
+    if (t_index < first)
+        return;
+
+    // Its deque has to be empty before the next thread to join reuses it
+    while (RunOneJob()) {}
+    f_jobs.joined[t_index - first].store(false);
+    t_index = -1;
+}
+
+int JobThreadIndex()
+{
+    return t_index;
+}
+
+int JobThreadCount()
+{
+    return (int)f_jobs.deques.size();
+}
+
+void RunJob(JobFunction function, void* data, int begin, int end, JobCounter* counter)
+{
+    assert(t_index >= 0 && "Jobs can only be queued from job system threads");
+    JobDeque* deque = f_jobs.deques[t_index];
+
+    Job job;
+    job.function = function;
+    job.data = data;
+    job.counter = counter;
+    job.begin = begin;
+    job.end = end;
+
+    if (counter != nullptr)
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+
+    // Full: run it here rather than overwrite a queued job (it's still counted, so waiting works as usual)
+    f_jobs.pending.fetch_add(1);
+    if (!Push(deque, job))
+    {
+        f_jobs.pending.fetch_sub(1);
+        Execute(job);
+        return;
+    }
+    if (f_jobs.sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(f_jobs.mutex);
+        f_jobs.wake.notify_one();
+    }
+}
+
+void WaitForCounter(JobCounter* counter)
+{
+    // Help rather than block; the jobs being waited on may be sitting in this thread's own deque
+    while (counter->value.load(std::memory_order_acquire) > 0)
+    {
+        if (!RunOneJob())
+            std::this_thread::yield();
+    }
+}
+
+static void EmptyJob(void*, int, int)
+{
+}
+
+void BenchmarkJobs()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    assert(t_index == 0);
+
+    // Throughput: queue a batch of empty jobs and wait for all of them
+    const int batch = (int)JOB_DEQUE_SIZE;
+    const int batches = 64;
+    auto begin = Clock::now();
+    for (int i = 0; i < batches; i++)
+    {
+        JobCounter counter;
+        for (int j = 0; j < batch; j++)
+            RunJob(EmptyJob, nullptr, 0, 0, &counter);
+        WaitForCounter(&counter);
+    }
+    double empty = std::chrono::duration<double>(Clock::now() - begin).count() / (batch * (double)batches);
+
+    // Latency: one job, then wait for it (what a dependency between two jobs costs)
+    const int roundtrips = 10000;
+    begin = Clock::now();
+    for (int i = 0; i < roundtrips; i++)
+    {
+        JobCounter counter;
+        RunJob(EmptyJob, nullptr, 0, 0, &counter);
+        WaitForCounter(&counter);
+    }
+    double roundtrip = std::chrono::duration<double>(Clock::now() - begin).count() / roundtrips;
+
+    // ParallelFor over a light kernel against the same loop on one thread
+    const int count = 1 << 22;
+    std::vector<float> values(count, 1.0f);
+    const int iterations = 10;
+    auto kernel = [&](int i0, int i1)
+    {
+        for (int i = i0; i < i1; i++)
+            values[i] = values[i] * 0.5f + 1.0f;
+    };
+
+    begin = Clock::now();
+    for (int i = 0; i < iterations; i++)
+        kernel(0, count);
+    double serial = std::chrono::duration<double>(Clock::now() - begin).count() / iterations;
+
+    begin = Clock::now();
+    for (int i = 0; i < iterations; i++)
+        ParallelFor(count, 4096, kernel);
+    double parallel = std::chrono::duration<double>(Clock::now() - begin).count() / iterations;
+
+    printf("Job benchmark (%i threads):\n", (int)f_jobs.workers.size() + 1);
+    printf("  empty job:        %8.1f ns/job\n", empty * 1e9);
+    printf("  spawn + wait:     %8.1f ns\n", roundtrip * 1e9);
+    printf("  parallel for:     %8.3f ms  serial: %8.3f ms  (%.2fx)\n", parallel * 1e3, serial * 1e3, serial / parallel);
+}
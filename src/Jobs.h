@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+
+// Work-stealing job system: every thread (main = 0, workers = 1..n) owns a Chase-Lev deque.
+// Owners push & pop at the bottom, idle threads steal from the top of a random victim.
+// Jobs are plain function pointers + payload stored by value in the deques' rings, so queuing never allocates;
+// a thread whose deque is full runs the job inline instead.
+// GL calls must stay on the main thread; jobs should only touch CPU data.
+
+typedef void (*JobFunction)(void* data, int begin, int end);
+
+// Counts unfinished jobs; WaitForCounter runs other jobs until it reaches 0.
+// A job that depends on others simply waits on their counter first.
+struct JobCounter
+{
+	std::atomic<int> value{ 0 };
+};
+
+// workers == 0 uses one per hardware thread besides the main thread
+void CreateJobSystem(int workers = 0);
+void DestroyJobSystem();
+
+// Threads the job system didn't start (e.g. the simulation thread) can join it for as long as they run: they get one
+// of JOB_MAX_JOINED spare deques, so RunJob, ParallelFor & ParallelRows spread their work over the workers.
+// Leave before the thread exits; the job system must outlive every joined thread.
+constexpr int JOB_MAX_JOINED = 2;
+void JoinJobSystem();
+void LeaveJobSystem();
+
+// -1 on threads the job system doesn't own (nothing may be queued from those).
+// The count includes the joinable slots, so it can size per-thread arrays indexed by JobThreadIndex.
+int JobThreadIndex();
+int JobThreadCount();
+
+void RunJob(JobFunction function, void* data, int begin, int end, JobCounter* counter);
+void WaitForCounter(JobCounter* counter);
+
+template<typename Fn>
+void JobTrampoline(void* data, int begin, int end)
+{
+	(*static_cast<Fn*>(data))(begin, end);
+}
+
+// Calls fn(begin, end) over [0, count) in chunks of at least grain items, the calling thread included.
+// Runs inline when the job system isn't available on this thread.
+template<typename Fn>
+void ParallelFor(int count, int grain, Fn fn)
+{
+	int threads = JobThreadIndex() >= 0 ? JobThreadCount() : 1;
+	if (grain < 1)
+		grain = 1;
+
+	// A few chunks per thread so stealing can even out uneven work
+	int chunks = count / grain;
+	if (chunks > threads * 4)
+		chunks = threads * 4;
+	if (threads <= 1 || chunks <= 1)
+	{
+		fn(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	int chunk = (count + chunks - 1) / chunks;
+	for (int begin = chunk; begin < count; begin += chunk)
+		RunJob(JobTrampoline<Fn>, &fn, begin, begin + chunk < count ? begin + chunk : count, &counter);
+
+	fn(0, chunk);
+	WaitForCounter(&counter);
+}
+
+// Prints scheduling overhead: empty job throughput, spawn/wait latency & ParallelFor vs serial
+void BenchmarkJobs();
@@ -0,0 +1,473 @@
+#include "Lighting.h"
+#include "Jobs.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHTING_SSE2 1
+#endif
+
+enum LightingBuffer
+{
+    LIGHTING_BUFFER_LIGHTS,     // GpuLight per visible light
+    LIGHTING_BUFFER_CLUSTERS,   // ClusterHeader, then a ClusterRange per cluster
+    LIGHTING_BUFFER_INDICES,    // uint per (cluster, light) pair, grouped by cluster
+    LIGHTING_BUFFER_COUNT
+};
+
+// View space (z points out of the screen, so boxes sit at negative z)
+struct ClusterBox
+{
+    float min[3];
+    float max[3];
+};
+
+// Lights as struct-of-arrays, so four spheres test against one box at a time
+struct LightSoA
+{
+    std::vector<float> x, y, z, r;
+    std::vector<uint32_t> index;    // Into the uploaded lights
+    int count = 0;
+};
+
+// Candidates narrowed per slice, then per row of tiles
+struct BinScratch
+{
+    LightSoA slice;
+    LightSoA row;
+    std::vector<int> hits;
+};
+
+struct ClusterRange
+{
+    uint32_t offset;
+    uint32_t count;
+};
+
+// std430 layouts of the shader's storage blocks (see vertex_color.frag)
+struct GpuLight
+{
+    Vector4 position_radius;    // View space
+    Vector4 color;
+};
+
+struct ClusterHeader
+{
+    uint32_t dims[4];           // Tiles x, tiles y, slices, light count
+    float params[4];            // Tiles per pixel x & y; slice = log(depth) * z + w
+    float ambient[4];
+};
+
+struct ClusteredLighting
+{
+    int tiles_x = 0;
+    int tiles_y = 0;
+    int slices = 0;
+
+    // Frustum the boxes were built for
+    float tan_x = 0.0f;
+    float tan_y = 0.0f;
+    float near_plane = 0.0f;
+    float far_plane = 0.0f;
+
+    std::vector<ClusterBox> boxes;          // Per cluster, x fastest then y then slice
+    std::vector<ClusterBox> row_boxes;      // Per row of tiles in each slice
+    std::vector<ClusterBox> slice_boxes;
+    ClusterBox bounds{};
+
+    LightSoA view;
+    std::vector<GpuLight> lights;
+    std::vector<ClusterRange> ranges;
+    std::vector<std::vector<uint32_t>> slice_indices;
+    std::vector<uint32_t> indices;
+    std::vector<BinScratch> scratch;        // Per job thread
+
+    Vector3 ambient = { 0.05f, 0.05f, 0.05f };
+    GLuint buffers[LIGHTING_BUFFER_COUNT]{};
+    size_t capacities[LIGHTING_BUFFER_COUNT]{};
+
+    ClusteredLightingStats stats;
+};
+
+static ClusteredLighting f_lighting;
+
+static void InitClusters(ClusteredLighting* cl, int tiles_x, int tiles_y, int slices)
+{
+    assert(tiles_x > 0 && tiles_y > 0 && slices > 0);
+    cl->tiles_x = tiles_x;
+    cl->tiles_y = tiles_y;
+    cl->slices = slices;
+    cl->boxes.resize(tiles_x * tiles_y * slices);
+    cl->row_boxes.resize(tiles_y * slices);
+    cl->slice_boxes.resize(slices);
+    cl->ranges.resize(cl->boxes.size());
+    cl->slice_indices.resize(slices);
+    cl->near_plane = cl->far_plane = 0.0f;
+}
+
+// Box around the part of the frustum between NDC [x0, x1] x [y0, y1] and view depths d0 < d1
+static ClusterBox FrustumBox(const ClusteredLighting& cl, float x0, float x1, float y0, float y1, float d0, float d1)
+{
+    // Depth is positive, so each extreme lies at the near or far end of the piece
+    ClusterBox box;
+    box.min[0] = std::min(x0 * d0, x0 * d1) * cl.tan_x;
+    box.max[0] = std::max(x1 * d0, x1 * d1) * cl.tan_x;
+    box.min[1] = std::min(y0 * d0, y0 * d1) * cl.tan_y;
+    box.max[1] = std::max(y1 * d0, y1 * d1) * cl.tan_y;
+    box.min[2] = -d1;
+    box.max[2] = -d0;
+    return box;
+}
+
+static float SliceDepth(const ClusteredLighting& cl, int slice)
+{
+    return cl.near_plane * powf(cl.far_plane / cl.near_plane, slice / (float)cl.slices);
+}
+
+static void BuildClusterBoxes(ClusteredLighting* cl)
+{
+    for (int s = 0; s < cl->slices; s++)
+    {
+        float d0 = SliceDepth(*cl, s);
+        float d1 = SliceDepth(*cl, s + 1);
+        cl->slice_boxes[s] = FrustumBox(*cl, -1.0f, 1.0f, -1.0f, 1.0f, d0, d1);
+        for (int y = 0; y < cl->tiles_y; y++)
+        {
+            float y0 = -1.0f + 2.0f * y / cl->tiles_y;
+            float y1 = -1.0f + 2.0f * (y + 1) / cl->tiles_y;
+            cl->row_boxes[s * cl->tiles_y + y] = FrustumBox(*cl, -1.0f, 1.0f, y0, y1, d0, d1);
+            for (int x = 0; x < cl->tiles_x; x++)
+            {
+                float x0 = -1.0f + 2.0f * x / cl->tiles_x;
+                float x1 = -1.0f + 2.0f * (x + 1) / cl->tiles_x;
+                cl->boxes[(s * cl->tiles_y + y) * cl->tiles_x + x] = FrustumBox(*cl, x0, x1, y0, y1, d0, d1);
+            }
+        }
+    }
+    cl->bounds = FrustumBox(*cl, -1.0f, 1.0f, -1.0f, 1.0f, cl->near_plane, cl->far_plane);
+}
+
+static inline bool SphereOverlapsBox(float x, float y, float z, float r, const ClusterBox& box)
+{
+    // Distance from the centre to the box along each axis, 0 inside
+    float dx = std::max(box.min[0] - x, 0.0f) + std::max(x - box.max[0], 0.0f);
+    float dy = std::max(box.min[1] - y, 0.0f) + std::max(y - box.max[1], 0.0f);
+    float dz = std::max(box.min[2] - z, 0.0f) + std::max(z - box.max[2], 0.0f);
+    return dx * dx + dy * dy + dz * dz <= r * r;
+}
+
+// Writes the positions of the spheres overlapping box to hits (room for count + 4), returns how many
+static int TestSpheres(const LightSoA& spheres, const ClusterBox& box, int* hits)
+{
+    int count = 0;
+    int i = 0;
+#if LIGHTING_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 min_x = _mm_set1_ps(box.min[0]);
+    const __m128 min_y = _mm_set1_ps(box.min[1]);
+    const __m128 min_z = _mm_set1_ps(box.min[2]);
+    const __m128 max_x = _mm_set1_ps(box.max[0]);
+    const __m128 max_y = _mm_set1_ps(box.max[1]);
+    const __m128 max_z = _mm_set1_ps(box.max[2]);
+    for (; i + 4 <= spheres.count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&spheres.x[i]);
+        __m128 y = _mm_loadu_ps(&spheres.y[i]);
+        __m128 z = _mm_loadu_ps(&spheres.z[i]);
+        __m128 r = _mm_loadu_ps(&spheres.r[i]);
+        __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(min_x, x), zero), _mm_max_ps(_mm_sub_ps(x, max_x), zero));
+        __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(min_y, y), zero), _mm_max_ps(_mm_sub_ps(y, max_y), zero));
+        __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(min_z, z), zero), _mm_max_ps(_mm_sub_ps(z, max_z), zero));
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_mul_ps(r, r)));
+
+        // Branchless compaction: every lane is written, only hits advance
+        hits[count] = i + 0; count += mask & 1;
+        hits[count] = i + 1; count += (mask >> 1) & 1;
+        hits[count] = i + 2; count += (mask >> 2) & 1;
+        hits[count] = i + 3; count += (mask >> 3) & 1;
+    }
+#endif
+    for (; i < spheres.count; i++)
+    {
+        hits[count] = i;
+        count += SphereOverlapsBox(spheres.x[i], spheres.y[i], spheres.z[i], spheres.r[i], box);
+    }
+    return count;
+}
+
+static void ReserveLights(LightSoA* soa, int count)
+{
+    if ((int)soa->x.size() >= count)
+        return;
+    soa->x.resize(count);
+    soa->y.resize(count);
+    soa->z.resize(count);
+    soa->r.resize(count);
+    soa->index.resize(count);
+}
+
+static void GatherLights(const LightSoA& in, const int* hits, int count, LightSoA* out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int j = hits[i];
+        out->x[i] = in.x[j];
+        out->y[i] = in.y[j];
+        out->z[i] = in.z[j];
+        out->r[i] = in.r[j];
+        out->index[i] = in.index[j];
+    }
+    out->count = count;
+}
+
+// Narrows the lights to the slice, then to each row of tiles, then tests each of the row's clusters
+static void BinSlice(ClusteredLighting* cl, int slice)
+{
+    BinScratch& scratch = cl->scratch[std::max(JobThreadIndex(), 0)];
+    std::vector<uint32_t>& indices = cl->slice_indices[slice];
+    indices.clear();
+
+    int* hits = scratch.hits.data();
+    int count = TestSpheres(cl->view, cl->slice_boxes[slice], hits);
+    GatherLights(cl->view, hits, count, &scratch.slice);
+
+    for (int y = 0; y < cl->tiles_y; y++)
+    {
+        int row = slice * cl->tiles_y + y;
+        count = TestSpheres(scratch.slice, cl->row_boxes[row], hits);
+        GatherLights(scratch.slice, hits, count, &scratch.row);
+
+        for (int x = 0; x < cl->tiles_x; x++)
+        {
+            int cluster = row * cl->tiles_x + x;
+            count = scratch.row.count > 0 ? TestSpheres(scratch.row, cl->boxes[cluster], hits) : 0;
+            cl->ranges[cluster] = { (uint32_t)indices.size(), (uint32_t)count };
+            for (int i = 0; i < count; i++)
+                indices.push_back(scratch.row.index[hits[i]]);
+        }
+    }
+}
+
+static void BinLights(ClusteredLighting* cl, const PointLight* lights, int count, Matrix view, Matrix proj)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto begin = Clock::now();
+
+    float tan_x, tan_y, near_plane, far_plane;
+    bool perspective = PerspectiveParams(proj, &tan_x, &tan_y, &near_plane, &far_plane);
+    assert(perspective);
+    if (tan_x != cl->tan_x || tan_y != cl->tan_y || near_plane != cl->near_plane || far_plane != cl->far_plane)
+    {
+        cl->tan_x = tan_x;
+        cl->tan_y = tan_y;
+        cl->near_plane = near_plane;
+        cl->far_plane = far_plane;
+        BuildClusterBoxes(cl);
+    }
+
+    // To view space, dropping lights outside the grid
+    ReserveLights(&cl->view, count);
+    cl->lights.resize(count);
+    int visible = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const PointLight& light = lights[i];
+        Vector3 p = Vector3Transform(light.position, view);
+        if (!(light.radius > 0.0f) || !SphereOverlapsBox(p.x, p.y, p.z, light.radius, cl->bounds))
+            continue;
+
+        cl->view.x[visible] = p.x;
+        cl->view.y[visible] = p.y;
+        cl->view.z[visible] = p.z;
+        cl->view.r[visible] = light.radius;
+        cl->view.index[visible] = (uint32_t)visible;
+        cl->lights[visible] = { { p.x, p.y, p.z, light.radius }, { light.color.x, light.color.y, light.color.z, 1.0f } };
+        visible++;
+    }
+    cl->view.count = visible;
+    cl->lights.resize(visible);
+
+    int threads = JobThreadIndex() >= 0 ? JobThreadCount() : 1;
+    if ((int)cl->scratch.size() < threads)
+        cl->scratch.resize(threads);
+    for (BinScratch& scratch : cl->scratch)
+    {
+        ReserveLights(&scratch.slice, visible);
+        ReserveLights(&scratch.row, visible);
+        if ((int)scratch.hits.size() < visible + 4)
+            scratch.hits.resize(visible + 4);
+    }
+
+    // Slices touch disjoint clusters, so each is a job of its own
+    ParallelFor(cl->slices, 1, [cl](int begin, int end)
+    {
+        for (int slice = begin; slice < end; slice++)
+            BinSlice(cl, slice);
+    });
+
+    // Each slice's ranges are relative to its own list; rebase them onto the concatenation
+    ClusteredLightingStats& stats = cl->stats;
+    stats = ClusteredLightingStats();
+    cl->indices.clear();
+    int per_slice = cl->tiles_x * cl->tiles_y;
+    for (int s = 0; s < cl->slices; s++)
+    {
+        uint32_t base = (uint32_t)cl->indices.size();
+        for (int c = s * per_slice; c < (s + 1) * per_slice; c++)
+        {
+            ClusterRange& range = cl->ranges[c];
+            range.offset += base;
+            stats.occupied += range.count > 0;
+            stats.max_per_cluster = std::max(stats.max_per_cluster, (int)range.count);
+        }
+        cl->indices.insert(cl->indices.end(), cl->slice_indices[s].begin(), cl->slice_indices[s].end());
+    }
+
+    stats.lights = count;
+    stats.visible = visible;
+    stats.clusters = (int)cl->ranges.size();
+    stats.indices = (int)cl->indices.size();
+    stats.bin_ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+void CreateClusteredLighting(int tiles_x, int tiles_y, int slices)
+{
+    assert(f_lighting.buffers[0] == GL_NONE);
+    InitClusters(&f_lighting, tiles_x, tiles_y, slices);
+    glGenBuffers(LIGHTING_BUFFER_COUNT, f_lighting.buffers);
+}
+
+void DestroyClusteredLighting()
+{
+    glDeleteBuffers(LIGHTING_BUFFER_COUNT, f_lighting.buffers);
+    f_lighting = ClusteredLighting();
+}
+
+void SetAmbientLight(Vector3 color)
+{
+    f_lighting.ambient = color;
+}
+
+// Orphans the buffer (the GPU may still be reading last frame's contents), growing it to fit bytes
+static void ReserveStorage(int slot, size_t bytes)
+{
+    size_t& capacity = f_lighting.capacities[slot];
+    bytes = std::max(bytes, sizeof(GpuLight));
+    if (bytes > capacity)
+        capacity = std::max(bytes, capacity * 2);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, f_lighting.buffers[slot]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+}
+
+void UpdateClusteredLighting(const PointLight* lights, int count, Matrix view, Matrix proj, int width, int height)
+{
+    assert(f_lighting.buffers[0] != GL_NONE && width > 0 && height > 0);
+    ClusteredLighting& cl = f_lighting;
+    BinLights(&cl, lights, count, view, proj);
+
+    float log_range = logf(cl.far_plane / cl.near_plane);
+    ClusterHeader header;
+    header.dims[0] = (uint32_t)cl.tiles_x;
+    header.dims[1] = (uint32_t)cl.tiles_y;
+    header.dims[2] = (uint32_t)cl.slices;
+    header.dims[3] = (uint32_t)cl.lights.size();
+    header.params[0] = cl.tiles_x / (float)width;
+    header.params[1] = cl.tiles_y / (float)height;
+    header.params[2] = cl.slices / log_range;
+    header.params[3] = -cl.slices * logf(cl.near_plane) / log_range;
+    header.ambient[0] = cl.ambient.x;
+    header.ambient[1] = cl.ambient.y;
+    header.ambient[2] = cl.ambient.z;
+    header.ambient[3] = 0.0f;
+
+    size_t light_bytes = cl.lights.size() * sizeof(GpuLight);
+    ReserveStorage(LIGHTING_BUFFER_LIGHTS, light_bytes);
+    if (light_bytes > 0)
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, light_bytes, cl.lights.data());
+
+    size_t range_bytes = cl.ranges.size() * sizeof(ClusterRange);
+    ReserveStorage(LIGHTING_BUFFER_CLUSTERS, sizeof(header) + range_bytes);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), &header);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(header), range_bytes, cl.ranges.data());
+
+    size_t index_bytes = cl.indices.size() * sizeof(uint32_t);
+    ReserveStorage(LIGHTING_BUFFER_INDICES, index_bytes);
+    if (index_bytes > 0)
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, index_bytes, cl.indices.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+}
+
+void BindClusteredLighting()
+{
+    for (int i = 0; i < LIGHTING_BUFFER_COUNT; i++)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, f_lighting.buffers[i]);
+}
+
+ClusteredLightingStats GetClusteredLightingStats()
+{
+    return f_lighting.stats;
+}
+
+void BenchmarkClusteredLighting()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    const int iterations = 20;
+    const int counts[] = { 1000, 10000 };
+
+    // Camera at the origin looking down -z; lights fill a 120 x 60 x 100 box in front of it
+    Matrix view = MatrixIdentity();
+    Matrix proj = MatrixPerspective(75.0f * DEG2RAD, 16.0f / 9.0f, 0.1f, 100.0f);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    ClusteredLighting cl;
+    InitClusters(&cl, 16, 9, 24);
+    printf("Clustered lighting benchmark (16x9x24 clusters, %i threads):\n", JobThreadIndex() >= 0 ? JobThreadCount() : 1);
+    for (int count : counts)
+    {
+        std::vector<PointLight> lights(count);
+        for (PointLight& light : lights)
+        {
+            light.position = { unit(rng) * 120.0f - 60.0f, unit(rng) * 60.0f - 30.0f, -unit(rng) * 100.0f };
+            light.radius = 1.0f + unit(rng) * 3.0f;
+            light.color = { unit(rng), unit(rng), unit(rng) };
+        }
+
+        double binned = 0.0;
+        for (int i = 0; i < iterations; i++)
+        {
+            BinLights(&cl, lights.data(), count, view, proj);
+            binned += cl.stats.bin_ms;
+        }
+        binned /= iterations;
+
+        // Reference: every visible light against every cluster, one at a time
+        auto begin = Clock::now();
+        int mismatches = 0;
+        for (size_t c = 0; c < cl.boxes.size(); c++)
+        {
+            uint32_t hits = 0;
+            for (int i = 0; i < cl.view.count; i++)
+                hits += SphereOverlapsBox(cl.view.x[i], cl.view.y[i], cl.view.z[i], cl.view.r[i], cl.boxes[c]);
+            mismatches += hits != cl.ranges[c].count;
+        }
+        double brute = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+        const ClusteredLightingStats& stats = cl.stats;
+        printf("  %5i lights: bin %7.3f ms  brute force %8.3f ms  (%.1fx)  mismatches %i\n",
+            count, binned, brute, brute / binned, mismatches);
+        printf("                visible %5i  occupied %4i/%i  lights per cluster: avg %6.1f  max %4i  (naive loop: %i)\n",
+            stats.visible, stats.occupied, stats.clusters, stats.indices / (double)std::max(stats.occupied, 1),
+            stats.max_per_cluster, stats.visible);
+    }
+}
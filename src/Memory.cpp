@@ -0,0 +1,284 @@
+#include "Memory.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Frame temporaries are small (draw orders, per-frame scratch); loads can need far more and get bigger blocks
+constexpr size_t FRAME_ARENA_BLOCK = 256 * 1024;
+constexpr size_t SCRATCH_ARENA_BLOCK = 1024 * 1024;
+
+// Header of every ArenaRealloc allocation, keeping the payload max_align_t aligned
+constexpr size_t REALLOC_HEADER = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+
+struct ArenaBlock
+{
+    ArenaBlock* next;
+    size_t size;
+    size_t used;
+};
+
+struct ThreadArena
+{
+    Arena arena;
+    ~ThreadArena() { DestroyArena(&arena); }
+};
+
+static Arena f_frame_arena;
+static thread_local ThreadArena t_scratch;
+
+static std::atomic<uint64_t> f_heap_allocations{ 0 };
+static std::atomic<uint64_t> f_pool_fallbacks{ 0 };
+static uint64_t f_frame_start = 0;
+static MemoryStats f_stats;
+
+void* MemoryHeapAlloc(size_t bytes)
+{
+    f_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* memory = malloc(bytes);
+    assert(memory != nullptr);
+    return memory;
+}
+
+void MemoryHeapFree(void* memory)
+{
+    free(memory);
+}
+
+void CountPoolFallback()
+{
+    f_pool_fallbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+static uint8_t* BlockData(ArenaBlock* block)
+{
+    return reinterpret_cast<uint8_t*>(block + 1);
+}
+
+void CreateArena(Arena* arena, size_t block_size)
+{
+    assert(arena->first == nullptr && block_size > 0);
+    *arena = Arena();
+    arena->block_size = block_size;
+}
+
+void DestroyArena(Arena* arena)
+{
+    ArenaBlock* block = arena->first;
+    while (block != nullptr)
+    {
+        ArenaBlock* next = block->next;
+        MemoryHeapFree(block);
+        block = next;
+    }
+    *arena = Arena();
+}
+
+void* ArenaAlloc(Arena* arena, size_t bytes, size_t align)
+{
+    assert(align > 0 && (align & (align - 1)) == 0 && arena->block_size > 0);
+
+    // Blocks after head are empty, so a request that doesn't fit moves on (the tail left behind is wasted until rewound)
+    for (ArenaBlock* block = arena->head; block != nullptr; block = block->next)
+    {
+        uintptr_t base = reinterpret_cast<uintptr_t>(BlockData(block));
+        size_t offset = ((base + block->used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+        if (offset + bytes <= block->size)
+        {
+            arena->used += offset + bytes - block->used;
+            arena->peak = std::max(arena->peak, arena->used);
+            arena->head = block;
+            block->used = offset + bytes;
+            return BlockData(block) + offset;
+        }
+    }
+
+    // Appended, so earlier (rewound) blocks are used first next time
+    size_t size = std::max(arena->block_size, bytes + align);
+    ArenaBlock* block = static_cast<ArenaBlock*>(MemoryHeapAlloc(sizeof(ArenaBlock) + size));
+    block->next = nullptr;
+    block->size = size;
+    block->used = 0;
+    if (arena->first == nullptr)
+    {
+        arena->first = block;
+    }
+    else
+    {
+        ArenaBlock* last = arena->head != nullptr ? arena->head : arena->first;
+        while (last->next != nullptr)
+            last = last->next;
+        last->next = block;
+    }
+    arena->head = block;
+    arena->capacity += size;
+    arena->blocks++;
+    return ArenaAlloc(arena, bytes, align);
+}
+
+void* ArenaRealloc(Arena* arena, void* ptr, size_t bytes)
+{
+    if (ptr == nullptr)
+    {
+        uint8_t* memory = static_cast<uint8_t*>(ArenaAlloc(arena, REALLOC_HEADER + bytes, alignof(std::max_align_t)));
+        memcpy(memory, &bytes, sizeof(size_t));
+        return memory + REALLOC_HEADER;
+    }
+
+    uint8_t* header = static_cast<uint8_t*>(ptr) - REALLOC_HEADER;
+    size_t old_bytes;
+    memcpy(&old_bytes, header, sizeof(size_t));
+
+    // The latest allocation just moves the block's end
+    ArenaBlock* head = arena->head;
+    uintptr_t offset = reinterpret_cast<uintptr_t>(ptr) - reinterpret_cast<uintptr_t>(BlockData(head));
+    if (offset < head->used && offset + old_bytes == head->used && offset + bytes <= head->size)
+    {
+        arena->used = arena->used - head->used + offset + bytes;
+        arena->peak = std::max(arena->peak, arena->used);
+        head->used = offset + bytes;
+        memcpy(header, &bytes, sizeof(size_t));
+        return ptr;
+    }
+
+    if (bytes <= old_bytes)
+        return ptr;
+
+    void* memory = ArenaRealloc(arena, nullptr, bytes);
+    memcpy(memory, ptr, old_bytes);
+    return memory;
+}
+
+ArenaMark MarkArena(const Arena& arena)
+{
+    ArenaMark mark;
+    mark.block = arena.head;
+    mark.offset = arena.head != nullptr ? arena.head->used : 0;
+    mark.used = arena.used;
+    return mark;
+}
+
+void RewindArena(Arena* arena, ArenaMark mark)
+{
+    if (mark.block == nullptr)
+    {
+        ResetArena(arena);
+        return;
+    }
+
+    for (ArenaBlock* block = mark.block->next; block != nullptr; block = block->next)
+        block->used = 0;
+    mark.block->used = mark.offset;
+    arena->head = mark.block;
+    arena->used = mark.used;
+}
+
+void ResetArena(Arena* arena)
+{
+    for (ArenaBlock* block = arena->first; block != nullptr; block = block->next)
+        block->used = 0;
+    arena->head = arena->first;
+    arena->used = 0;
+}
+
+void CreatePool(Pool* pool, size_t block_size, int blocks_per_chunk)
+{
+    assert(pool->chunks == nullptr && blocks_per_chunk > 0);
+    const size_t align = alignof(std::max_align_t);
+    *pool = Pool();
+    pool->block_size = (std::max(block_size, sizeof(void*)) + align - 1) & ~(align - 1);
+    pool->blocks_per_chunk = blocks_per_chunk;
+}
+
+void DestroyPool(Pool* pool)
+{
+    assert(pool->allocated == 0 && "Pool destroyed with blocks still allocated");
+    void* chunk = pool->chunks;
+    while (chunk != nullptr)
+    {
+        void* next;
+        memcpy(&next, chunk, sizeof(void*));
+        MemoryHeapFree(chunk);
+        chunk = next;
+    }
+    *pool = Pool();
+}
+
+void* PoolAlloc(Pool* pool)
+{
+    assert(pool->block_size > 0);
+    if (pool->free_list == nullptr)
+    {
+        // First max_align_t of each chunk links the chunks; blocks follow
+        const size_t header = alignof(std::max_align_t);
+        uint8_t* chunk = static_cast<uint8_t*>(MemoryHeapAlloc(header + pool->block_size * pool->blocks_per_chunk));
+        memcpy(chunk, &pool->chunks, sizeof(void*));
+        pool->chunks = chunk;
+
+        // Threaded back to front so blocks are handed out in address order
+        for (int i = pool->blocks_per_chunk - 1; i >= 0; i--)
+        {
+            uint8_t* block = chunk + header + i * pool->block_size;
+            memcpy(block, &pool->free_list, sizeof(void*));
+            pool->free_list = block;
+        }
+        pool->capacity += pool->blocks_per_chunk;
+    }
+
+    void* block = pool->free_list;
+    memcpy(&pool->free_list, block, sizeof(void*));
+    pool->allocated++;
+    return block;
+}
+
+void PoolFree(Pool* pool, void* block)
+{
+    assert(block != nullptr && pool->allocated > 0);
+    memcpy(block, &pool->free_list, sizeof(void*));
+    pool->free_list = block;
+    pool->allocated--;
+}
+
+Arena* FrameArena()
+{
+    if (f_frame_arena.block_size == 0)
+        CreateArena(&f_frame_arena, FRAME_ARENA_BLOCK);
+    return &f_frame_arena;
+}
+
+Arena* ScratchArena()
+{
+    if (t_scratch.arena.block_size == 0)
+        CreateArena(&t_scratch.arena, SCRATCH_ARENA_BLOCK);
+    return &t_scratch.arena;
+}
+
+void ResetFrameMemory()
+{
+    Arena* arena = FrameArena();
+    uint64_t heap = f_heap_allocations.load(std::memory_order_relaxed);
+    f_stats.frame_bytes = arena->used;
+    f_stats.frame_peak = arena->peak;
+    f_stats.frame_capacity = arena->capacity;
+    f_stats.heap_allocations = heap;
+    f_stats.heap_allocations_frame = heap - f_frame_start;
+    f_stats.pool_fallbacks = f_pool_fallbacks.load(std::memory_order_relaxed);
+    f_frame_start = heap;
+    ResetArena(arena);
+}
+
+MemoryStats GetMemoryStats()
+{
+    return f_stats;
+}
+
+void PrintMemoryStats()
+{
+    const MemoryStats& stats = f_stats;
+    printf("Memory: frame arena %.1fKB (peak %.1fKB of %.1fKB), %llu heap allocations this frame (%llu total, %llu pool fallbacks)%s\n",
+        stats.frame_bytes / 1024.0, stats.frame_peak / 1024.0, stats.frame_capacity / 1024.0,
+        (unsigned long long)stats.heap_allocations_frame, (unsigned long long)stats.heap_allocations,
+        (unsigned long long)stats.pool_fallbacks, stats.heap_allocations_frame > 0 ? " <- not steady yet" : "");
+}
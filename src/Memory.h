@@ -0,0 +1,165 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Allocators for temporaries, so steady-state frames & repeated loads never reach the heap:
+// - Arena: bump allocation over a chain of blocks. Rewinding (to a mark, or fully with ResetArena) keeps every
+//   block, so once an arena has grown to its peak it stops allocating. Nothing is freed individually.
+// - Pool: fixed-size blocks on a free list, carved from chunks that are only returned by DestroyPool.
+// Both are single-threaded. FrameArena() belongs to the main thread and is reset every frame; every thread has
+// its own ScratchArena() for scoped work (loads), used through an ArenaScope.
+
+struct ArenaBlock;
+
+struct Arena
+{
+	ArenaBlock* first = nullptr;
+	ArenaBlock* head = nullptr;		// Block being allocated from; later ones are empty
+	size_t block_size = 0;			// Minimum size of new blocks
+	size_t used = 0;				// Since the last reset, alignment included
+	size_t peak = 0;
+	size_t capacity = 0;
+	int blocks = 0;
+};
+
+struct ArenaMark
+{
+	ArenaBlock* block = nullptr;
+	size_t offset = 0;
+	size_t used = 0;
+};
+
+void CreateArena(Arena* arena, size_t block_size);
+void DestroyArena(Arena* arena);
+
+// align must be a power of two
+void* ArenaAlloc(Arena* arena, size_t bytes, size_t align = alignof(std::max_align_t));
+
+// realloc for C libraries: allocations made through it carry a size header so they can be copied when grown.
+// The most recent one grows in place. ptr must be nullptr or come from ArenaRealloc on this arena.
+void* ArenaRealloc(Arena* arena, void* ptr, size_t bytes);
+
+template<typename T>
+T* ArenaAllocArray(Arena* arena, size_t count)
+{
+	return static_cast<T*>(ArenaAlloc(arena, count * sizeof(T), alignof(T)));
+}
+
+ArenaMark MarkArena(const Arena& arena);
+void RewindArena(Arena* arena, ArenaMark mark);
+void ResetArena(Arena* arena);
+
+// Everything allocated from the arena while in scope is released when it ends
+struct ArenaScope
+{
+	Arena* arena;
+	ArenaMark mark;
+
+	explicit ArenaScope(Arena* arena) : arena(arena), mark(MarkArena(*arena)) {}
+	~ArenaScope() { RewindArena(arena, mark); }
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+struct Pool
+{
+	void* free_list = nullptr;
+	void* chunks = nullptr;			// Singly linked through each chunk's first bytes
+	size_t block_size = 0;
+	int blocks_per_chunk = 0;
+	int allocated = 0;				// Blocks handed out
+	int capacity = 0;
+};
+
+// block_size is rounded up to hold a pointer & keep max_align_t alignment
+void CreatePool(Pool* pool, size_t block_size, int blocks_per_chunk);
+void DestroyPool(Pool* pool);
+
+void* PoolAlloc(Pool* pool);
+void PoolFree(Pool* pool, void* block);
+
+// Main thread's per-frame arena; ResetFrameMemory rewinds it
+Arena* FrameArena();
+
+// Calling thread's scratch arena (created on first use, freed at thread exit)
+Arena* ScratchArena();
+
+// Heap traffic of the arenas & pools, which should be 0 once a frame (or a repeated load) has warmed them up
+struct MemoryStats
+{
+	size_t frame_bytes = 0;				// FrameArena use during the last frame
+	size_t frame_peak = 0;
+	size_t frame_capacity = 0;
+	uint64_t heap_allocations = 0;		// Arena blocks, pool chunks & oversized pool requests, total
+	uint64_t heap_allocations_frame = 0;	// Of those, during the last frame
+	uint64_t pool_fallbacks = 0;		// PoolAllocator requests too large for their pool, total
+};
+
+// Main thread, once per frame before anything allocates from FrameArena()
+void ResetFrameMemory();
+
+MemoryStats GetMemoryStats();
+
+// One line: last frame's arena use & heap allocations (warns when a warmed-up frame allocated)
+void PrintMemoryStats();
+
+// Counted by the stats; arenas & pools get their blocks here
+void* MemoryHeapAlloc(size_t bytes);
+void MemoryHeapFree(void* memory);
+void CountPoolFallback();
+
+// std-compatible allocator over an arena. deallocate is a no-op: memory returns when the arena is rewound,
+// so containers should reserve up-front rather than grow.
+template<typename T>
+struct ArenaAllocator
+{
+	using value_type = T;
+	Arena* arena;
+
+	explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t n) { return ArenaAllocArray<T>(arena, n); }
+	void deallocate(T*, size_t) {}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+// std-compatible allocator over a pool, for node containers (lists, maps): single objects that fit the pool's
+// blocks come from it, anything else (bucket arrays, other rebinds) from the heap
+template<typename T>
+struct PoolAllocator
+{
+	using value_type = T;
+	Pool* pool;
+
+	explicit PoolAllocator(Pool* pool) : pool(pool) {}
+	template<typename U>
+	PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+	T* allocate(size_t n)
+	{
+		if (n == 1 && sizeof(T) <= pool->block_size && alignof(T) <= alignof(std::max_align_t))
+			return static_cast<T*>(PoolAlloc(pool));
+		CountPoolFallback();
+		return static_cast<T*>(MemoryHeapAlloc(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		if (n == 1 && sizeof(T) <= pool->block_size && alignof(T) <= alignof(std::max_align_t))
+			PoolFree(pool, p);
+		else
+			MemoryHeapFree(p);
+	}
+
+	template<typename U>
+	bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+	template<typename U>
+	bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+};
@@ -1,21 +1,52 @@
 ﻿#include "Mesh.h"
 #include "Buffer.h"
+#include "Memory.h"
+#include "Parallel.h"
+#include "Primitives.h"
+#include "Residency.h"
 #include <cstdio>
 #include <cassert>
-
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MESH_SSE2 1
+#endif
+
+// 32-bit indices so high-resolution surfaces can exceed 65536 vertices
+#define PAR_SHAPES_T uint32_t
 #define PAR_SHAPES_IMPLEMENTATION
 #include <par_shapes/par_shapes.h>
 
+// fast_obj's temporaries (growing arrays, names, read buffers) come from the loading thread's scratch arena,
+// so LoadMeshObj's only heap allocations are the mesh's own streams
+static void* ObjRealloc(void* ptr, size_t bytes)
+{
+    return ArenaRealloc(ScratchArena(), ptr, bytes);
+}
+
+static void ObjFree(void*)
+{
+}
+
+#define FAST_OBJ_REALLOC ObjRealloc
+#define FAST_OBJ_FREE ObjFree
 #define FAST_OBJ_IMPLEMENTATION
 #include <fast_obj/fast_obj.h>
 
 void LoadMeshGPU(Mesh* mesh);
+static void UploadMesh(Mesh* mesh, const MeshStreams& streams);
 void LoadMeshPar(Mesh* mesh, par_shapes_mesh* par);
 void LoadMeshPlaneOptimal(Mesh* mesh);
 void LoadMeshPlaneUnoptimal(Mesh* mesh);
 
 void LoadMeshObj(Mesh* mesh, const char* path)
 {
+    // Everything fast_obj allocated is released at once when this returns
+    ArenaScope scope(ScratchArena());
     fastObjMesh* obj = fast_obj_read(path);
     if (!obj)
     {
@@ -57,7 +88,7 @@ void LoadMeshObj(Mesh* mesh, const char* path)
             mesh->normals[i] = { 0.0f, 0.0f, 1.0f };
 
         // index → identity mapping
-        mesh->indices[i] = (uint16_t)i;
+        mesh->indices[i] = i;
     }
 
     mesh->vertex_count = (int)index_count;
@@ -67,8 +98,222 @@ void LoadMeshObj(Mesh* mesh, const char* path)
     LoadMeshGPU(mesh);
 }
 
+struct MeshCacheKey
+{
+    MeshShape shape;
+    int slices;
+    int stacks;
+    Matrix transform;
+};
+
+struct MeshCacheEntry
+{
+    MeshCacheKey key;
+    Mesh mesh;              // Owns the buffers & CPU geometry
+    MeshStreams baked;      // Static geometry instead of mesh's vectors (positions == nullptr otherwise)
+    int references = 0;     // 0 means the slot is free
+    size_t bytes = 0;
+};
+
+// Few distinct shapes are ever live at once, so a linear scan beats hashing a 76-byte key.
+// A deque so entries never move (see MeshOwner).
+static std::deque<MeshCacheEntry> f_mesh_cache;
+
+static bool SameMeshKey(const MeshCacheKey& a, const MeshCacheKey& b)
+{
+    return a.shape == b.shape && a.slices == b.slices && a.stacks == b.stacks &&
+        memcmp(&a.transform, &b.transform, sizeof(Matrix)) == 0;
+}
+
+static MeshStreams OwnedStreams(const Mesh& mesh)
+{
+    MeshStreams streams;
+    streams.positions = mesh.positions.data();
+    streams.tcoords = mesh.tcoords.empty() ? nullptr : mesh.tcoords.data();
+    streams.normals = mesh.normals.empty() ? nullptr : mesh.normals.data();
+    streams.indices = mesh.indices.empty() ? nullptr : mesh.indices.data();
+    streams.vertex_count = (int)mesh.positions.size();
+    streams.index_count = (int)mesh.indices.size();
+    return streams;
+}
+
+template<size_t V, size_t I>
+static MeshStreams BakedStreams(const BakedMesh<V, I>& baked)
+{
+    MeshStreams streams;
+    streams.positions = baked.positions;
+    streams.tcoords = baked.has_tcoords ? baked.tcoords : nullptr;
+    streams.normals = baked.normals;
+    streams.indices = baked.indices;
+    streams.vertex_count = baked.vertex_count;
+    streams.index_count = baked.index_count;
+    return streams;
+}
+
+static MeshStreams BakedStreams(MeshShape shape)
+{
+    switch (shape)
+    {
+    case MESH_SHAPE_TETRAHEDRON:
+        return BakedStreams(primitives::tetrahedron);
+
+    case MESH_SHAPE_CUBE:
+        return BakedStreams(primitives::cube);
+
+    case MESH_SHAPE_OCTAHEDRON:
+        return BakedStreams(primitives::octahedron);
+
+    case MESH_SHAPE_DODECAHEDRON:
+        return BakedStreams(primitives::dodecahedron);
+
+    case MESH_SHAPE_ICOSAHEDRON:
+        return BakedStreams(primitives::icosahedron);
+
+    case MESH_SHAPE_PLANE:
+        return BakedStreams(primitives::plane);
+
+    default:
+        assert(false);
+        return MeshStreams();
+    }
+}
+
+// Bytes of one copy of the streams (CPU or GPU)
+static size_t StreamBytes(const MeshStreams& streams)
+{
+    size_t vertex = sizeof(Vector3);
+    if (streams.tcoords != nullptr)
+        vertex += sizeof(Vector2);
+    if (streams.normals != nullptr)
+        vertex += sizeof(Vector3);
+    return streams.vertex_count * vertex + streams.index_count * sizeof(uint32_t);
+}
+
+static bool IsBaked(MeshShape shape, int slices)
+{
+    return shape <= MESH_SHAPE_ICOSAHEDRON || (shape == MESH_SHAPE_PLANE && slices == 0);
+}
+
+static void GenerateMeshShape(Mesh* mesh, MeshShape shape, int slices, int stacks)
+{
+    if (!IsBaked(shape, slices))
+    {
+        GenerateMeshSurface(mesh, shape, slices, stacks);
+        return;
+    }
+
+    // Baked geometry only needs a mutable copy when it's about to be transformed
+    MeshStreams baked = BakedStreams(shape);
+    mesh->positions.assign(baked.positions, baked.positions + baked.vertex_count);
+    mesh->normals.assign(baked.normals, baked.normals + baked.vertex_count);
+    if (baked.tcoords != nullptr)
+        mesh->tcoords.assign(baked.tcoords, baked.tcoords + baked.vertex_count);
+    mesh->indices.assign(baked.indices, baked.indices + baked.index_count);
+    mesh->vertex_count = baked.index_count;
+}
+
+static void TransformMesh(Mesh* mesh, Matrix transform)
+{
+    // Normals transform by the inverse-transpose so non-uniform scales keep them perpendicular
+    Matrix normal_matrix = MatrixTranspose(MatrixInvert(transform));
+    normal_matrix.m12 = normal_matrix.m13 = normal_matrix.m14 = 0.0f;
+
+    for (Vector3& position : mesh->positions)
+        position = Vector3Transform(position, transform);
+    for (Vector3& normal : mesh->normals)
+        normal = Vector3Normalize(Vector3Transform(normal, normal_matrix));
+}
+
+void LoadMeshShape(Mesh* mesh, MeshShape shape, int slices, int stacks, Matrix transform)
+{
+    assert(mesh->vao == GL_NONE && mesh->shared == -1);
+
+    // Shapes without slices/stacks must not split into separate entries over unused parameters
+    bool parametric = shape == MESH_SHAPE_SPHERE || shape == MESH_SHAPE_HEMISPHERE || shape == MESH_SHAPE_PLANE;
+    MeshCacheKey key{ shape, parametric ? slices : 0, parametric ? stacks : 0, transform };
+
+    int index = -1;
+    int free_index = -1;
+    for (int i = 0; i < (int)f_mesh_cache.size(); i++)
+    {
+        if (f_mesh_cache[i].references == 0)
+        {
+            if (free_index == -1)
+                free_index = i;
+        }
+        else if (SameMeshKey(f_mesh_cache[i].key, key))
+        {
+            index = i;
+            break;
+        }
+    }
+
+    if (index == -1)
+    {
+        if (free_index == -1)
+        {
+            free_index = (int)f_mesh_cache.size();
+            f_mesh_cache.emplace_back();
+        }
+
+        index = free_index;
+        MeshCacheEntry& entry = f_mesh_cache[index];
+        entry.key = key;
+        entry.mesh = Mesh();
+        entry.baked = MeshStreams();
+
+        Matrix identity = MatrixIdentity();
+        bool transformed = memcmp(&transform, &identity, sizeof(Matrix)) != 0;
+        if (IsBaked(shape, key.slices) && !transformed)
+        {
+            // Straight from static storage: no CPU copy, no heap allocation
+            entry.baked = BakedStreams(shape);
+            UploadMesh(&entry.mesh, entry.baked);
+            entry.mesh.vertex_count = entry.baked.index_count;
+            entry.bytes = StreamBytes(entry.baked);
+        }
+        else
+        {
+            GenerateMeshShape(&entry.mesh, shape, key.slices, key.stacks);
+            if (transformed)
+                TransformMesh(&entry.mesh, transform);
+            LoadMeshGPU(&entry.mesh);
+
+            // GPU buffers hold the same streams as the CPU copy
+            entry.bytes = StreamBytes(OwnedStreams(entry.mesh)) * 2;
+        }
+    }
+
+    MeshCacheEntry& entry = f_mesh_cache[index];
+    entry.references++;
+
+    // Share the GL objects only; CPU geometry stays with the entry
+    mesh->pbo = entry.mesh.pbo;
+    mesh->tbo = entry.mesh.tbo;
+    mesh->nbo = entry.mesh.nbo;
+    mesh->ibo = entry.mesh.ibo;
+    mesh->vao = entry.mesh.vao;
+    mesh->vertex_count = entry.mesh.vertex_count;
+    mesh->shared = index;
+}
+
 void UnloadMesh(Mesh* mesh)
 {
+    if (mesh->shared >= 0)
+    {
+        MeshCacheEntry& entry = f_mesh_cache[mesh->shared];
+        assert(entry.references > 0);
+        if (--entry.references == 0)
+        {
+            UnloadMesh(&entry.mesh);
+            entry.bytes = 0;
+        }
+
+        *mesh = Mesh();
+        return;
+    }
+
+    UntrackMesh(*mesh);
     DestroyVertexArray(&mesh->vao);
     DestroyBuffer(&mesh->pbo);
     DestroyBuffer(&mesh->tbo);
@@ -83,126 +328,416 @@ void UnloadMesh(Mesh* mesh)
     mesh->vertex_count = -1;
 }
 
-void LoadMeshPlane(Mesh* mesh)
+MeshStreams MeshGeometry(const Mesh& mesh)
 {
-    //par_shapes_mesh* par = par_shapes_create_plane(1, 1);
-    //par_shapes_translate(par, -0.5f, -0.5f, 0.0f);
-    //
-    //LoadMeshPar(mesh, par);
-    //par_shapes_free_mesh(par);
+    if (mesh.shared < 0)
+        return OwnedStreams(mesh);
 
-    LoadMeshPlaneUnoptimal(mesh);
-    LoadMeshGPU(mesh);
+    const MeshCacheEntry& entry = f_mesh_cache[mesh.shared];
+    return entry.baked.positions != nullptr ? entry.baked : OwnedStreams(entry.mesh);
 }
 
-void LoadMeshSphere(Mesh* mesh)
+MeshBounds ComputeMeshBounds(const Mesh& mesh)
 {
-    par_shapes_mesh* par = par_shapes_create_parametric_sphere(8, 8);
-    LoadMeshPar(mesh, par);
-    par_shapes_free_mesh(par);
+    MeshStreams streams = MeshGeometry(mesh);
+    MeshBounds bounds;
+    if (streams.vertex_count == 0)
+        return bounds;
 
-    LoadMeshGPU(mesh);
+    bounds.min = bounds.max = streams.positions[0];
+    for (int i = 1; i < streams.vertex_count; i++)
+    {
+        bounds.min = Vector3Min(bounds.min, streams.positions[i]);
+        bounds.max = Vector3Max(bounds.max, streams.positions[i]);
+    }
+    return bounds;
 }
 
-void LoadMeshHemisphere(Mesh* mesh)
+Mesh* MeshOwner(Mesh* mesh)
 {
-    par_shapes_mesh* par = par_shapes_create_hemisphere(4, 4);
-    LoadMeshPar(mesh, par);
-    par_shapes_free_mesh(par);
+    return mesh->shared < 0 ? mesh : &f_mesh_cache[mesh->shared].mesh;
+}
 
-    LoadMeshGPU(mesh);
+void ReleaseMeshGeometry(Mesh* mesh)
+{
+    Mesh* owner = MeshOwner(mesh);
+    if (mesh->shared >= 0)
+        f_mesh_cache[mesh->shared].bytes -= StreamBytes(OwnedStreams(*owner));
+
+    // swap rather than clear, which would keep the capacity
+    std::vector<Vector3>().swap(owner->positions);
+    std::vector<Vector2>().swap(owner->tcoords);
+    std::vector<Vector3>().swap(owner->normals);
+    std::vector<uint32_t>().swap(owner->indices);
 }
 
-void LoadMeshTetrahedron(Mesh* mesh)
+MeshCacheStats GetMeshCacheStats()
 {
-    par_shapes_mesh* par = par_shapes_create_tetrahedron();
-    LoadMeshPar(mesh, par);
-    par_shapes_free_mesh(par);
+    MeshCacheStats stats;
+    for (const MeshCacheEntry& entry : f_mesh_cache)
+    {
+        if (entry.references == 0)
+            continue;
 
-    LoadMeshGPU(mesh);
+        stats.entries++;
+        stats.references += entry.references;
+        stats.bytes_resident += entry.bytes;
+        stats.bytes_saved += entry.bytes * (entry.references - 1);
+    }
+    return stats;
 }
 
-void LoadMeshCube(Mesh* mesh)
+#if MESH_SSE2
+// Interleaves 4 vertices held as x, y, z lanes into 4 consecutive Vector3s
+static inline void StoreVector3x4(Vector3* dst, __m128 x, __m128 y, __m128 z)
 {
-    par_shapes_mesh* par = par_shapes_create_cube();
-    par_shapes_translate(par, -0.5f, -0.5f, -0.5f);
+    __m128 xy_lo = _mm_unpacklo_ps(x, y);                                   // x0 y0 x1 y1
+    __m128 xy_hi = _mm_unpackhi_ps(x, y);                                   // x2 y2 x3 y3
+    __m128 z0x1 = _mm_shuffle_ps(z, xy_lo, _MM_SHUFFLE(2, 2, 0, 0));        // z0 z0 x1 x1
+    __m128 y1z1 = _mm_shuffle_ps(xy_lo, z, _MM_SHUFFLE(1, 1, 3, 3));        // y1 y1 z1 z1
+    __m128 z2x3 = _mm_shuffle_ps(z, xy_hi, _MM_SHUFFLE(2, 2, 2, 2));        // z2 z2 x3 x3
+    __m128 y3z3 = _mm_shuffle_ps(xy_hi, z, _MM_SHUFFLE(3, 3, 3, 3));        // y3 y3 z3 z3
+
+    float* out = reinterpret_cast<float*>(dst);
+    _mm_storeu_ps(out + 0, _mm_shuffle_ps(xy_lo, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));   // x0 y0 z0 x1
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(y1z1, xy_hi, _MM_SHUFFLE(1, 0, 2, 0)));   // y1 z1 x2 y2
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));    // z2 x3 y3 z3
+}
+#endif
 
-    LoadMeshPar(mesh, par);
-    par_shapes_free_mesh(par);
+void GenerateMeshSurface(Mesh* mesh, MeshShape shape, int slices, int stacks)
+{
+    bool plane = shape == MESH_SHAPE_PLANE;
+    assert(plane || shape == MESH_SHAPE_SPHERE || shape == MESH_SHAPE_HEMISPHERE);
+    assert(plane ? slices >= 1 && stacks >= 1 : slices >= 3 && stacks >= 3);
+
+    // Same grid as par_shapes_create_parametric: row = stack (u), column = slice (v)
+    int columns = slices + 1;
+    int rows = stacks + 1;
+    size_t vertex_count = (size_t)columns * rows;
+    mesh->positions.resize(vertex_count);
+    mesh->normals.resize(vertex_count);
+    mesh->tcoords.resize(vertex_count);
+
+    // Longitude terms only depend on the column, latitude terms only on the row,
+    // so each vertex is two multiplies (the expressions mirror par_shapes__sphere/hemisphere bit for bit)
+    std::vector<float> vs(columns), cos_theta(columns), sin_theta(columns);
+    for (int slice = 0; slice < columns; slice++)
+    {
+        float v = (float)slice / slices;
+        float theta = shape == MESH_SHAPE_SPHERE ? v * 2 * PAR_PI : v * PAR_PI;
+        vs[slice] = v;
+        cos_theta[slice] = cosf(theta);
+        sin_theta[slice] = sinf(theta);
+    }
 
-    LoadMeshGPU(mesh);
+    size_t vertex_bytes = sizeof(Vector3) * 2 + sizeof(Vector2);
+    ParallelRows(rows, vertex_count * vertex_bytes, [&](int y0, int y1)
+    {
+        for (int stack = y0; stack < y1; stack++)
+        {
+            float u = (float)stack / stacks;
+            float phi = u * PAR_PI;
+            float sin_phi = sinf(phi);
+            float cos_phi = cosf(phi);
+
+            Vector3* positions = mesh->positions.data() + (size_t)stack * columns;
+            Vector3* normals = mesh->normals.data() + (size_t)stack * columns;
+            Vector2* tcoords = mesh->tcoords.data() + (size_t)stack * columns;
+
+            int slice = 0;
+#if MESH_SSE2
+            __m128 uu = _mm_set1_ps(u);
+            __m128 zero = _mm_setzero_ps();
+            __m128 one = _mm_set1_ps(1.0f);
+            __m128 sp = _mm_set1_ps(sin_phi);
+            __m128 cp = _mm_set1_ps(cos_phi);
+            for (; slice + 4 <= columns; slice += 4)
+            {
+                __m128 v = _mm_loadu_ps(vs.data() + slice);
+                float* uv = reinterpret_cast<float*>(tcoords + slice);
+                _mm_storeu_ps(uv + 0, _mm_unpacklo_ps(uu, v));
+                _mm_storeu_ps(uv + 4, _mm_unpackhi_ps(uu, v));
+
+                if (plane)
+                {
+                    StoreVector3x4(positions + slice, uu, v, zero);
+                    StoreVector3x4(normals + slice, zero, zero, one);
+                }
+                else
+                {
+                    // Unit sphere: the normal is the position
+                    __m128 x = _mm_mul_ps(_mm_loadu_ps(cos_theta.data() + slice), sp);
+                    __m128 y = _mm_mul_ps(_mm_loadu_ps(sin_theta.data() + slice), sp);
+                    StoreVector3x4(positions + slice, x, y, cp);
+                    StoreVector3x4(normals + slice, x, y, cp);
+                }
+            }
+#endif
+            for (; slice < columns; slice++)
+            {
+                tcoords[slice] = { u, vs[slice] };
+                if (plane)
+                {
+                    positions[slice] = { u, vs[slice], 0.0f };
+                    normals[slice] = Vector3UnitZ;
+                }
+                else
+                {
+                    positions[slice] = { cos_theta[slice] * sin_phi, sin_theta[slice] * sin_phi, cos_phi };
+                    normals[slice] = positions[slice];
+                }
+            }
+        }
+    });
+
+    // Each quad is two triangles; on a sphere the first stack's first triangle and the last stack's
+    // second triangle have two vertices on a pole, which par_shapes_remove_degenerate culls.
+    // Knowing that up front puts every stack at a fixed offset, so stacks are written independently.
+    int skipped = plane ? 0 : slices;
+    size_t triangle_count = (size_t)2 * slices * stacks - 2 * (size_t)skipped;
+    mesh->indices.resize(triangle_count * 3);
+    mesh->vertex_count = (int)(triangle_count * 3);
+
+    ParallelRows(stacks, mesh->indices.size() * sizeof(uint32_t), [&](int y0, int y1)
+    {
+        for (int stack = y0; stack < y1; stack++)
+        {
+            bool first = !plane && stack == 0;
+            bool last = !plane && stack == stacks - 1;
+            size_t offset = stack == 0 ? 0 : (size_t)stack * 2 * slices - skipped;
+            uint32_t* face = mesh->indices.data() + offset * 3;
+
+            uint32_t v = (uint32_t)stack * columns;
+            for (uint32_t slice = 0; slice < (uint32_t)slices; slice++)
+            {
+                uint32_t next = slice + 1;
+                if (!first)
+                {
+                    *face++ = v + slice + columns;
+                    *face++ = v + next;
+                    *face++ = v + slice;
+                }
+                if (!last)
+                {
+                    *face++ = v + slice + columns;
+                    *face++ = v + next + columns;
+                    *face++ = v + next;
+                }
+            }
+        }
+    });
 }
 
-void LoadMeshOctahedron(Mesh* mesh)
+void BenchmarkMeshGeneration()
 {
-    par_shapes_mesh* par = par_shapes_create_octahedron();
-    LoadMeshPar(mesh, par);
-    par_shapes_free_mesh(par);
+    using Clock = std::chrono::high_resolution_clock;
+    const int slices = 1024;
+    const int stacks = 512;
+    const int iterations = 10;
 
-    LoadMeshGPU(mesh);
+    struct Surface
+    {
+        const char* name;
+        MeshShape shape;
+        par_shapes_mesh* (*create)(int, int);
+    };
+    const Surface surfaces[] =
+    {
+        { "sphere", MESH_SHAPE_SPHERE, par_shapes_create_parametric_sphere },
+        { "hemisphere", MESH_SHAPE_HEMISPHERE, par_shapes_create_hemisphere },
+        { "plane", MESH_SHAPE_PLANE, par_shapes_create_plane }
+    };
+
+    // par_shapes welds and culls against absolute distances/areas that every triangle falls under at this
+    // resolution (its weld asserts); shrink them so only true coincidences count, as the native path assumes
+    par_shapes_set_epsilon_welded_normals(1e-12f);
+    par_shapes_set_epsilon_degenerate_sphere(1e-9f);
+
+    printf("Mesh generation benchmark (%ix%i, %i threads):\n", slices, stacks, (int)std::thread::hardware_concurrency());
+    for (const Surface& surface : surfaces)
+    {
+        Mesh mesh;
+        auto begin = Clock::now();
+        for (int i = 0; i < iterations; i++)
+            GenerateMeshSurface(&mesh, surface.shape, slices, stacks);
+        double native = std::chrono::duration<double>(Clock::now() - begin).count() / iterations;
+        double mtris = mesh.indices.size() / 3 * 1e-6;
+
+        // What GenerateMeshShape used to do: par_shapes (welded normals), recompute normals, copy into the mesh
+        Mesh reference;
+        begin = Clock::now();
+        par_shapes_mesh* par = surface.create(slices, stacks);
+        LoadMeshPar(&reference, par);
+        par_shapes_free_mesh(par);
+        double parametric = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        printf("  %-10s %.2fM tris  native: %8.3f ms %7.1f Mtris/s  par_shapes: %8.3f ms  (%.1fx)%s\n",
+            surface.name, mtris, native * 1e3, mtris / native, parametric * 1e3, parametric / native,
+            reference.indices == mesh.indices ? "" : "  TOPOLOGY MISMATCH");
+
+        UnloadMesh(&mesh);
+        UnloadMesh(&reference);
+    }
+
+    // par_shapes defaults
+    par_shapes_set_epsilon_welded_normals(0.001f);
+    par_shapes_set_epsilon_degenerate_sphere(0.0001f);
 }
 
-void LoadMeshDodecahedron(Mesh* mesh)
+static bool CompareStreams(const char* name, const MeshStreams& baked, const MeshStreams& reference)
 {
-    par_shapes_mesh* par = par_shapes_create_dodecahedron();
-    LoadMeshPar(mesh, par);
-    par_shapes_free_mesh(par);
+    bool match = baked.vertex_count == reference.vertex_count && baked.index_count == reference.index_count &&
+        (baked.tcoords == nullptr) == (reference.tcoords == nullptr);
+    if (match)
+    {
+        // Same literals and the same float ops, so positions & indices are exact; normals differ only by sqrt rounding
+        match = memcmp(baked.positions, reference.positions, baked.vertex_count * sizeof(Vector3)) == 0 &&
+            memcmp(baked.indices, reference.indices, baked.index_count * sizeof(uint32_t)) == 0;
+        if (baked.tcoords != nullptr)
+            match = match && memcmp(baked.tcoords, reference.tcoords, baked.vertex_count * sizeof(Vector2)) == 0;
+        for (int i = 0; match && i < baked.vertex_count; i++)
+            match = Vector3Distance(baked.normals[i], reference.normals[i]) < 1e-6f;
+    }
 
-    LoadMeshGPU(mesh);
+    if (!match)
+        printf("Baked %s does not match its reference\n", name);
+    return match;
 }
 
-void LoadMeshIcosahedron(Mesh* mesh)
+bool VerifyBakedMeshes()
 {
-    par_shapes_mesh* par = par_shapes_create_icosahedron();
-    LoadMeshPar(mesh, par);
-    par_shapes_free_mesh(par);
+    struct Solid
+    {
+        const char* name;
+        MeshShape shape;
+        par_shapes_mesh* (*create)();
+    };
+    const Solid solids[] =
+    {
+        { "tetrahedron", MESH_SHAPE_TETRAHEDRON, par_shapes_create_tetrahedron },
+        { "cube", MESH_SHAPE_CUBE, par_shapes_create_cube },
+        { "octahedron", MESH_SHAPE_OCTAHEDRON, par_shapes_create_octahedron },
+        { "dodecahedron", MESH_SHAPE_DODECAHEDRON, par_shapes_create_dodecahedron },
+        { "icosahedron", MESH_SHAPE_ICOSAHEDRON, par_shapes_create_icosahedron }
+    };
+
+    bool match = true;
+    for (const Solid& solid : solids)
+    {
+        // The runtime path this replaced: par_shapes, smooth normals, then LoadMeshCube's translate
+        Mesh reference;
+        par_shapes_mesh* par = solid.create();
+        LoadMeshPar(&reference, par);
+        par_shapes_free_mesh(par);
+        if (solid.shape == MESH_SHAPE_CUBE)
+        {
+            for (Vector3& position : reference.positions)
+                position = position + Vector3{ -0.5f, -0.5f, -0.5f };
+        }
 
-    LoadMeshGPU(mesh);
+        match = CompareStreams(solid.name, BakedStreams(solid.shape), OwnedStreams(reference)) && match;
+    }
+
+    Mesh plane;
+    LoadMeshPlaneOptimal(&plane);
+    match = CompareStreams("plane", BakedStreams(MESH_SHAPE_PLANE), OwnedStreams(plane)) && match;
+
+    printf("Baked meshes %s\n", match ? "match par_shapes" : "DIFFER from par_shapes");
+    return match;
+}
+
+void LoadMeshPlane(Mesh* mesh)
+{
+    LoadMeshShape(mesh, MESH_SHAPE_PLANE, 0, 0, MatrixIdentity());
+}
+
+void LoadMeshSphere(Mesh* mesh)
+{
+    LoadMeshShape(mesh, MESH_SHAPE_SPHERE, 8, 8, MatrixIdentity());
+}
+
+void LoadMeshHemisphere(Mesh* mesh)
+{
+    LoadMeshShape(mesh, MESH_SHAPE_HEMISPHERE, 4, 4, MatrixIdentity());
+}
+
+void LoadMeshTetrahedron(Mesh* mesh)
+{
+    LoadMeshShape(mesh, MESH_SHAPE_TETRAHEDRON, 0, 0, MatrixIdentity());
+}
+
+void LoadMeshCube(Mesh* mesh)
+{
+    LoadMeshShape(mesh, MESH_SHAPE_CUBE, 0, 0, MatrixIdentity());
+}
+
+void LoadMeshOctahedron(Mesh* mesh)
+{
+    LoadMeshShape(mesh, MESH_SHAPE_OCTAHEDRON, 0, 0, MatrixIdentity());
+}
+
+void LoadMeshDodecahedron(Mesh* mesh)
+{
+    LoadMeshShape(mesh, MESH_SHAPE_DODECAHEDRON, 0, 0, MatrixIdentity());
+}
+
+void LoadMeshIcosahedron(Mesh* mesh)
+{
+    LoadMeshShape(mesh, MESH_SHAPE_ICOSAHEDRON, 0, 0, MatrixIdentity());
 }
 
 void DrawMesh(const Mesh& mesh)
 {
-    BindVertexArray(mesh.vao);
-    if (mesh.ibo != GL_NONE)
-        glDrawElements(GL_TRIANGLES, mesh.vertex_count, GL_UNSIGNED_SHORT, nullptr);
+    DrawVertexArray(mesh.vao, mesh.vertex_count, mesh.ibo != GL_NONE);
+}
+
+void DrawVertexArray(GLuint vao, int vertex_count, bool indexed)
+{
+    if (!UseResidentMesh(vao))
+        return;
+
+    BindVertexArray(vao);
+    if (indexed)
+        glDrawElements(GL_TRIANGLES, vertex_count, GL_UNSIGNED_INT, nullptr);
     else
-        glDrawArrays(GL_TRIANGLES, 0, mesh.vertex_count);
-    UnbindVertexArray(mesh.vao);
+        glDrawArrays(GL_TRIANGLES, 0, vertex_count);
+    UnbindVertexArray(vao);
 }
 
-void LoadMeshGPU(Mesh* mesh)
+static void UploadMesh(Mesh* mesh, const MeshStreams& streams)
 {
-    assert(!mesh->positions.empty());
+    assert(streams.positions != nullptr && streams.vertex_count > 0);
     mesh->pbo = CreateBuffer();
     BindVertexBuffer(mesh->pbo);
-    UpdateVertexBuffer(mesh->positions.data(), mesh->positions.size() * sizeof(Vector3));
+    UpdateVertexBuffer(streams.positions, streams.vertex_count * sizeof(Vector3));
     UnbindVertexBuffer(mesh->pbo);
 
-    if (!mesh->tcoords.empty())
+    if (streams.tcoords != nullptr)
     {
         mesh->tbo = CreateBuffer();
         BindVertexBuffer(mesh->tbo);
-        UpdateVertexBuffer(mesh->tcoords.data(), mesh->tcoords.size() * sizeof(Vector2));
+        UpdateVertexBuffer(streams.tcoords, streams.vertex_count * sizeof(Vector2));
         UnbindVertexBuffer(mesh->tbo);
     }
     else
         printf("Warning: mesh loaded without texture coordinates\n");
 
-    if (!mesh->normals.empty())
+    if (streams.normals != nullptr)
     {
         mesh->nbo = CreateBuffer();
         BindVertexBuffer(mesh->nbo);
-        UpdateVertexBuffer(mesh->normals.data(), mesh->normals.size() * sizeof(Vector3));
+        UpdateVertexBuffer(streams.normals, streams.vertex_count * sizeof(Vector3));
         UnbindVertexBuffer(mesh->nbo);
     }
     else
         printf("Warning: mesh loaded without normals\n");
 
-    if (!mesh->indices.empty())
+    if (streams.indices != nullptr)
     {
         mesh->ibo = CreateBuffer();
         BindIndexBuffer(mesh->ibo);
-            UpdateElementBuffer(mesh->indices.data(), mesh->indices.size() * sizeof(uint16_t));
+            UpdateElementBuffer(streams.indices, streams.index_count * sizeof(uint32_t));
         UnbindIndexBuffer(mesh->ibo);
     }
     else
@@ -243,27 +778,27 @@ void LoadMeshGPU(Mesh* mesh)
         UnbindIndexBuffer(mesh->ibo);
 }
 
+void LoadMeshGPU(Mesh* mesh)
+{
+    UploadMesh(mesh, OwnedStreams(*mesh));
+}
+
 void LoadMeshPar(Mesh* mesh, par_shapes_mesh* par)
 {
     // Platonic solids only contain positions initially
     // ntriangles * 3 = vertex_count (amount of elements in index buffer)
     par_shapes_compute_normals(par);
 
+    // assign sizes each stream once & copies straight in (resize would zero-fill first)
     mesh->vertex_count = par->ntriangles * 3;
-    mesh->indices.resize(mesh->vertex_count);
-    mesh->positions.resize(par->npoints);
-    mesh->normals.resize(par->npoints);
-    if (par->tcoords != nullptr)
-        mesh->tcoords.resize(par->npoints);
-
-    Vector3* par_positions = reinterpret_cast<Vector3*>(par->points);
-    Vector3* par_normals = reinterpret_cast<Vector3*>(par->normals);
-    Vector2* par_tcoords = reinterpret_cast<Vector2*>(par->tcoords);
-    memcpy(mesh->positions.data(), par_positions, par->npoints * sizeof(Vector3));
-    memcpy(mesh->normals.data(), par_normals, par->npoints * sizeof(Vector3));
-    memcpy(mesh->indices.data(), par->triangles, mesh->vertex_count * sizeof(PAR_SHAPES_T));
+    const Vector3* par_positions = reinterpret_cast<const Vector3*>(par->points);
+    const Vector3* par_normals = reinterpret_cast<const Vector3*>(par->normals);
+    const Vector2* par_tcoords = reinterpret_cast<const Vector2*>(par->tcoords);
+    mesh->positions.assign(par_positions, par_positions + par->npoints);
+    mesh->normals.assign(par_normals, par_normals + par->npoints);
+    mesh->indices.assign(par->triangles, par->triangles + mesh->vertex_count);
     if (par_tcoords != nullptr)
-        memcpy(mesh->tcoords.data(), par_tcoords, par->npoints * sizeof(Vector2));
+        mesh->tcoords.assign(par_tcoords, par_tcoords + par->npoints);
 }
 
 void LoadMeshPlaneOptimal(Mesh* mesh)
@@ -302,10 +837,12 @@ void LoadMeshPlaneUnoptimal(Mesh* mesh)
 {
     mesh->vertex_count = 6;
 
-    std::vector<Vector3> positions;
-    std::vector<Vector2> tcoords;
-    std::vector<Vector3> normals;
-    std::vector<uint16_t> indices;
+    // Temporaries from the scratch arena, released on return
+    ArenaScope scope(ScratchArena());
+    std::vector<Vector3, ArenaAllocator<Vector3>> positions(ArenaAllocator<Vector3>(scope.arena));
+    std::vector<Vector2, ArenaAllocator<Vector2>> tcoords(ArenaAllocator<Vector2>(scope.arena));
+    std::vector<Vector3, ArenaAllocator<Vector3>> normals(ArenaAllocator<Vector3>(scope.arena));
+    std::vector<uint32_t, ArenaAllocator<uint32_t>> indices(ArenaAllocator<uint32_t>(scope.arena));
 
     positions.resize(4);
     tcoords.resize(4);
@@ -339,7 +876,7 @@ void LoadMeshPlaneUnoptimal(Mesh* mesh)
     mesh->normals.resize(6);
     for (size_t i = 0; i < indices.size(); i++)
     {
-        uint16_t index = indices[i];
+        uint32_t index = indices[i];
         Vector3 v = positions[index];
         Vector2 vt = tcoords[index];
         Vector3 vn = normals[index];
@@ -12,7 +12,7 @@ struct Mesh
 	std::vector<Vector3> positions;
 	std::vector<Vector2> tcoords;
 	std::vector<Vector3> normals;
-	std::vector<uint16_t> indices;
+	std::vector<uint32_t> indices;
 
 	GLuint pbo = GL_NONE;	// positions buffer
 	GLuint tbo = GL_NONE;	// tcoords buffer
@@ -21,10 +21,85 @@ struct Mesh
 
 	GLuint vao = GL_NONE;
 	int vertex_count = -1;
+
+	// Geometry cache entry this mesh references (-1 if it owns its buffers).
+	// Shared meshes leave the CPU vectors empty; see MeshGeometry.
+	int shared = -1;
+};
+
+// Read-only view of a mesh's CPU geometry, wherever it lives (the mesh, a cache entry or baked static data)
+struct MeshStreams
+{
+	const Vector3* positions = nullptr;
+	const Vector2* tcoords = nullptr;	// nullptr if absent
+	const Vector3* normals = nullptr;	// nullptr if absent
+	const uint32_t* indices = nullptr;	// nullptr for non-indexed meshes
+	int vertex_count = 0;
+	int index_count = 0;
+};
+
+// Parametric/platonic shapes go through a geometry cache keyed on (shape, slices, stacks, transform):
+// identical requests share one reference-counted set of GPU buffers & one CPU copy.
+// Platonic solids (the cube centred on the origin) and the 0-slice plane are baked at compile time;
+// with an identity transform they upload straight from static storage.
+enum MeshShape
+{
+	MESH_SHAPE_TETRAHEDRON,
+	MESH_SHAPE_CUBE,
+	MESH_SHAPE_OCTAHEDRON,
+	MESH_SHAPE_DODECAHEDRON,
+	MESH_SHAPE_ICOSAHEDRON,
+	MESH_SHAPE_PLANE,
+	MESH_SHAPE_SPHERE,
+	MESH_SHAPE_HEMISPHERE,
+	MESH_SHAPE_COUNT
+};
+
+struct MeshCacheStats
+{
+	int entries = 0;			// Unique geometry resident
+	int references = 0;			// Meshes using it
+	size_t bytes_resident = 0;	// CPU + GPU bytes actually allocated
+	size_t bytes_saved = 0;		// CPU + GPU bytes that duplicate loads would have allocated
 };
 
+// slices & stacks are ignored by the platonic solids; a plane with 0 slices is the centred unit quad
+void LoadMeshShape(Mesh* mesh, MeshShape shape, int slices, int stacks, Matrix transform);
+
+// Releases the cache reference for shared meshes (geometry is freed with the last one)
 void UnloadMesh(Mesh* mesh);
 
+// CPU-side geometry, whether the mesh owns it or shares it through the cache
+MeshStreams MeshGeometry(const Mesh& mesh);
+
+// Local-space axis-aligned box around the mesh's positions (zero-sized for a mesh without CPU geometry)
+struct MeshBounds
+{
+	Vector3 min = Vector3Zeros;
+	Vector3 max = Vector3Zeros;
+};
+
+MeshBounds ComputeMeshBounds(const Mesh& mesh);
+
+// The mesh holding mesh's buffers & CPU geometry: mesh itself, or its cache entry's (whose address never changes)
+Mesh* MeshOwner(Mesh* mesh);
+
+// Frees the owner's CPU streams; MeshGeometry returns empty streams afterwards (baked geometry is unaffected)
+void ReleaseMeshGeometry(Mesh* mesh);
+
+MeshCacheStats GetMeshCacheStats();
+
+// Fills the CPU streams of a sphere, hemisphere or plane (slices/stacks as in par_shapes) in parallel.
+// Vertex order, UVs & triangle order match par_shapes_create_*, but normals are analytic
+// and only the structurally degenerate pole triangles are dropped (never small-but-valid ones).
+void GenerateMeshSurface(Mesh* mesh, MeshShape shape, int slices, int stacks);
+
+// Prints native vs par_shapes generation time for 1M+ triangle surfaces
+void BenchmarkMeshGeneration();
+
+// Checks the baked primitives against par_shapes (and the plane against LoadMeshPlaneOptimal), printing mismatches
+bool VerifyBakedMeshes();
+
 void LoadMeshTetrahedron(Mesh* mesh);
 void LoadMeshCube(Mesh* mesh);
 void LoadMeshOctahedron(Mesh* mesh);
@@ -37,4 +112,7 @@ void LoadMeshHemisphere(Mesh* mesh);
 
 void LoadMeshObj(Mesh* mesh, const char* path);
 
-void DrawMesh(const Mesh& mesh);
\ No newline at end of file
+void DrawMesh(const Mesh& mesh);
+
+// What DrawMesh issues, for callers that only kept the mesh's GL handles (see DrawList)
+void DrawVertexArray(GLuint vao, int vertex_count, bool indexed);
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "Jobs.h"
+
+// Below this many bytes a kernel isn't worth spreading across threads
+constexpr size_t PARALLEL_THRESHOLD = 1 << 18;
+
+// Calls fn(y0, y1) over contiguous bands of rows, one band per hardware thread.
+// Bands run as jobs when called from a job system thread, otherwise on short-lived threads.
+template<typename Fn>
+void ParallelRows(int rows, size_t bytes, Fn fn)
+{
+    if (bytes >= PARALLEL_THRESHOLD && JobThreadIndex() >= 0 && JobThreadCount() > 1)
+    {
+        ParallelFor(rows, 1, fn);
+        return;
+    }
+
+    int threads = 1;
+    if (bytes >= PARALLEL_THRESHOLD)
+        threads = std::min((int)std::max(1u, std::thread::hardware_concurrency()), rows);
+
+    if (threads <= 1)
+    {
+        fn(0, rows);
+        return;
+    }
+
+    int band = (rows + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (int y0 = band; y0 < rows; y0 += band)
+        workers.emplace_back(fn, y0, std::min(rows, y0 + band));
+
+    fn(0, std::min(rows, band));
+    for (std::thread& worker : workers)
+        worker.join();
+}
@@ -0,0 +1,368 @@
+#include "Picking.h"
+#include "Shader.h"
+#include "Window.h"
+#include <glad/glad.h>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+struct Pickable
+{
+    const Mesh* mesh = nullptr;
+    Matrix world = MatrixIdentity();
+    MeshBounds local;
+    bool empty = true;          // No CPU geometry for bounds: never culled
+    bool visible = true;
+    bool alive = false;
+    uint32_t generation = 0;    // Bumped when the handle is removed, so picks of its previous owner don't resolve to it
+};
+
+// One readback of the region; busy while its fence is set
+struct PickSlot
+{
+    GLuint pbo = GL_NONE;
+    GLsync fence = nullptr;
+    Vector2 position = Vector2Zeros;
+    uint64_t frame = 0;
+};
+
+struct Picking
+{
+    int region = 0;
+    GLuint fbo = GL_NONE;
+    GLuint ids = GL_NONE;       // RGBA32UI: pickable + 1 (0 = nothing), triangle, pickable generation
+    GLuint depth = GL_NONE;
+    GLuint program = GL_NONE;
+
+    std::vector<Pickable> pickables;
+    std::vector<int> free_pickables;
+
+    std::vector<PickSlot> slots;
+    int next = 0;               // Round robin, so slots also retire in this order
+    uint64_t frame = 0;
+
+    bool pending = false;
+    Vector2 request = Vector2Zeros;
+
+    bool has_result = false;
+    PickResult result;
+
+    PickingStats stats;
+};
+
+static Picking f_picking;
+
+void CreatePicking(int region, int ring_size)
+{
+    assert(f_picking.program == GL_NONE && region > 0 && (region & 1) == 1 && ring_size > 0);
+    f_picking.region = region;
+
+    glGenRenderbuffers(1, &f_picking.ids);
+    glBindRenderbuffer(GL_RENDERBUFFER, f_picking.ids);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA32UI, region, region);
+    glGenRenderbuffers(1, &f_picking.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, f_picking.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, region, region);
+    glBindRenderbuffer(GL_RENDERBUFFER, GL_NONE);
+
+    glGenFramebuffers(1, &f_picking.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, f_picking.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, f_picking.ids);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, f_picking.depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        printf("Picking framebuffer incomplete\n");
+    glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+
+    // RGBA_INTEGER is the one integer read format every implementation has to accept
+    size_t bytes = (size_t)region * region * 4 * sizeof(uint32_t);
+    f_picking.slots.resize(ring_size);
+    for (PickSlot& slot : f_picking.slots)
+    {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+
+    GLuint vs = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/pick_id.vert");
+    GLuint fs = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/pick_id.frag");
+    f_picking.program = CreateProgram(vs, fs);
+    DestroyShader(&vs);
+    DestroyShader(&fs);
+}
+
+void DestroyPicking()
+{
+    for (PickSlot& slot : f_picking.slots)
+    {
+        if (slot.fence != nullptr)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.pbo);
+    }
+    glDeleteFramebuffers(1, &f_picking.fbo);
+    glDeleteRenderbuffers(1, &f_picking.ids);
+    glDeleteRenderbuffers(1, &f_picking.depth);
+    DestroyProgram(&f_picking.program);
+    f_picking = Picking();
+}
+
+int AddPickable(const Mesh& mesh, Matrix world)
+{
+    int id = (int)f_picking.pickables.size();
+    if (!f_picking.free_pickables.empty())
+    {
+        id = f_picking.free_pickables.back();
+        f_picking.free_pickables.pop_back();
+    }
+    else
+    {
+        f_picking.pickables.emplace_back();
+    }
+
+    Pickable& pickable = f_picking.pickables[id];
+    pickable.mesh = &mesh;
+    pickable.world = world;
+    pickable.local = ComputeMeshBounds(mesh);
+    pickable.empty = pickable.local.min.x == pickable.local.max.x &&
+        pickable.local.min.y == pickable.local.max.y && pickable.local.min.z == pickable.local.max.z;
+    pickable.visible = true;
+    pickable.alive = true;
+    return id;
+}
+
+void SetPickableWorld(int pickable, Matrix world)
+{
+    assert(f_picking.pickables[pickable].alive);
+    f_picking.pickables[pickable].world = world;
+}
+
+void SetPickableVisible(int pickable, bool visible)
+{
+    assert(f_picking.pickables[pickable].alive);
+    f_picking.pickables[pickable].visible = visible;
+}
+
+void RemovePickable(int pickable)
+{
+    assert(f_picking.pickables[pickable].alive);
+    uint32_t generation = f_picking.pickables[pickable].generation;
+    f_picking.pickables[pickable] = Pickable();
+    f_picking.pickables[pickable].generation = generation + 1;
+    f_picking.free_pickables.push_back(pickable);
+}
+
+void RequestPick(Vector2 position)
+{
+    if (!f_picking.pending)
+        f_picking.stats.requested++;
+    f_picking.pending = true;
+    f_picking.request = position;
+}
+
+// Clip space -> clip space, scaling the region's slice of NDC up to fill it (x' = (x - cx w) / sx, same for y)
+static Matrix PickMatrix(Vector2 position, int width, int height, int region)
+{
+    float cx = (floorf(position.x) + 0.5f) * 2.0f / width - 1.0f;
+    float cy = 1.0f - (floorf(position.y) + 0.5f) * 2.0f / height;
+    float sx = (float)region / width;
+    float sy = (float)region / height;
+
+    Matrix pick = MatrixIdentity();
+    pick.m0 = 1.0f / sx;
+    pick.m5 = 1.0f / sy;
+    pick.m12 = -cx / sx;
+    pick.m13 = -cy / sy;
+    return pick;
+}
+
+// Culled when all 8 corners of the local box fall outside the same clip plane
+static bool BoundsInRegion(const MeshBounds& bounds, const Matrix& mvp)
+{
+    unsigned int outside = 0x3f;
+    for (int i = 0; i < 8; i++)
+    {
+        float px = i & 1 ? bounds.max.x : bounds.min.x;
+        float py = i & 2 ? bounds.max.y : bounds.min.y;
+        float pz = i & 4 ? bounds.max.z : bounds.min.z;
+        float x = mvp.m0 * px + mvp.m4 * py + mvp.m8 * pz + mvp.m12;
+        float y = mvp.m1 * px + mvp.m5 * py + mvp.m9 * pz + mvp.m13;
+        float z = mvp.m2 * px + mvp.m6 * py + mvp.m10 * pz + mvp.m14;
+        float w = mvp.m3 * px + mvp.m7 * py + mvp.m11 * pz + mvp.m15;
+
+        unsigned int code = 0;
+        code |= x < -w ? 0x01 : 0;
+        code |= x > w ? 0x02 : 0;
+        code |= y < -w ? 0x04 : 0;
+        code |= y > w ? 0x08 : 0;
+        code |= z < -w ? 0x10 : 0;
+        code |= z > w ? 0x20 : 0;
+        outside &= code;
+        if (outside == 0)
+            return true;
+    }
+    return false;
+}
+
+// The cursor's pixel if anything covers it, otherwise the closest covered pixel
+static void ResolveSlot(PickSlot* slot)
+{
+    int region = f_picking.region;
+    size_t bytes = (size_t)region * region * 4 * sizeof(uint32_t);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    const uint32_t* pixels = (const uint32_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+
+    PickResult result;
+    uint32_t generation = 0;
+    result.position = slot->position;
+    result.frame = slot->frame;
+    result.latency = (int)(f_picking.frame - slot->frame);
+    if (pixels != nullptr)
+    {
+        int centre = region / 2;
+        int best = region * region;
+        for (int y = 0; y < region; y++)
+        {
+            for (int x = 0; x < region; x++)
+            {
+                const uint32_t* pixel = pixels + (y * region + x) * 4;
+                int distance = (x - centre) * (x - centre) + (y - centre) * (y - centre);
+                if (pixel[0] == 0 || distance >= best)
+                    continue;
+                best = distance;
+                result.object = (int)pixel[0] - 1;
+                result.triangle = (int)pixel[1];
+                generation = pixel[2];
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+
+    glDeleteSync(slot->fence);
+    slot->fence = nullptr;
+
+    // Handles removed since the pick was rendered resolve to nothing, even once they've been reused
+    if (result.object >= (int)f_picking.pickables.size() || (result.object >= 0 &&
+        (!f_picking.pickables[result.object].alive || f_picking.pickables[result.object].generation != generation)))
+    {
+        result.object = -1;
+        result.triangle = -1;
+    }
+    f_picking.result = result;
+    f_picking.has_result = true;
+    f_picking.stats.resolved++;
+}
+
+// Oldest first; stops at the first readback still running, since later ones were issued after it
+static void RetireReadbacks()
+{
+    int count = (int)f_picking.slots.size();
+    for (int i = 0; i < count; i++)
+    {
+        PickSlot& slot = f_picking.slots[(f_picking.next + i) % count];
+        if (slot.fence == nullptr)
+            continue;
+
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        ResolveSlot(&slot);
+    }
+}
+
+static void RenderPick(PickSlot* slot, Matrix view, Matrix proj, int width, int height)
+{
+    int region = f_picking.region;
+    Matrix view_proj = view * proj * PickMatrix(f_picking.request, width, height, region);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, f_picking.fbo);
+    glViewport(0, 0, region, region);
+    const GLuint none[4] = { 0, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, none);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+
+    PickingStats& stats = f_picking.stats;
+    stats.drawn = 0;
+    stats.culled = 0;
+    BeginShader(f_picking.program);
+    for (int i = 0; i < (int)f_picking.pickables.size(); i++)
+    {
+        const Pickable& pickable = f_picking.pickables[i];
+        if (!pickable.alive || !pickable.visible)
+            continue;
+
+        Matrix mvp = pickable.world * view_proj;
+        if (!pickable.empty && !BoundsInRegion(pickable.local, mvp))
+        {
+            stats.culled++;
+            continue;
+        }
+
+        SendMat4(mvp, "u_mvp");
+        SendInt(i + 1, "u_object");
+        SendInt((int)pickable.generation, "u_generation");
+        DrawMesh(*pickable.mesh);
+        stats.drawn++;
+    }
+    EndShader();
+
+    // Into the buffer, not client memory, so this returns without waiting for the pick to render
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, region, region, GL_RGBA_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->position = f_picking.request;
+    slot->frame = f_picking.frame;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+    glViewport(0, 0, width, height);
+}
+
+void UpdatePicking(Matrix view, Matrix proj)
+{
+    assert(f_picking.program != GL_NONE);
+    f_picking.frame++;
+    RetireReadbacks();
+
+    int width = WindowWidth();
+    int height = WindowHeight();
+    if (f_picking.pending && width > 0 && height > 0)
+    {
+        // The GPU is a whole ring behind: keep the request for next frame rather than wait
+        PickSlot& slot = f_picking.slots[f_picking.next];
+        if (slot.fence == nullptr)
+        {
+            RenderPick(&slot, view, proj, width, height);
+            f_picking.next = (f_picking.next + 1) % (int)f_picking.slots.size();
+            f_picking.pending = false;
+        }
+        else
+        {
+            f_picking.stats.deferred++;
+        }
+    }
+
+    f_picking.stats.in_flight = 0;
+    for (const PickSlot& slot : f_picking.slots)
+        f_picking.stats.in_flight += slot.fence != nullptr ? 1 : 0;
+}
+
+bool PollPickResult(PickResult* result)
+{
+    if (!f_picking.has_result)
+        return false;
+    *result = f_picking.result;
+    f_picking.has_result = false;
+    return true;
+}
+
+PickingStats GetPickingStats()
+{
+    PickingStats stats = f_picking.stats;
+    stats.pickables = (int)(f_picking.pickables.size() - f_picking.free_pickables.size());
+    return stats;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include "raymath.h"
+#include "Mesh.h"
+
+// Object picking on the GPU. A pick renders every pickable's handle & triangle into a small integer target that
+// covers only a region of the window around the cursor: the projection is narrowed onto that region (like
+// gluPickMatrix), so pickables outside it are culled by their bounds and the rest rasterize a few pixels each.
+// The ids are read back into a ring of pixel-pack buffers, each followed by a fence, and collected once the fence
+// has signalled: a pick resolves a frame or two after it was asked for and never waits on the GPU.
+// Per pick, the pixel under the cursor wins, or else the nearest covered pixel in the region.
+
+struct PickResult
+{
+	int object = -1;				// Pickable handle; -1 when nothing covers the region
+	int triangle = -1;				// Mesh triangle (index / 3) under the picked pixel
+	Vector2 position = Vector2Zeros;	// Window pixels the pick was asked for
+	uint64_t frame = 0;				// UpdatePicking call that rendered it
+	int latency = 0;				// Frames between rendering & collecting it
+};
+
+struct PickingStats
+{
+	int pickables = 0;
+	int drawn = 0;				// Pickables in the last pick's region
+	int culled = 0;				// Rejected by bounds
+	uint64_t requested = 0;
+	uint64_t resolved = 0;
+	uint64_t deferred = 0;		// Frames a request waited for a free readback
+	int in_flight = 0;
+};
+
+// region is the side of the square rendered around the cursor, in pixels (odd, so the cursor's pixel is its centre);
+// ring_size picks may be in flight at once
+void CreatePicking(int region = 9, int ring_size = 3);
+void DestroyPicking();
+
+// mesh must outlive the pickable; its bounds are taken now, before residency can drop its CPU geometry
+int AddPickable(const Mesh& mesh, Matrix world);
+void SetPickableWorld(int pickable, Matrix world);
+void SetPickableVisible(int pickable, bool visible);	// Hidden pickables aren't drawn
+void RemovePickable(int pickable);					// AddPickable may reuse the handle; picks rendered before that never resolve to it
+
+// Picks at a window position (pixels, top-left origin) during the next UpdatePicking. A newer request replaces one
+// that hasn't been rendered yet.
+void RequestPick(Vector2 position);
+
+// Main thread, once per frame with the frame's camera: collects finished readbacks, then renders & reads back the
+// pending request if a readback is free (otherwise it waits for the next frame). Leaves the default framebuffer bound.
+void UpdatePicking(Matrix view, Matrix proj);
+
+// The newest pick collected since the last call, if any
+bool PollPickResult(PickResult* result);
+
+PickingStats GetPickingStats();
@@ -0,0 +1,310 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "raymath.h"
+
+// Platonic solids & the unit plane, built at compile time into static storage.
+// Points and faces are par_shapes' own tables (cube centred on the origin, as LoadMeshCube always drew it);
+// faces are triangulated and smooth normals are accumulated in the same order as
+// par_shapes_compute_normals, so the result matches the runtime par_shapes path.
+template<size_t V, size_t I>
+struct BakedMesh
+{
+    static constexpr int vertex_count = (int)V;
+    static constexpr int index_count = (int)I;
+
+    Vector3 positions[V];
+    Vector3 normals[V];
+    Vector2 tcoords[V];
+    uint32_t indices[I];
+    bool has_tcoords;
+};
+
+// Newton's method from above; std::sqrt isn't constexpr
+constexpr float BakeSqrt(float x)
+{
+    if (x <= 0.0f)
+        return 0.0f;
+
+    double r = x > 1.0f ? x : 1.0;
+    for (int i = 0; i < 64; i++)
+        r = 0.5 * (r + x / r);
+    return (float)r;
+}
+
+constexpr Vector3 BakeSub(Vector3 a, Vector3 b)
+{
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+constexpr Vector3 BakeCross(Vector3 a, Vector3 b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+template<size_t P, size_t I>
+constexpr BakedMesh<P / 3, I> BakeMesh(const float (&points)[P], const uint32_t (&indices)[I], Vector3 offset)
+{
+    static_assert(P % 3 == 0 && I % 3 == 0, "Points are xyz triples and faces are triangles");
+    BakedMesh<P / 3, I> mesh{};
+
+    // Normals come from the untranslated points, like par_shapes_compute_normals before LoadMeshCube's translate
+    for (size_t i = 0; i < I; i++)
+        mesh.indices[i] = indices[i];
+    for (size_t v = 0; v < P / 3; v++)
+        mesh.positions[v] = { points[v * 3 + 0], points[v * 3 + 1], points[v * 3 + 2] };
+
+    for (size_t t = 0; t < I; t += 3)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            Vector3 a = mesh.positions[indices[t + corner]];
+            Vector3 b = mesh.positions[indices[t + (corner + 1) % 3]];
+            Vector3 c = mesh.positions[indices[t + (corner + 2) % 3]];
+            Vector3 n = BakeCross(BakeSub(b, a), BakeSub(c, a));
+
+            Vector3& sum = mesh.normals[indices[t + corner]];
+            sum = { sum.x + n.x, sum.y + n.y, sum.z + n.z };
+        }
+    }
+
+    for (size_t v = 0; v < P / 3; v++)
+    {
+        Vector3& n = mesh.normals[v];
+        float length = BakeSqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+        if (length > 0.0f)
+        {
+            float scale = 1.0f / length;
+            n = { n.x * scale, n.y * scale, n.z * scale };
+        }
+
+        Vector3& p = mesh.positions[v];
+        p = { p.x + offset.x, p.y + offset.y, p.z + offset.z };
+    }
+    return mesh;
+}
+
+// Convex solids: every smooth normal should point away from the centroid
+template<size_t V, size_t I>
+constexpr bool NormalsFaceOutwards(const BakedMesh<V, I>& mesh)
+{
+    Vector3 centroid{};
+    for (size_t v = 0; v < V; v++)
+        centroid = { centroid.x + mesh.positions[v].x / V, centroid.y + mesh.positions[v].y / V, centroid.z + mesh.positions[v].z / V };
+
+    for (size_t v = 0; v < V; v++)
+    {
+        Vector3 d = BakeSub(mesh.positions[v], centroid);
+        if (d.x * mesh.normals[v].x + d.y * mesh.normals[v].y + d.z * mesh.normals[v].z <= 0.0f)
+            return false;
+    }
+    return true;
+}
+
+// par_shapes triangulates quads as (0 1 2) (2 3 0)
+template<size_t Q>
+struct QuadIndices
+{
+    uint32_t indices[Q / 4 * 6];
+};
+
+template<size_t Q>
+constexpr QuadIndices<Q> TriangulateQuads(const uint32_t (&quads)[Q])
+{
+    QuadIndices<Q> out{};
+    for (size_t q = 0, t = 0; q < Q; q += 4)
+    {
+        out.indices[t++] = quads[q + 0];
+        out.indices[t++] = quads[q + 1];
+        out.indices[t++] = quads[q + 2];
+        out.indices[t++] = quads[q + 2];
+        out.indices[t++] = quads[q + 3];
+        out.indices[t++] = quads[q + 0];
+    }
+    return out;
+}
+
+// ...and pentagons as a fan around corner 0
+template<size_t F>
+struct PentagonIndices
+{
+    uint32_t indices[F / 5 * 9];
+};
+
+template<size_t F>
+constexpr PentagonIndices<F> TriangulatePentagons(const uint32_t (&pentagons)[F])
+{
+    PentagonIndices<F> out{};
+    for (size_t p = 0, t = 0; p < F; p += 5)
+    {
+        for (size_t corner = 1; corner < 4; corner++)
+        {
+            out.indices[t++] = pentagons[p];
+            out.indices[t++] = pentagons[p + corner];
+            out.indices[t++] = pentagons[p + corner + 1];
+        }
+    }
+    return out;
+}
+
+namespace primitives
+{
+    constexpr float tetrahedron_points[] =
+    {
+        0.000f, 1.333f, 0.0f,
+        0.943f, 0.0f, 0.0f,
+        -0.471f, 0.0f, 0.816f,
+        -0.471f, 0.0f, -0.816f,
+    };
+    constexpr uint32_t tetrahedron_triangles[] =
+    {
+        2, 1, 0,
+        3, 2, 0,
+        1, 3, 0,
+        1, 2, 3,
+    };
+
+    constexpr float cube_points[] =
+    {
+        0, 0, 0,
+        0, 1, 0,
+        1, 1, 0,
+        1, 0, 0,
+        0, 0, 1,
+        0, 1, 1,
+        1, 1, 1,
+        1, 0, 1,
+    };
+    constexpr uint32_t cube_quads[] =
+    {
+        7, 6, 5, 4, // front
+        0, 1, 2, 3, // back
+        6, 7, 3, 2, // right
+        5, 6, 2, 1, // top
+        4, 5, 1, 0, // left
+        7, 4, 0, 3, // bottom
+    };
+    constexpr QuadIndices<24> cube_triangles = TriangulateQuads(cube_quads);
+
+    constexpr float octahedron_points[] =
+    {
+        0.000f, 0.000f, 1.000f,
+        1.000f, 0.000f, 0.000f,
+        0.000f, 1.000f, 0.000f,
+        -1.000f, 0.000f, 0.000f,
+        0.000f, -1.000f, 0.000f,
+        0.000f, 0.000f, -1.000f
+    };
+    constexpr uint32_t octahedron_triangles[] =
+    {
+        0, 1, 2,
+        0, 2, 3,
+        0, 3, 4,
+        0, 4, 1,
+        2, 1, 5,
+        3, 2, 5,
+        4, 3, 5,
+        1, 4, 5,
+    };
+
+    constexpr float dodecahedron_points[] =
+    {
+        0.607f, 0.000f, 0.795f,
+        0.188f, 0.577f, 0.795f,
+        -0.491f, 0.357f, 0.795f,
+        -0.491f, -0.357f, 0.795f,
+        0.188f, -0.577f, 0.795f,
+        0.982f, 0.000f, 0.188f,
+        0.304f, 0.934f, 0.188f,
+        -0.795f, 0.577f, 0.188f,
+        -0.795f, -0.577f, 0.188f,
+        0.304f, -0.934f, 0.188f,
+        0.795f, 0.577f, -0.188f,
+        -0.304f, 0.934f, -0.188f,
+        -0.982f, 0.000f, -0.188f,
+        -0.304f, -0.934f, -0.188f,
+        0.795f, -0.577f, -0.188f,
+        0.491f, 0.357f, -0.795f,
+        -0.188f, 0.577f, -0.795f,
+        -0.607f, 0.000f, -0.795f,
+        -0.188f, -0.577f, -0.795f,
+        0.491f, -0.357f, -0.795f,
+    };
+    constexpr uint32_t dodecahedron_pentagons[] =
+    {
+        0, 1, 2, 3, 4,
+        5, 10, 6, 1, 0,
+        6, 11, 7, 2, 1,
+        7, 12, 8, 3, 2,
+        8, 13, 9, 4, 3,
+        9, 14, 5, 0, 4,
+        15, 16, 11, 6, 10,
+        16, 17, 12, 7, 11,
+        17, 18, 13, 8, 12,
+        18, 19, 14, 9, 13,
+        19, 15, 10, 5, 14,
+        19, 18, 17, 16, 15
+    };
+    constexpr PentagonIndices<60> dodecahedron_triangles = TriangulatePentagons(dodecahedron_pentagons);
+
+    constexpr float icosahedron_points[] =
+    {
+        0.000f, 0.000f, 1.000f,
+        0.894f, 0.000f, 0.447f,
+        0.276f, 0.851f, 0.447f,
+        -0.724f, 0.526f, 0.447f,
+        -0.724f, -0.526f, 0.447f,
+        0.276f, -0.851f, 0.447f,
+        0.724f, 0.526f, -0.447f,
+        -0.276f, 0.851f, -0.447f,
+        -0.894f, 0.000f, -0.447f,
+        -0.276f, -0.851f, -0.447f,
+        0.724f, -0.526f, -0.447f,
+        0.000f, 0.000f, -1.000f
+    };
+    constexpr uint32_t icosahedron_triangles[] =
+    {
+        0, 1, 2,
+        0, 2, 3,
+        0, 3, 4,
+        0, 4, 5,
+        0, 5, 1,
+        7, 6, 11,
+        8, 7, 11,
+        9, 8, 11,
+        10, 9, 11,
+        6, 10, 11,
+        6, 2, 1,
+        7, 3, 2,
+        8, 4, 3,
+        9, 5, 4,
+        10, 1, 5,
+        6, 7, 2,
+        7, 8, 3,
+        8, 9, 4,
+        9, 10, 5,
+        10, 6, 1
+    };
+
+    constexpr BakedMesh<4, 12> tetrahedron = BakeMesh(tetrahedron_points, tetrahedron_triangles, { 0.0f, 0.0f, 0.0f });
+    constexpr BakedMesh<8, 36> cube = BakeMesh(cube_points, cube_triangles.indices, { -0.5f, -0.5f, -0.5f });
+    constexpr BakedMesh<6, 24> octahedron = BakeMesh(octahedron_points, octahedron_triangles, { 0.0f, 0.0f, 0.0f });
+    constexpr BakedMesh<20, 108> dodecahedron = BakeMesh(dodecahedron_points, dodecahedron_triangles.indices, { 0.0f, 0.0f, 0.0f });
+    constexpr BakedMesh<12, 60> icosahedron = BakeMesh(icosahedron_points, icosahedron_triangles, { 0.0f, 0.0f, 0.0f });
+
+    // LoadMeshPlaneOptimal's quad: centred unit square facing +Z
+    constexpr BakedMesh<4, 6> plane =
+    {
+        { { -0.5f, -0.5f, 0.0f }, { 0.5f, -0.5f, 0.0f }, { 0.5f, 0.5f, 0.0f }, { -0.5f, 0.5f, 0.0f } },
+        { { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f } },
+        { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } },
+        { 0, 1, 2, 0, 2, 3 },
+        true
+    };
+
+    static_assert(NormalsFaceOutwards(tetrahedron), "Tetrahedron winding is inverted");
+    static_assert(NormalsFaceOutwards(cube), "Cube winding is inverted");
+    static_assert(NormalsFaceOutwards(octahedron), "Octahedron winding is inverted");
+    static_assert(NormalsFaceOutwards(dodecahedron), "Dodecahedron winding is inverted");
+    static_assert(NormalsFaceOutwards(icosahedron), "Icosahedron winding is inverted");
+}
@@ -0,0 +1,246 @@
+#include "Regression.h"
+#include "Image.h"
+#include "Window.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+struct RegressionTiming
+{
+    double cpu_ms = 0.0;
+    double gpu_ms = 0.0;
+};
+
+// One "name cpu_ms gpu_ms" line per case
+static std::map<std::string, RegressionTiming> LoadBaseline(const std::string& path)
+{
+    std::map<std::string, RegressionTiming> baseline;
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == nullptr)
+        return baseline;
+
+    char name[256];
+    RegressionTiming timing;
+    while (fscanf(file, "%255s %lf %lf", name, &timing.cpu_ms, &timing.gpu_ms) == 3)
+        baseline[name] = timing;
+    fclose(file);
+    return baseline;
+}
+
+static void SaveBaseline(const std::string& path, const std::map<std::string, RegressionTiming>& baseline)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        printf("Warning: failed to write regression baseline %s\n", path.c_str());
+        return;
+    }
+    for (const auto& entry : baseline)
+        fprintf(file, "%s %.4f %.4f\n", entry.first.c_str(), entry.second.cpu_ms, entry.second.gpu_ms);
+    fclose(file);
+}
+
+// 0-1, in YCoCg with chroma at half weight: the eye notices luma changes most
+static float PixelDistance(Color a, Color b)
+{
+    float dr = (a.r - b.r) / 255.0f;
+    float dg = (a.g - b.g) / 255.0f;
+    float db = (a.b - b.b) / 255.0f;
+    float y = 0.25f * dr + 0.5f * dg + 0.25f * db;
+    float co = 0.5f * (dr - db);
+    float cg = 0.5f * dg - 0.25f * (dr + db);
+    return sqrtf(y * y + 0.5f * (co * co + cg * cg));
+}
+
+// Fraction of pixels with no golden pixel within 1px that's within tolerance,
+// so edges a rasterizer places one pixel differently don't count
+static float ImageDifference(const Image& image, const Image& golden, float tolerance)
+{
+    if (image.width != golden.width || image.height != golden.height)
+        return 1.0f;
+
+    int differing = 0;
+    for (int y = 0; y < image.height; y++)
+    {
+        for (int x = 0; x < image.width; x++)
+        {
+            Color pixel = image.pixels[y * image.width + x];
+            bool match = false;
+            for (int gy = std::max(y - 1, 0); gy <= std::min(y + 1, image.height - 1) && !match; gy++)
+            {
+                for (int gx = std::max(x - 1, 0); gx <= std::min(x + 1, image.width - 1) && !match; gx++)
+                    match = PixelDistance(pixel, golden.pixels[gy * golden.width + gx]) <= tolerance;
+            }
+            differing += !match;
+        }
+    }
+    return differing / (float)(image.width * image.height);
+}
+
+static void DrawCase(const RegressionCase& test, const RegressionOptions& options)
+{
+    Matrix world_view = options.world * options.view;
+    BeginShader(test.program);
+    if (test.texture != nullptr)
+        BeginTexture(*test.texture);
+
+    SendMat4(world_view * options.proj, "u_mvp");
+    if (test.key.Has(SHADER_FEATURE_LIGHTING) || test.key.Has(SHADER_FEATURE_SHADOWS))
+    {
+        SendMat4(world_view, "u_mv");
+        SendMat3(MatrixTranspose(MatrixInvert(world_view)), "u_normal");
+    }
+    DrawMesh(*test.mesh);
+
+    if (test.texture != nullptr)
+        EndTexture();
+    EndShader();
+}
+
+static double Median(std::vector<double>* values)
+{
+    std::sort(values->begin(), values->end());
+    return (*values)[values->size() / 2];
+}
+
+int RunRegressionSuite(const RegressionCase* cases, int count, const RegressionOptions& options, int* missing)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    assert(options.iterations > 0);
+
+    std::error_code error;
+    std::filesystem::create_directories(options.directory, error);
+    std::string baseline_path = std::string(options.directory) + "/baseline.txt";
+    std::map<std::string, RegressionTiming> baseline = LoadBaseline(baseline_path);
+    bool baseline_changed = false;
+
+    // Offscreen target, so the run is the same whatever the window looks like
+    Texture color;
+    CreateTextureStorage(&color, options.width, options.height, 1, GL_RGBA8);
+    GLuint depth, fbo;
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, options.width, options.height);
+    glBindRenderbuffer(GL_RENDERBUFFER, GL_NONE);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color.id, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glViewport(0, 0, options.width, options.height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    std::vector<GLuint> queries(options.iterations);
+    glGenQueries(options.iterations, queries.data());
+    std::vector<double> cpu(options.iterations), gpu(options.iterations);
+
+    Image image;
+    LoadImage(&image, options.width, options.height);
+    int failed = 0, recorded = 0;
+    *missing = 0;
+
+    printf("Regression suite (%i cases, %ix%i, %i iterations):\n", count, options.width, options.height, options.iterations);
+    printf("  %-28s %8s  %17s  %17s\n", "case", "diff", "cpu ms (base)", "gpu ms (base)");
+    for (int i = 0; i < count; i++)
+    {
+        const RegressionCase& test = cases[i];
+        std::string result;
+
+        // Image
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        DrawCase(test, options);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, options.width, options.height, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+
+        std::string golden_path = std::string(options.directory) + "/" + test.name + ".png";
+        Image golden;
+        float difference = 0.0f;
+        bool has_golden = true;
+        if (options.update)
+        {
+            SaveImage(golden_path.c_str(), image);
+            recorded++;
+        }
+        else if (LoadImagePng(&golden, golden_path.c_str()))
+        {
+            difference = ImageDifference(image, golden, options.pixel_tolerance);
+            UnloadImage(&golden);
+            if (difference > options.image_tolerance)
+            {
+                // Written next to the golden for inspection
+                result += " image";
+                SaveImage((std::string(options.directory) + "/" + test.name + ".failed.png").c_str(), image);
+            }
+        }
+        else
+        {
+            has_golden = false;
+            (*missing)++;
+        }
+
+        // Timing: depth is cleared between draws so every one does the full work
+        for (int j = 0; j < options.iterations; j++)
+        {
+            glClear(GL_DEPTH_BUFFER_BIT);
+            glBeginQuery(GL_TIME_ELAPSED, queries[j]);
+            auto begin = Clock::now();
+            DrawCase(test, options);
+            cpu[j] = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+            glEndQuery(GL_TIME_ELAPSED);
+        }
+        for (int j = 0; j < options.iterations; j++)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[j], GL_QUERY_RESULT, &elapsed);
+            gpu[j] = elapsed * 1e-6;
+        }
+        RegressionTiming timing = { Median(&cpu), Median(&gpu) };
+
+        auto entry = baseline.find(test.name);
+        RegressionTiming base = timing;
+        if (options.update || entry == baseline.end())
+        {
+            baseline[test.name] = timing;
+            baseline_changed = true;
+        }
+        else
+        {
+            base = entry->second;
+            auto regressed = [&](double now, double before)
+            {
+                return now > before * (1.0 + options.time_threshold) && now - before > options.time_floor_ms;
+            };
+            if (regressed(timing.cpu_ms, base.cpu_ms))
+                result += " cpu";
+            if (regressed(timing.gpu_ms, base.gpu_ms))
+                result += " gpu";
+        }
+
+        failed += !result.empty();
+        const char* status = !result.empty() ? "FAIL:" : has_golden ? "ok" : "no golden";
+        printf("  %-28s %7.3f%%  %7.3f (%7.3f)  %7.3f (%7.3f)  %s%s\n", test.name, difference * 100.0f,
+            timing.cpu_ms, base.cpu_ms, timing.gpu_ms, base.gpu_ms, status, result.c_str());
+    }
+
+    if (baseline_changed)
+        SaveBaseline(baseline_path, baseline);
+    printf("  %i passed, %i failed, %i without a golden (%i goldens recorded)\n", count - failed - *missing, failed,
+        *missing, recorded);
+    if (*missing > 0)
+        printf("  No golden to compare against in %s: run with --update-golden to record them\n", options.directory);
+
+    UnloadImage(&image);
+    glDeleteQueries(options.iterations, queries.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &depth);
+    UnloadTexture(&color);
+    glViewport(0, 0, WindowWidth(), WindowHeight());
+    return failed;
+}
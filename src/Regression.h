@@ -0,0 +1,51 @@
+#pragma once
+#include <glad/glad.h>
+#include "raymath.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "Texture.h"
+
+// Golden-image & performance regression checks. Every case is drawn into an offscreen target (so the window's
+// size & contents don't matter), read back and compared with its golden PNG, then drawn repeatedly to time
+// CPU submission & GPU execution (timer queries). Timings are compared with a stored baseline.
+// A case without a golden is reported as missing rather than passed or failed (run with update to record them);
+// missing baseline entries are recorded from the current run.
+
+struct RegressionCase
+{
+	const char* name = nullptr;		// Golden file name & baseline key (no spaces)
+	GLuint program = GL_NONE;
+	ShaderKey key;					// Lit & shadowed variants also get u_mv & u_normal
+	const Mesh* mesh = nullptr;
+	const Texture* texture = nullptr;
+};
+
+struct RegressionOptions
+{
+	const char* directory = "./assets/golden";	// <name>.png per case, plus baseline.txt
+	int width = 256;
+	int height = 256;
+	int iterations = 32;			// Timed draws per case; the median counts
+
+	// A pixel differs when no golden pixel within 1px of it is within pixel_tolerance (0-1, luma-weighted);
+	// a case fails when more than image_tolerance of its pixels differ
+	float pixel_tolerance = 0.03f;
+	float image_tolerance = 0.002f;
+
+	// A time regresses when it exceeds the baseline by this fraction and by at least time_floor_ms
+	float time_threshold = 0.25f;
+	float time_floor_ms = 0.02f;
+
+	bool update = false;			// Overwrite goldens & baseline with this run instead of comparing
+
+	// Every case is drawn with world * view * proj
+	Matrix world = MatrixRotateX(20.0f * DEG2RAD) * MatrixRotateY(30.0f * DEG2RAD);
+	Matrix view = MatrixLookAt({ 0.0f, 0.0f, 3.0f }, Vector3Zeros, Vector3UnitY);
+	Matrix proj = MatrixPerspective(60.0f * DEG2RAD, 1.0, 0.1, 100.0);
+};
+
+// Exit code for a run that failed nothing but had goldens missing (CTest's & autotools' "skipped")
+constexpr int REGRESSION_MISSING_GOLDENS = 77;
+
+// Prints a row per case and a summary; returns the number of failed cases and counts the cases without a golden
+int RunRegressionSuite(const RegressionCase* cases, int count, const RegressionOptions& options, int* missing);
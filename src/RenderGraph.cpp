@@ -0,0 +1,510 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+
+// Pooled textures unused for this many compiles are released
+constexpr uint64_t RENDER_POOL_EVICT_FRAMES = 120;
+
+constexpr int RENDER_PASS_MAX_COLORS = 4;
+
+struct PooledTarget
+{
+    RenderTargetDesc desc;
+    Texture texture;            // id == GL_NONE marks a free slot (indices stay stable)
+    size_t bytes = 0;
+    uint64_t last_used = 0;
+};
+
+// Attachment set -> FBO; colors[i] == GL_NONE past the pass's last color target
+struct PooledFramebuffer
+{
+    GLuint fbo = GL_NONE;
+    GLuint colors[RENDER_PASS_MAX_COLORS]{};
+    GLuint depth = GL_NONE;
+};
+
+static std::vector<PooledTarget> f_targets;
+static std::vector<PooledFramebuffer> f_framebuffers;
+static uint64_t f_frame = 0;
+
+// Compile scratch, kept between frames
+static std::vector<int> f_indegree;
+static std::vector<int> f_stack;
+static std::vector<uint8_t> f_busy;
+
+static bool IsDepthFormat(GLenum format)
+{
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F ||
+        format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static size_t FormatBytes(GLenum format)
+{
+    switch (format)
+    {
+    case GL_R8:
+        return 1;
+
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+
+    case GL_RGBA8:
+    case GL_RGB10_A2:
+    case GL_R11F_G11F_B10F:
+    case GL_RG16F:
+    case GL_R32F:
+    case GL_R32UI:
+    case GL_DEPTH_COMPONENT24:  // Stored padded to 32 bits
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+        return 4;
+
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+        return 8;
+
+    case GL_RGBA32F:
+        return 16;
+
+    default:
+        printf("Render graph: unknown size for format 0x%X, assuming 4 bytes per texel\n", format);
+        return 4;
+    }
+}
+
+static size_t TargetBytes(const RenderTargetDesc& desc)
+{
+    return (size_t)desc.width * desc.height * FormatBytes(desc.format);
+}
+
+static bool SameDesc(const RenderTargetDesc& a, const RenderTargetDesc& b)
+{
+    return a.width == b.width && a.height == b.height && a.format == b.format;
+}
+
+void ResetRenderGraph(RenderGraph* graph)
+{
+    graph->passes.clear();
+    graph->resources.clear();
+    graph->accesses.clear();
+    graph->order.clear();
+    graph->stats = RenderGraphStats();
+    graph->compiled = false;
+}
+
+int AddRenderPass(RenderGraph* graph, const char* name, RenderPassFunction function, void* data)
+{
+    assert(!graph->compiled && function != nullptr);
+    RenderPass pass;
+    pass.name = name;
+    pass.function = function;
+    pass.data = data;
+    graph->passes.push_back(pass);
+    return (int)graph->passes.size() - 1;
+}
+
+int CreateRenderTarget(RenderGraph* graph, const char* name, RenderTargetDesc desc)
+{
+    assert(!graph->compiled && desc.width > 0 && desc.height > 0);
+    RenderResource resource;
+    resource.name = name;
+    resource.desc = desc;
+    graph->resources.push_back(resource);
+    return (int)graph->resources.size() - 1;
+}
+
+int ImportBackbuffer(RenderGraph* graph, int width, int height)
+{
+    assert(!graph->compiled);
+    RenderResource resource;
+    resource.name = "backbuffer";
+    resource.desc.width = width;
+    resource.desc.height = height;
+    resource.imported = true;
+    graph->resources.push_back(resource);
+    return (int)graph->resources.size() - 1;
+}
+
+static void AddAccess(RenderGraph* graph, int pass, int target, bool write)
+{
+    assert(!graph->compiled);
+    assert(pass >= 0 && pass < (int)graph->passes.size());
+    assert(target >= 0 && target < (int)graph->resources.size());
+    RenderAccess access;
+    access.pass = pass;
+    access.resource = target;
+    access.write = write;
+    graph->accesses.push_back(access);
+}
+
+void ReadRenderTarget(RenderGraph* graph, int pass, int target)
+{
+    AddAccess(graph, pass, target, false);
+}
+
+void WriteRenderTarget(RenderGraph* graph, int pass, int target)
+{
+    AddAccess(graph, pass, target, true);
+}
+
+void SetRenderPassRoot(RenderGraph* graph, int pass)
+{
+    graph->passes[pass].root = true;
+}
+
+static int AcquireTarget(const RenderTargetDesc& desc)
+{
+    int free_slot = -1;
+    for (int i = 0; i < (int)f_targets.size(); i++)
+    {
+        PooledTarget& target = f_targets[i];
+        if (target.texture.id == GL_NONE)
+        {
+            if (free_slot < 0)
+                free_slot = i;
+            continue;
+        }
+        if (!f_busy[i] && SameDesc(target.desc, desc))
+        {
+            f_busy[i] = 1;
+            target.last_used = f_frame;
+            return i;
+        }
+    }
+
+    if (free_slot < 0)
+    {
+        free_slot = (int)f_targets.size();
+        f_targets.emplace_back();
+        f_busy.push_back(0);
+    }
+
+    PooledTarget& target = f_targets[free_slot];
+    target.desc = desc;
+    target.bytes = TargetBytes(desc);
+    target.last_used = f_frame;
+    target.texture = Texture();
+    CreateTextureStorage(&target.texture, desc.width, desc.height, 1, desc.format);
+
+    // Render targets are sampled 1:1 or filtered once, never mipmapped or tiled
+    glBindTexture(GL_TEXTURE_2D, target.texture.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+    f_busy[free_slot] = 1;
+    return free_slot;
+}
+
+static void EvictTargets()
+{
+    for (PooledTarget& target : f_targets)
+    {
+        if (target.texture.id == GL_NONE || target.last_used + RENDER_POOL_EVICT_FRAMES >= f_frame)
+            continue;
+
+        // FBOs referencing the texture go with it
+        GLuint id = target.texture.id;
+        for (size_t i = 0; i < f_framebuffers.size();)
+        {
+            PooledFramebuffer& framebuffer = f_framebuffers[i];
+            bool uses = framebuffer.depth == id || std::find(framebuffer.colors, framebuffer.colors + RENDER_PASS_MAX_COLORS, id) != framebuffer.colors + RENDER_PASS_MAX_COLORS;
+            if (uses)
+            {
+                glDeleteFramebuffers(1, &framebuffer.fbo);
+                framebuffer = f_framebuffers.back();
+                f_framebuffers.pop_back();
+            }
+            else
+                i++;
+        }
+        UnloadTexture(&target.texture);
+    }
+}
+
+void CompileRenderGraph(RenderGraph* graph)
+{
+    assert(!graph->compiled);
+    f_frame++;
+    int pass_count = (int)graph->passes.size();
+    RenderGraphStats& stats = graph->stats;
+    stats = RenderGraphStats();
+    stats.passes = pass_count;
+
+    // Writing the backbuffer is a side effect, like an explicit root
+    for (const RenderAccess& access : graph->accesses)
+    {
+        if (access.write && graph->resources[access.resource].imported)
+            graph->passes[access.pass].root = true;
+    }
+
+    // Cull: walk back from the roots through the writers of everything an alive pass reads
+    f_stack.clear();
+    for (int p = 0; p < pass_count; p++)
+    {
+        graph->passes[p].alive = graph->passes[p].root;
+        if (graph->passes[p].root)
+            f_stack.push_back(p);
+    }
+    while (!f_stack.empty())
+    {
+        int p = f_stack.back();
+        f_stack.pop_back();
+        for (const RenderAccess& read : graph->accesses)
+        {
+            if (read.pass != p || read.write)
+                continue;
+            for (const RenderAccess& write : graph->accesses)
+            {
+                if (write.write && write.resource == read.resource && !graph->passes[write.pass].alive)
+                {
+                    graph->passes[write.pass].alive = true;
+                    f_stack.push_back(write.pass);
+                }
+            }
+        }
+    }
+
+    // Order: Kahn's algorithm over writer -> reader edges, lowest declaration index first among ready passes
+    f_indegree.assign(pass_count, 0);
+    for (const RenderAccess& read : graph->accesses)
+    {
+        if (read.write || !graph->passes[read.pass].alive)
+            continue;
+        for (const RenderAccess& write : graph->accesses)
+        {
+            if (write.write && write.resource == read.resource && write.pass != read.pass && graph->passes[write.pass].alive)
+                f_indegree[read.pass]++;
+        }
+    }
+
+    graph->order.clear();
+    int alive = 0;
+    for (int p = 0; p < pass_count; p++)
+        alive += graph->passes[p].alive;
+    stats.culled = pass_count - alive;
+
+    while ((int)graph->order.size() < alive)
+    {
+        int next = -1;
+        for (int p = 0; p < pass_count && next < 0; p++)
+        {
+            if (graph->passes[p].alive && f_indegree[p] == 0)
+                next = p;
+        }
+        if (next < 0)
+        {
+            printf("Render graph: dependency cycle, %i passes not scheduled\n", alive - (int)graph->order.size());
+            assert(false);
+            break;
+        }
+
+        f_indegree[next] = -1;
+        graph->order.push_back(next);
+        for (const RenderAccess& write : graph->accesses)
+        {
+            if (write.pass != next || !write.write)
+                continue;
+            for (const RenderAccess& read : graph->accesses)
+            {
+                if (!read.write && read.resource == write.resource && read.pass != next && graph->passes[read.pass].alive)
+                    f_indegree[read.pass]--;
+            }
+        }
+    }
+
+    // Lifetimes in execution order
+    for (int i = 0; i < (int)graph->order.size(); i++)
+    {
+        for (const RenderAccess& access : graph->accesses)
+        {
+            if (access.pass != graph->order[i])
+                continue;
+            RenderResource& resource = graph->resources[access.resource];
+            if (resource.first < 0)
+                resource.first = i;
+            resource.last = i;
+        }
+    }
+
+    // Allocate at first use, release after last use, so later targets can take over the texture
+    f_busy.assign(f_targets.size(), 0);
+    size_t live = 0;
+    for (int i = 0; i < (int)graph->order.size(); i++)
+    {
+        for (RenderResource& resource : graph->resources)
+        {
+            if (resource.imported || resource.first != i)
+                continue;
+            resource.physical = AcquireTarget(resource.desc);
+            live += f_targets[resource.physical].bytes;
+            stats.unaliased_bytes += f_targets[resource.physical].bytes;
+            stats.transient_targets++;
+        }
+        stats.peak_bytes = std::max(stats.peak_bytes, live);
+
+        for (RenderResource& resource : graph->resources)
+        {
+            if (resource.imported || resource.last != i)
+                continue;
+            f_busy[resource.physical] = 0;
+            live -= f_targets[resource.physical].bytes;
+        }
+    }
+
+    for (size_t t = 0; t < f_targets.size(); t++)
+    {
+        if (f_targets[t].texture.id != GL_NONE && f_targets[t].last_used == f_frame)
+            stats.physical_targets++;
+    }
+
+    EvictTargets();
+    for (const PooledTarget& target : f_targets)
+    {
+        if (target.texture.id != GL_NONE)
+            stats.pool_bytes += target.bytes;
+    }
+    graph->compiled = true;
+}
+
+static GLuint Framebuffer(const GLuint colors[RENDER_PASS_MAX_COLORS], GLuint depth, GLenum depth_format)
+{
+    for (const PooledFramebuffer& framebuffer : f_framebuffers)
+    {
+        if (framebuffer.depth == depth && std::equal(colors, colors + RENDER_PASS_MAX_COLORS, framebuffer.colors))
+            return framebuffer.fbo;
+    }
+
+    PooledFramebuffer framebuffer;
+    std::copy(colors, colors + RENDER_PASS_MAX_COLORS, framebuffer.colors);
+    framebuffer.depth = depth;
+    glGenFramebuffers(1, &framebuffer.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
+
+    GLenum buffers[RENDER_PASS_MAX_COLORS];
+    int color_count = 0;
+    for (; color_count < RENDER_PASS_MAX_COLORS && colors[color_count] != GL_NONE; color_count++)
+    {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + color_count, GL_TEXTURE_2D, colors[color_count], 0);
+        buffers[color_count] = GL_COLOR_ATTACHMENT0 + color_count;
+    }
+    if (color_count > 0)
+        glDrawBuffers(color_count, buffers);
+    else
+        glDrawBuffer(GL_NONE);
+
+    if (depth != GL_NONE)
+    {
+        GLenum attachment = depth_format == GL_DEPTH24_STENCIL8 || depth_format == GL_DEPTH32F_STENCIL8 ?
+            GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, depth, 0);
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        printf("Render graph: incomplete framebuffer (%i colors, depth %u)\n", color_count, depth);
+
+    f_framebuffers.push_back(framebuffer);
+    return framebuffer.fbo;
+}
+
+void ExecuteRenderGraph(RenderGraph* graph)
+{
+    assert(graph->compiled);
+    for (int p : graph->order)
+    {
+        GLuint colors[RENDER_PASS_MAX_COLORS]{};
+        GLuint depth = GL_NONE;
+        GLenum depth_format = GL_NONE;
+        int color_count = 0;
+        bool backbuffer = false;
+        const RenderTargetDesc* viewport = nullptr;
+
+        for (const RenderAccess& access : graph->accesses)
+        {
+            if (access.pass != p || !access.write)
+                continue;
+
+            const RenderResource& resource = graph->resources[access.resource];
+            viewport = &resource.desc;
+            if (resource.imported)
+            {
+                backbuffer = true;
+                continue;
+            }
+
+            const PooledTarget& target = f_targets[resource.physical];
+            if (IsDepthFormat(resource.desc.format))
+            {
+                depth = target.texture.id;
+                depth_format = resource.desc.format;
+            }
+            else
+            {
+                assert(color_count < RENDER_PASS_MAX_COLORS);
+                colors[color_count++] = target.texture.id;
+            }
+        }
+
+        if (viewport != nullptr)
+        {
+            assert((!backbuffer || (color_count == 0 && depth == GL_NONE)) && "The backbuffer can't share a pass with other targets");
+            glBindFramebuffer(GL_FRAMEBUFFER, backbuffer ? GL_NONE : Framebuffer(colors, depth, depth_format));
+            glViewport(0, 0, viewport->width, viewport->height);
+        }
+
+        const RenderPass& pass = graph->passes[p];
+        pass.function(*graph, p, pass.data);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+}
+
+const Texture& RenderGraphTexture(const RenderGraph& graph, int target)
+{
+    const RenderResource& resource = graph.resources[target];
+    assert(graph.compiled && !resource.imported && resource.physical >= 0);
+    return f_targets[resource.physical].texture;
+}
+
+void PrintRenderGraph(const RenderGraph& graph)
+{
+    const RenderGraphStats& stats = graph.stats;
+    printf("Render graph: %i passes (%i culled), %i targets in %i textures\n",
+        stats.passes, stats.culled, stats.transient_targets, stats.physical_targets);
+    for (int i = 0; i < (int)graph.order.size(); i++)
+        printf("  %i: %s\n", i, graph.passes[graph.order[i]].name);
+    for (const RenderPass& pass : graph.passes)
+    {
+        if (!pass.alive)
+            printf("  culled: %s\n", pass.name);
+    }
+    for (const RenderResource& resource : graph.resources)
+    {
+        if (resource.imported || resource.physical < 0)
+            continue;
+        printf("  %-16s %4ix%-4i -> texture %i, passes %i-%i\n", resource.name,
+            resource.desc.width, resource.desc.height, resource.physical, resource.first, resource.last);
+    }
+    printf("  peak %.2f MB, unaliased %.2f MB, pool %.2f MB\n",
+        stats.peak_bytes / 1048576.0, stats.unaliased_bytes / 1048576.0, stats.pool_bytes / 1048576.0);
+}
+
+void DestroyRenderTargetPool()
+{
+    for (PooledFramebuffer& framebuffer : f_framebuffers)
+        glDeleteFramebuffers(1, &framebuffer.fbo);
+    f_framebuffers.clear();
+
+    for (PooledTarget& target : f_targets)
+    {
+        if (target.texture.id != GL_NONE)
+            UnloadTexture(&target.texture);
+    }
+    f_targets.clear();
+    f_busy.clear();
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include "Texture.h"
+
+// Frame render graph. Each frame, passes are declared with the targets they read & write, then
+// CompileRenderGraph culls passes whose output nobody uses, orders the rest by their dependencies and
+// assigns every transient target a pooled texture. Targets whose lifetimes don't overlap share one texture
+// (GL can't alias raw memory, so matching size & format is what makes two targets interchangeable).
+// Pooled textures & their FBOs persist across frames; ones unused for a while are released.
+
+struct RenderGraph;
+typedef void (*RenderPassFunction)(const RenderGraph& graph, int pass, void* data);
+
+struct RenderTargetDesc
+{
+	int width = 0;
+	int height = 0;
+	GLenum format = GL_RGBA8;	// Depth formats attach as depth (GL_DEPTH24_STENCIL8 as depth-stencil)
+};
+
+struct RenderPass
+{
+	const char* name = nullptr;
+	RenderPassFunction function = nullptr;
+	void* data = nullptr;
+	bool root = false;			// Has side effects (readback, present); never culled
+	bool alive = false;
+};
+
+struct RenderResource
+{
+	const char* name = nullptr;
+	RenderTargetDesc desc;
+	bool imported = false;		// The backbuffer; writing it makes a pass a root
+	int physical = -1;			// Pool slot once compiled
+	int first = -1;				// Execution indices of the first & last alive pass touching it
+	int last = -1;
+};
+
+struct RenderAccess
+{
+	int pass = -1;
+	int resource = -1;
+	bool write = false;
+};
+
+struct RenderGraphStats
+{
+	int passes = 0;
+	int culled = 0;
+	int transient_targets = 0;	// Virtual targets used by alive passes
+	int physical_targets = 0;	// Textures they were packed into
+	size_t peak_bytes = 0;		// Most transient memory live at once during the frame
+	size_t unaliased_bytes = 0;	// What every target with its own texture would have cost
+	size_t pool_bytes = 0;		// Everything the pool holds, including textures kept for later frames
+};
+
+struct RenderGraph
+{
+	std::vector<RenderPass> passes;
+	std::vector<RenderResource> resources;
+	std::vector<RenderAccess> accesses;	// In declaration order; flat so a reset graph reallocates nothing
+	std::vector<int> order;		// Alive passes in execution order
+	RenderGraphStats stats;
+	bool compiled = false;
+};
+
+// Start of frame; keeps vector capacity
+void ResetRenderGraph(RenderGraph* graph);
+
+int AddRenderPass(RenderGraph* graph, const char* name, RenderPassFunction function, void* data);
+
+// Contents are undefined when the writing pass starts (clear them)
+int CreateRenderTarget(RenderGraph* graph, const char* name, RenderTargetDesc desc);
+int ImportBackbuffer(RenderGraph* graph, int width, int height);
+
+void ReadRenderTarget(RenderGraph* graph, int pass, int target);
+void WriteRenderTarget(RenderGraph* graph, int pass, int target);
+void SetRenderPassRoot(RenderGraph* graph, int pass);
+
+void CompileRenderGraph(RenderGraph* graph);
+
+// Runs the alive passes in order. Passes that write targets get them bound as an FBO, with the viewport set to their size.
+void ExecuteRenderGraph(RenderGraph* graph);
+
+// For passes sampling a target they read (valid once compiled)
+const Texture& RenderGraphTexture(const RenderGraph& graph, int target);
+
+// Prints the compiled order, culled passes, target-to-texture assignment & memory figures
+void PrintRenderGraph(const RenderGraph& graph);
+
+void DestroyRenderTargetPool();
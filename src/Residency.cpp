@@ -0,0 +1,548 @@
+#include "Residency.h"
+#include "Memory.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ResidentEntry
+{
+    Mesh* mesh = nullptr;           // Owner of the buffers (see MeshOwner)
+    Texture* texture = nullptr;
+    GLuint handle = GL_NONE;        // VAO, or the texture's current id
+    MeshStreams baked;              // Static geometry to restore from (vertex_count == 0 otherwise)
+    uint64_t file_key = 0;          // Mesh file in the cache (0 if none was written)
+    size_t gpu_bytes = 0;
+    size_t cpu_bytes = 0;
+    uint64_t last_used = 0;         // Frame
+    bool resident = true;
+    bool evictable = false;
+    bool alive = false;
+};
+
+// Evicting & re-streaming re-key textures mid-frame, so map nodes come from a pool rather than the heap
+using ResidentMap = std::unordered_map<GLuint, int, std::hash<GLuint>, std::equal_to<GLuint>, PoolAllocator<std::pair<const GLuint, int>>>;
+
+// Before f_residency (initialization follows declaration order here), since its maps may allocate on construction
+static Pool f_residency_nodes = []
+{
+    Pool pool;
+    CreatePool(&pool, 32, 256);
+    return pool;
+}();
+
+struct Residency
+{
+    std::vector<ResidentEntry> entries;
+    std::vector<int> free_entries;
+    // By VAO, and by texture id (placeholders included)
+    ResidentMap meshes{ 0, std::hash<GLuint>(), std::equal_to<GLuint>(), ResidentMap::allocator_type(&f_residency_nodes) };
+    ResidentMap textures{ 0, std::hash<GLuint>(), std::equal_to<GLuint>(), ResidentMap::allocator_type(&f_residency_nodes) };
+    std::vector<GLuint> retired;    // Placeholders replaced this frame; draws recorded earlier still name them
+    std::vector<int> candidates;
+
+    // Mesh file contents while restoring, kept so restores don't allocate once warm
+    std::vector<Vector3> positions;
+    std::vector<Vector2> tcoords;
+    std::vector<Vector3> normals;
+    std::vector<uint32_t> indices;
+
+    size_t budget = 0;
+    bool drop_cpu_copies = false;
+    uint64_t frame = 1;
+    double restream_ms = 0.0;       // This frame
+    ResidencyStats stats;
+};
+
+static Residency f_residency;
+
+static const uint32_t MESH_FILE_MAGIC = 0x3148534D; // "MSH1"
+
+static std::string MeshFilePath(uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.mesh", (unsigned long long)key);
+    return std::string(RESIDENCY_CACHE_DIRECTORY) + "/" + name;
+}
+
+static size_t StreamBytes(const MeshStreams& streams)
+{
+    size_t vertex = sizeof(Vector3);
+    if (streams.tcoords != nullptr)
+        vertex += sizeof(Vector2);
+    if (streams.normals != nullptr)
+        vertex += sizeof(Vector3);
+    return streams.vertex_count * vertex + streams.index_count * sizeof(uint32_t);
+}
+
+// FNV-1a, as the texture cache keys images
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t bytes)
+{
+    const uint64_t prime = 1099511628211ull;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < bytes; i++)
+        hash = (hash ^ p[i]) * prime;
+    return hash;
+}
+
+static uint64_t HashStreams(const MeshStreams& streams)
+{
+    uint64_t hash = 14695981039346656037ull;
+    uint32_t counts[4] = { (uint32_t)streams.vertex_count, (uint32_t)streams.index_count,
+        streams.tcoords != nullptr, streams.normals != nullptr };
+    hash = HashBytes(hash, counts, sizeof(counts));
+    hash = HashBytes(hash, streams.positions, streams.vertex_count * sizeof(Vector3));
+    if (streams.tcoords != nullptr)
+        hash = HashBytes(hash, streams.tcoords, streams.vertex_count * sizeof(Vector2));
+    if (streams.normals != nullptr)
+        hash = HashBytes(hash, streams.normals, streams.vertex_count * sizeof(Vector3));
+    if (streams.indices != nullptr)
+        hash = HashBytes(hash, streams.indices, streams.index_count * sizeof(uint32_t));
+    return hash ? hash : 1;
+}
+
+// Content-keyed like the texture cache, so an existing file is already correct
+static bool SaveMeshFile(uint64_t key, const MeshStreams& streams)
+{
+    std::string path = MeshFilePath(key);
+    std::error_code error;
+    if (std::filesystem::exists(path, error))
+        return true;
+    std::filesystem::create_directories(RESIDENCY_CACHE_DIRECTORY, error);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        printf("Warning: failed to write mesh cache %s\n", path.c_str());
+        return false;
+    }
+
+    uint32_t header[5] = { MESH_FILE_MAGIC, (uint32_t)streams.vertex_count, (uint32_t)streams.index_count,
+        streams.tcoords != nullptr, streams.normals != nullptr };
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(streams.positions, sizeof(Vector3), streams.vertex_count, file) == (size_t)streams.vertex_count;
+    if (streams.tcoords != nullptr)
+        ok = ok && fwrite(streams.tcoords, sizeof(Vector2), streams.vertex_count, file) == (size_t)streams.vertex_count;
+    if (streams.normals != nullptr)
+        ok = ok && fwrite(streams.normals, sizeof(Vector3), streams.vertex_count, file) == (size_t)streams.vertex_count;
+    if (streams.indices != nullptr)
+        ok = ok && fwrite(streams.indices, sizeof(uint32_t), streams.index_count, file) == (size_t)streams.index_count;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok)
+    {
+        printf("Warning: failed to write mesh cache %s\n", path.c_str());
+        std::filesystem::remove(path, error);
+    }
+    return ok;
+}
+
+// Into f_residency's scratch vectors
+static bool LoadMeshFile(uint64_t key, MeshStreams* streams)
+{
+    std::string path = MeshFilePath(key);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    uint32_t header[5];
+    bool ok = fread(header, sizeof(header), 1, file) == 1 && header[0] == MESH_FILE_MAGIC && header[1] > 0;
+    if (ok)
+    {
+        Residency& r = f_residency;
+        r.positions.resize(header[1]);
+        r.tcoords.resize(header[3] ? header[1] : 0);
+        r.normals.resize(header[4] ? header[1] : 0);
+        r.indices.resize(header[2]);
+        ok = fread(r.positions.data(), sizeof(Vector3), r.positions.size(), file) == r.positions.size() &&
+            fread(r.tcoords.data(), sizeof(Vector2), r.tcoords.size(), file) == r.tcoords.size() &&
+            fread(r.normals.data(), sizeof(Vector3), r.normals.size(), file) == r.normals.size() &&
+            fread(r.indices.data(), sizeof(uint32_t), r.indices.size(), file) == r.indices.size();
+
+        streams->positions = r.positions.data();
+        streams->tcoords = r.tcoords.empty() ? nullptr : r.tcoords.data();
+        streams->normals = r.normals.empty() ? nullptr : r.normals.data();
+        streams->indices = r.indices.empty() ? nullptr : r.indices.data();
+        streams->vertex_count = (int)header[1];
+        streams->index_count = (int)header[2];
+    }
+
+    fclose(file);
+    if (!ok)
+        printf("Warning: ignoring corrupt mesh cache %s\n", path.c_str());
+    return ok;
+}
+
+// Estimate for uncompressed formats: 4 bytes per texel
+static size_t TextureBytes(const Texture& texture)
+{
+    size_t bytes = 0;
+    for (int level = 0; level < texture.levels; level++)
+    {
+        int width = std::max(texture.width >> level, 1);
+        int height = std::max(texture.height >> level, 1);
+        switch (texture.format)
+        {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            bytes += CompressedSize(BLOCK_FORMAT_BC1, width, height);
+            break;
+
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+            bytes += CompressedSize(BLOCK_FORMAT_BC7, width, height);
+            break;
+
+        default:
+            bytes += (size_t)width * height * 4;
+            break;
+        }
+    }
+    return bytes * texture.layers;
+}
+
+static int AddEntry()
+{
+    Residency& r = f_residency;
+    int index = (int)r.entries.size();
+    if (!r.free_entries.empty())
+    {
+        index = r.free_entries.back();
+        r.free_entries.pop_back();
+    }
+    else
+    {
+        r.entries.emplace_back();
+    }
+
+    ResidentEntry& entry = r.entries[index];
+    entry = ResidentEntry();
+    entry.alive = true;
+    entry.last_used = r.frame;
+    return index;
+}
+
+static void RemoveEntry(int index)
+{
+    f_residency.entries[index].alive = false;
+    f_residency.free_entries.push_back(index);
+}
+
+void CreateResidency(size_t gpu_budget, bool drop_cpu_copies)
+{
+    f_residency.budget = gpu_budget;
+    f_residency.drop_cpu_copies = drop_cpu_copies;
+    f_residency.frame = 1;
+    f_residency.stats = ResidencyStats();
+}
+
+void DestroyResidency()
+{
+    Residency& r = f_residency;
+    for (GLuint id : r.retired)
+        glDeleteTextures(1, &id);
+
+    // Whatever is still tracked stays valid for its owner to unload: evicted meshes just have empty buffers
+    r.entries.clear();
+    r.free_entries.clear();
+    r.meshes.clear();
+    r.textures.clear();
+    r.retired.clear();
+    r.positions = std::vector<Vector3>();
+    r.tcoords = std::vector<Vector2>();
+    r.normals = std::vector<Vector3>();
+    r.indices = std::vector<uint32_t>();
+}
+
+void SetResidencyBudget(size_t gpu_budget)
+{
+    f_residency.budget = gpu_budget;
+}
+
+void TrackMesh(Mesh* mesh)
+{
+    Residency& r = f_residency;
+    if (mesh->vao == GL_NONE || r.meshes.count(mesh->vao) > 0)
+        return;
+
+    Mesh* owner = MeshOwner(mesh);
+    MeshStreams streams = MeshGeometry(*mesh);
+    int index = AddEntry();
+    ResidentEntry& entry = r.entries[index];
+    entry.mesh = owner;
+    entry.handle = mesh->vao;
+    entry.gpu_bytes = StreamBytes(streams);
+
+    if (owner->positions.empty())
+    {
+        // Baked (static storage), or a mesh whose CPU copy was freed before tracking: only the former can come back
+        entry.baked = streams;
+        entry.evictable = streams.vertex_count > 0;
+    }
+    else if (r.drop_cpu_copies)
+    {
+        entry.file_key = HashStreams(streams);
+        entry.evictable = SaveMeshFile(entry.file_key, streams);
+        if (entry.evictable)
+            ReleaseMeshGeometry(mesh);
+        else
+            entry.cpu_bytes = StreamBytes(streams);
+    }
+    else
+    {
+        entry.cpu_bytes = StreamBytes(streams);
+        entry.evictable = true;
+    }
+    r.meshes[entry.handle] = index;
+}
+
+void TrackTexture(Texture* texture)
+{
+    Residency& r = f_residency;
+    if (texture->id == GL_NONE || r.textures.count(texture->id) > 0)
+        return;
+
+    int index = AddEntry();
+    ResidentEntry& entry = r.entries[index];
+    entry.texture = texture;
+    entry.handle = texture->id;
+    entry.gpu_bytes = TextureBytes(*texture);
+    entry.evictable = texture->cache_key != 0 && texture->target == GL_TEXTURE_2D;
+    r.textures[entry.handle] = index;
+}
+
+void UntrackMesh(const Mesh& mesh)
+{
+    auto it = f_residency.meshes.find(mesh.vao);
+    if (it == f_residency.meshes.end())
+        return;
+
+    RemoveEntry(it->second);
+    f_residency.meshes.erase(it);
+}
+
+void UntrackTexture(const Texture& texture)
+{
+    Residency& r = f_residency;
+    auto it = r.textures.find(texture.id);
+    if (it == r.textures.end())
+        return;
+
+    // A placeholder replaced this frame may still map here; it's deleted with the other retired ones
+    int index = it->second;
+    for (auto alias = r.textures.begin(); alias != r.textures.end();)
+        alias = alias->second == index ? r.textures.erase(alias) : std::next(alias);
+    RemoveEntry(index);
+}
+
+// Frees the buffers' storage, keeping their names (so the VAO & every copy of the handles stay valid)
+static void EvictMesh(ResidentEntry* entry)
+{
+    GLuint buffers[4] = { entry->mesh->pbo, entry->mesh->tbo, entry->mesh->nbo, entry->mesh->ibo };
+    for (GLuint buffer : buffers)
+    {
+        if (buffer == GL_NONE)
+            continue;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
+}
+
+static bool RestoreMesh(ResidentEntry* entry)
+{
+    MeshStreams streams = entry->baked;
+    if (streams.vertex_count == 0)
+    {
+        streams = MeshGeometry(*entry->mesh);
+        if (streams.vertex_count == 0 && !LoadMeshFile(entry->file_key, &streams))
+            return false;
+    }
+
+    // Same layout UploadMesh created the buffers with
+    const Mesh& mesh = *entry->mesh;
+    struct { GLuint buffer; const void* data; size_t bytes; } uploads[4] = {
+        { mesh.pbo, streams.positions, streams.vertex_count * sizeof(Vector3) },
+        { mesh.tbo, streams.tcoords, streams.vertex_count * sizeof(Vector2) },
+        { mesh.nbo, streams.normals, streams.vertex_count * sizeof(Vector3) },
+        { mesh.ibo, streams.indices, streams.index_count * sizeof(uint32_t) }
+    };
+    for (const auto& upload : uploads)
+    {
+        if (upload.buffer == GL_NONE)
+            continue;
+        if (upload.data == nullptr)
+            return false;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, upload.buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, upload.bytes, upload.data, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
+    return true;
+}
+
+// Swaps the texture for a 1x1 grey placeholder, so its id never names a deleted texture
+static void EvictTexture(int index)
+{
+    Residency& r = f_residency;
+    ResidentEntry& entry = r.entries[index];
+    Texture* texture = entry.texture;
+    r.textures.erase(texture->id);
+    glDeleteTextures(1, &texture->id);
+
+    const uint8_t grey[4] = { 128, 128, 128, 255 };
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+    entry.handle = texture->id;
+    r.textures[entry.handle] = index;
+}
+
+static bool RestoreTexture(int index)
+{
+    Residency& r = f_residency;
+    ResidentEntry& entry = r.entries[index];
+    GLuint placeholder = entry.texture->id;
+    if (!ReloadTextureCompressed(entry.texture))
+        return false;
+
+    // The placeholder keeps mapping here until the end of the frame
+    r.retired.push_back(placeholder);
+    entry.handle = entry.texture->id;
+    r.textures[entry.handle] = index;
+    return true;
+}
+
+static bool Restore(int index, bool is_mesh)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    Residency& r = f_residency;
+    auto begin = Clock::now();
+    bool ok = is_mesh ? RestoreMesh(&r.entries[index]) : RestoreTexture(index);
+    r.restream_ms += std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+    ResidentEntry& entry = r.entries[index];
+    if (!ok)
+    {
+        // Keeps failing (and warning) on every use rather than drawing garbage
+        r.stats.restream_failures++;
+        printf("Warning: failed to re-stream evicted %s %u\n", is_mesh ? "mesh" : "texture", entry.handle);
+        return false;
+    }
+
+    entry.resident = true;
+    r.stats.restreams++;
+    return true;
+}
+
+bool UseResidentMesh(GLuint vao)
+{
+    Residency& r = f_residency;
+    if (r.meshes.empty())
+        return true;
+
+    auto it = r.meshes.find(vao);
+    if (it == r.meshes.end())
+        return true;
+
+    ResidentEntry& entry = r.entries[it->second];
+    entry.last_used = r.frame;
+    return entry.resident || Restore(it->second, true);
+}
+
+GLuint UseResidentTexture(GLuint texture)
+{
+    Residency& r = f_residency;
+    if (r.textures.empty())
+        return texture;
+
+    auto it = r.textures.find(texture);
+    if (it == r.textures.end())
+        return texture;
+
+    ResidentEntry& entry = r.entries[it->second];
+    entry.last_used = r.frame;
+    if (!entry.resident)
+        Restore(it->second, false);
+    return entry.texture->id;
+}
+
+void UpdateResidency()
+{
+    Residency& r = f_residency;
+    for (GLuint id : r.retired)
+    {
+        r.textures.erase(id);
+        glDeleteTextures(1, &id);
+    }
+    r.retired.clear();
+
+    size_t gpu_bytes = 0;
+    r.candidates.clear();
+    for (int i = 0; i < (int)r.entries.size(); i++)
+    {
+        const ResidentEntry& entry = r.entries[i];
+        if (!entry.alive || !entry.resident)
+            continue;
+        gpu_bytes += entry.gpu_bytes;
+        if (entry.evictable && entry.last_used < r.frame)
+            r.candidates.push_back(i);
+    }
+
+    // Least recently drawn first; anything drawn this frame stays even if that leaves the budget exceeded
+    if (gpu_bytes > r.budget)
+    {
+        std::sort(r.candidates.begin(), r.candidates.end(), [&](int a, int b)
+            { return r.entries[a].last_used < r.entries[b].last_used; });
+        for (int i = 0; i < (int)r.candidates.size() && gpu_bytes > r.budget; i++)
+        {
+            ResidentEntry& entry = r.entries[r.candidates[i]];
+            if (entry.mesh != nullptr)
+                EvictMesh(&entry);
+            else
+                EvictTexture(r.candidates[i]);
+            entry.resident = false;
+            gpu_bytes -= entry.gpu_bytes;
+            r.stats.evictions++;
+        }
+    }
+
+    ResidencyStats& stats = r.stats;
+    stats.gpu_budget = r.budget;
+    stats.gpu_bytes = gpu_bytes;
+    stats.cpu_bytes = 0;
+    stats.meshes = stats.textures = stats.evicted = stats.pinned = 0;
+    for (const ResidentEntry& entry : r.entries)
+    {
+        if (!entry.alive)
+            continue;
+        stats.cpu_bytes += entry.cpu_bytes;
+        stats.meshes += entry.mesh != nullptr;
+        stats.textures += entry.texture != nullptr;
+        stats.evicted += !entry.resident;
+        stats.pinned += !entry.evictable;
+    }
+
+    stats.restream_ms = r.restream_ms;
+    r.restream_ms = 0.0;
+    r.frame++;
+}
+
+ResidencyStats GetResidencyStats()
+{
+    return f_residency.stats;
+}
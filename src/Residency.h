@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "Mesh.h"
+#include "Texture.h"
+
+// Bounds GPU memory: tracked meshes & textures count their CPU and GPU bytes, and whenever the GPU total is over
+// budget at the end of a frame, the least-recently-drawn ones not used that frame are evicted.
+// Drawing an evicted resource (DrawMesh, a recorded draw, BeginTexture) re-streams it first, so callers never see it:
+// - Meshes keep their buffer & VAO names; only the buffers' storage is freed, so handles held elsewhere (copies of
+//   shared meshes, recorded draws) stay valid. Geometry comes back from the CPU copy, baked static data or, once the
+//   CPU copy is dropped, a binary file in the cache directory.
+// - Compressed textures come back from the texture cache (keyed by Texture::cache_key). While evicted, the texture's
+//   id is a 1x1 grey placeholder; re-streaming gives it a new id. Other textures are counted but never evicted.
+
+// Mesh files are written next to the compressed texture levels
+#define RESIDENCY_CACHE_DIRECTORY TEXTURE_CACHE_DIRECTORY
+
+struct ResidencyStats
+{
+	size_t gpu_budget = 0;
+	size_t gpu_bytes = 0;		// Resident tracked resources
+	size_t cpu_bytes = 0;		// CPU copies still held (baked static geometry doesn't count)
+	int meshes = 0;
+	int textures = 0;
+	int evicted = 0;			// Tracked resources not resident right now
+	int pinned = 0;				// Tracked but can't be evicted (no cache entry to come back from)
+	uint64_t evictions = 0;		// Totals
+	uint64_t restreams = 0;
+	uint64_t restream_failures = 0;
+	double restream_ms = 0.0;	// Spent re-streaming during the last frame
+};
+
+// drop_cpu_copies frees each mesh's CPU streams once it's tracked (written to the cache first), after which
+// MeshGeometry returns empty streams for it: add shadow casters etc. before tracking
+void CreateResidency(size_t gpu_budget, bool drop_cpu_copies = false);
+void DestroyResidency();
+
+void SetResidencyBudget(size_t gpu_budget);
+
+// Shared meshes track their cache entry, once however many meshes reference it.
+// Unload untracks automatically (UnloadMesh, UnloadTexture).
+void TrackMesh(Mesh* mesh);
+void TrackTexture(Texture* texture);
+void UntrackMesh(const Mesh& mesh);
+void UntrackTexture(const Texture& texture);
+
+// GL thread, right before binding: touches the LRU and re-streams if evicted.
+// Returns false if the mesh couldn't be restored (the draw must be skipped).
+bool UseResidentMesh(GLuint vao);
+GLuint UseResidentTexture(GLuint texture);		// The id to bind
+
+// Once per frame after the frame's draws: evicts down to budget and retires replaced placeholders
+void UpdateResidency();
+
+ResidencyStats GetResidencyStats();
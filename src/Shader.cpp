@@ -7,9 +7,25 @@
 
 static GLuint f_shader = GL_NONE;
 
+static const char* f_feature_defines[SHADER_FEATURE_COUNT] =
+{
+    "#define COLOR_POSITION\n",
+    "#define COLOR_TCOORD\n",
+    "#define COLOR_NORMAL\n",
+    "#define COLOR_TEXTURE\n",
+    "#define COLOR_ATLAS\n",
+    "#define LIGHTING\n",
+    "#define SHADOWS\n"
+};
+
 int GetUniformLocation(GLuint shader, const char* name);
 
 GLuint CreateShader(GLint type, const char* path)
+{
+    return CreateShader(type, path, ShaderKey{});
+}
+
+GLuint CreateShader(GLint type, const char* path, ShaderKey key)
 {
     GLuint shader = 0;
     try
@@ -40,11 +56,28 @@ GLuint CreateShader(GLint type, const char* path)
             break;
         }
 
-        // Compile text as a shader
+        // #version must come first, so feature defines go between it and the rest of the source
         std::string str = stream.str();
-        const char* src = str.c_str();
+        std::string version;
+        std::string body = str;
+        if (str.compare(0, 8, "#version") == 0)
+        {
+            size_t eol = str.find('\n');
+            version = str.substr(0, eol == std::string::npos ? str.size() : eol + 1);
+            body = "#line 2\n" + (eol == std::string::npos ? std::string() : str.substr(eol + 1));
+        }
+
+        std::string defines;
+        for (uint32_t i = 0; i < SHADER_FEATURE_COUNT; i++)
+        {
+            if (key.features & (1u << i))
+                defines += f_feature_defines[i];
+        }
+
+        // Compile text as a shader
+        const char* src[3] = { version.c_str(), defines.c_str(), body.c_str() };
         shader = glCreateShader(type);
-        glShaderSource(shader, 1, &src, NULL);
+        glShaderSource(shader, 3, src, NULL);
         glCompileShader(shader);
 
         // Check for compilation errors
@@ -99,6 +132,34 @@ void DestroyProgram(GLuint* handle)
     *handle = GL_NONE;
 }
 
+GLuint LoadShaderVariant(ShaderPermutations* permutations, ShaderKey key)
+{
+    assert(ShaderKeyValid(key.features));
+    GLuint& program = permutations->programs[key.features];
+    if (program != GL_NONE)
+        return program;
+
+    GLuint vs = CreateShader(GL_VERTEX_SHADER, permutations->vs_path, key);
+    GLuint fs = CreateShader(GL_FRAGMENT_SHADER, permutations->fs_path, key);
+    program = CreateProgram(vs, fs);
+
+    // Programs keep their own copy of the compiled stages once linked
+    if (vs != GL_NONE)
+        DestroyShader(&vs);
+    if (fs != GL_NONE)
+        DestroyShader(&fs);
+    return program;
+}
+
+void UnloadShaderPermutations(ShaderPermutations* permutations)
+{
+    for (uint32_t i = 0; i < SHADER_VARIANT_COUNT; i++)
+    {
+        if (permutations->programs[i] != GL_NONE)
+            DestroyProgram(&permutations->programs[i]);
+    }
+}
+
 void BeginShader(GLuint shader)
 {
     assert(f_shader == GL_NONE);
@@ -1,13 +1,75 @@
 #pragma once
+#include <cstdint>
 #include <glad/glad.h>
 #include "raymath.h"
 
+// Feature bits injected into shader source as #defines (see f_feature_defines in Shader.cpp).
+// Each combination compiles to its own program, so shaders never branch on features at runtime.
+enum ShaderFeature : uint32_t
+{
+    SHADER_FEATURE_COLOR_POSITION = 1u << 0,
+    SHADER_FEATURE_COLOR_TCOORD = 1u << 1,
+    SHADER_FEATURE_COLOR_NORMAL = 1u << 2,
+    SHADER_FEATURE_COLOR_TEXTURE = 1u << 3,
+    SHADER_FEATURE_COLOR_ATLAS = 1u << 4,     // u_atlas layer u_layer, tcoords remapped into u_uv_rect
+    SHADER_FEATURE_LIGHTING = 1u << 5,        // Colour lit by the clustered point lights (Lighting.h); needs u_mv & u_normal
+    SHADER_FEATURE_SHADOWS = 1u << 6,         // Adds the shadowed directional light (Shadows.h); needs u_mv & u_normal
+
+    SHADER_FEATURE_COUNT = 7
+};
+
+constexpr uint32_t SHADER_VARIANT_COUNT = 1u << SHADER_FEATURE_COUNT;
+constexpr uint32_t SHADER_FEATURE_COLOR_MASK =
+    SHADER_FEATURE_COLOR_POSITION | SHADER_FEATURE_COLOR_TCOORD | SHADER_FEATURE_COLOR_NORMAL |
+    SHADER_FEATURE_COLOR_TEXTURE | SHADER_FEATURE_COLOR_ATLAS;
+
+struct ShaderKey
+{
+    uint32_t features = 0;
+
+    constexpr bool Has(ShaderFeature feature) const { return (features & feature) != 0; }
+};
+
+constexpr bool ShaderKeyValid(uint32_t features)
+{
+    // Known bits only, and at most one colour source (they're mutually exclusive in the shader)
+    return features < SHADER_VARIANT_COUNT &&
+        (features & SHADER_FEATURE_COLOR_MASK & ((features & SHADER_FEATURE_COLOR_MASK) - 1)) == 0;
+}
+
+// Compile-time variant key. Invalid feature combinations fail to compile rather than to link.
+template<uint32_t Features>
+struct ShaderVariant
+{
+    static_assert(ShaderKeyValid(Features), "Invalid shader feature combination");
+    static constexpr ShaderKey key{ Features };
+};
+
+// One pair of source files + a lazily-filled program per variant key
+struct ShaderPermutations
+{
+    const char* vs_path = nullptr;
+    const char* fs_path = nullptr;
+    GLuint programs[SHADER_VARIANT_COUNT]{};
+};
+
 GLuint CreateShader(GLint type, const char* path);
+GLuint CreateShader(GLint type, const char* path, ShaderKey key);
 void DestroyShader(GLuint* handle);
 
 GLuint CreateProgram(GLuint vs, GLuint fs);
 void DestroyProgram(GLuint* handle);
 
+// Compiles & links the variant on first use, returns the cached program afterwards
+GLuint LoadShaderVariant(ShaderPermutations* permutations, ShaderKey key);
+void UnloadShaderPermutations(ShaderPermutations* permutations);
+
+template<uint32_t Features>
+GLuint LoadShaderVariant(ShaderPermutations* permutations)
+{
+    return LoadShaderVariant(permutations, ShaderVariant<Features>::key);
+}
+
 void BeginShader(GLuint shader);
 void EndShader();
 
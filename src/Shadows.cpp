@@ -0,0 +1,438 @@
+#include "Shadows.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "Window.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Cascade volumes are this much larger than the sphere they must cover, so small camera moves keep the cache
+constexpr float SHADOW_CACHE_MARGIN = 0.25f;
+
+// Depth offset while rendering casters (slope-scaled, then in depth units)
+constexpr float SHADOW_SLOPE_BIAS = 2.0f;
+constexpr float SHADOW_CONSTANT_BIAS = 4.0f;
+
+struct ShadowCaster
+{
+    const Mesh* mesh = nullptr;
+    Matrix world = MatrixIdentity();
+    MeshBounds local;
+    MeshBounds bounds;          // World space
+    bool is_static = false;
+    bool alive = false;
+};
+
+struct ShadowCascade
+{
+    Vector3 origin = Vector3Zeros;  // Light-space centre of the volume the tile covers
+    float extent = 0.0f;            // Half its size on every axis
+    float texel = 0.0f;             // World size of one shadow map texel
+    Matrix light_proj = MatrixIdentity();   // World to the tile's clip space
+    bool fitted = false;
+    bool static_dirty = true;
+    bool dynamic_drawn = false;     // The sampled tile still holds last frame's dynamic casters
+};
+
+// std430 layout of the shader's Shadows block (see vertex_color.frag); matrices column-major as GLSL expects
+struct GpuShadows
+{
+    float16 cascades[SHADOW_MAX_CASCADES];  // View space to atlas uv & depth
+    float splits[4];            // Far view depth of each cascade
+    float texels[4];            // World size of a texel in each cascade
+    float direction[4];         // View space, towards the light
+    float color[4];
+    float params[4];            // Cascade count, atlas texel size in uv
+};
+
+struct ShadowMaps
+{
+    int resolution = 0;
+    int cascade_count = 0;
+    Texture static_atlas;       // Cached static casters
+    Texture atlas;              // Sampled: static copy + dynamic casters
+    GLuint static_fbo = GL_NONE;
+    GLuint fbo = GL_NONE;
+    GLuint program = GL_NONE;
+    GLuint buffer = GL_NONE;
+
+    Vector3 direction = { 0.0f, -1.0f, 0.0f };
+    Vector3 color = Vector3Ones;
+    Matrix light_view = MatrixIdentity();
+    float distance = 50.0f;
+    float lambda = 0.75f;
+
+    ShadowCascade cascades[SHADOW_MAX_CASCADES];
+    std::vector<ShadowCaster> casters;
+    std::vector<int> free_casters;
+
+    ShadowStats stats;
+};
+
+static ShadowMaps f_shadows;
+
+static GLuint CreateDepthFramebuffer(const Texture& depth)
+{
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth.id, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        printf("Shadow atlas framebuffer incomplete\n");
+    glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+    return fbo;
+}
+
+static Matrix LightView(Vector3 direction)
+{
+    Vector3 up = fabsf(direction.y) > 0.99f ? Vector3UnitZ : Vector3UnitY;
+    return MatrixLookAt(Vector3Zeros, direction, up);
+}
+
+// Axis-aligned box around bounds after transform (centre moved, extents through |rotation & scale|)
+static MeshBounds TransformBounds(const MeshBounds& bounds, const Matrix& m)
+{
+    Vector3 centre = (bounds.min + bounds.max) * 0.5f;
+    Vector3 half = (bounds.max - bounds.min) * 0.5f;
+    Vector3 c = Vector3Transform(centre, m);
+    Vector3 e =
+    {
+        fabsf(m.m0) * half.x + fabsf(m.m4) * half.y + fabsf(m.m8) * half.z,
+        fabsf(m.m1) * half.x + fabsf(m.m5) * half.y + fabsf(m.m9) * half.z,
+        fabsf(m.m2) * half.x + fabsf(m.m6) * half.y + fabsf(m.m10) * half.z
+    };
+    return { c - e, c + e };
+}
+
+// Light space looks down -z: anything nearer the light than the volume still casts (depth clamp pancakes it
+// onto the near plane), so only boxes beside or entirely behind it are rejected
+static bool CasterInCascade(const MeshBounds& world_bounds, const ShadowCascade& cascade)
+{
+    if (!cascade.fitted)
+        return true;
+
+    MeshBounds box = TransformBounds(world_bounds, f_shadows.light_view);
+    return box.max.x >= cascade.origin.x - cascade.extent && box.min.x <= cascade.origin.x + cascade.extent &&
+        box.max.y >= cascade.origin.y - cascade.extent && box.min.y <= cascade.origin.y + cascade.extent &&
+        box.max.z >= cascade.origin.z - cascade.extent;
+}
+
+static void InvalidateStatic(const MeshBounds& world_bounds)
+{
+    for (int i = 0; i < f_shadows.cascade_count; i++)
+    {
+        if (CasterInCascade(world_bounds, f_shadows.cascades[i]))
+            f_shadows.cascades[i].static_dirty = true;
+    }
+}
+
+void CreateShadowMaps(int resolution, int cascades)
+{
+    assert(f_shadows.program == GL_NONE && resolution > 0 && cascades >= 2 && cascades <= SHADOW_MAX_CASCADES);
+    f_shadows.resolution = resolution;
+    f_shadows.cascade_count = cascades;
+
+    // 2x2 tiles, one per cascade
+    CreateTextureStorage(&f_shadows.static_atlas, resolution * 2, resolution * 2, 1, GL_DEPTH_COMPONENT32F);
+    CreateTextureStorage(&f_shadows.atlas, resolution * 2, resolution * 2, 1, GL_DEPTH_COMPONENT32F);
+    glBindTexture(GL_TEXTURE_2D, f_shadows.atlas.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+    f_shadows.static_fbo = CreateDepthFramebuffer(f_shadows.static_atlas);
+    f_shadows.fbo = CreateDepthFramebuffer(f_shadows.atlas);
+
+    GLuint vs = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/shadow_depth.vert");
+    GLuint fs = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/shadow_depth.frag");
+    f_shadows.program = CreateProgram(vs, fs);
+    DestroyShader(&vs);
+    DestroyShader(&fs);
+
+    glGenBuffers(1, &f_shadows.buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, f_shadows.buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuShadows), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+
+    f_shadows.light_view = LightView(f_shadows.direction);
+}
+
+void DestroyShadowMaps()
+{
+    glDeleteBuffers(1, &f_shadows.buffer);
+    glDeleteFramebuffers(1, &f_shadows.static_fbo);
+    glDeleteFramebuffers(1, &f_shadows.fbo);
+    UnloadTexture(&f_shadows.static_atlas);
+    UnloadTexture(&f_shadows.atlas);
+    DestroyProgram(&f_shadows.program);
+    f_shadows = ShadowMaps();
+}
+
+void SetShadowLight(Vector3 direction, Vector3 color)
+{
+    direction = Vector3Normalize(direction);
+    f_shadows.color = color;
+    if (direction.x == f_shadows.direction.x && direction.y == f_shadows.direction.y && direction.z == f_shadows.direction.z)
+        return;
+
+    f_shadows.direction = direction;
+    f_shadows.light_view = LightView(direction);
+    for (ShadowCascade& cascade : f_shadows.cascades)
+        cascade.fitted = false;
+}
+
+void SetShadowDistance(float distance)
+{
+    f_shadows.distance = distance;
+}
+
+void SetShadowSplitLambda(float lambda)
+{
+    f_shadows.lambda = lambda;
+}
+
+int AddShadowCaster(const Mesh& mesh, Matrix world, bool is_static)
+{
+    int id = (int)f_shadows.casters.size();
+    if (!f_shadows.free_casters.empty())
+    {
+        id = f_shadows.free_casters.back();
+        f_shadows.free_casters.pop_back();
+    }
+    else
+    {
+        f_shadows.casters.emplace_back();
+    }
+
+    ShadowCaster& caster = f_shadows.casters[id];
+    caster.mesh = &mesh;
+    caster.world = world;
+    caster.local = ComputeMeshBounds(mesh);
+    caster.bounds = TransformBounds(caster.local, world);
+    caster.is_static = is_static;
+    caster.alive = true;
+    if (is_static)
+        InvalidateStatic(caster.bounds);
+    return id;
+}
+
+void SetShadowCasterWorld(int caster, Matrix world)
+{
+    ShadowCaster& c = f_shadows.casters[caster];
+    assert(c.alive);
+    if (memcmp(&c.world, &world, sizeof(Matrix)) == 0)
+        return;
+
+    // Shadows left behind & newly cast both need the static cache redrawn
+    if (c.is_static)
+        InvalidateStatic(c.bounds);
+    c.world = world;
+    c.bounds = TransformBounds(c.local, world);
+    if (c.is_static)
+        InvalidateStatic(c.bounds);
+}
+
+void RemoveShadowCaster(int caster)
+{
+    ShadowCaster& c = f_shadows.casters[caster];
+    assert(c.alive);
+    if (c.is_static)
+        InvalidateStatic(c.bounds);
+    c = ShadowCaster();
+    f_shadows.free_casters.push_back(caster);
+}
+
+// Re-centres the cascade (texel-snapped) once the sphere around its frustum slice leaves the cached volume
+static void FitCascade(ShadowCascade* cascade, Vector3 centre, float radius)
+{
+    float extent = radius * (1.0f + SHADOW_CACHE_MARGIN);
+    Vector3 light = Vector3Transform(centre, f_shadows.light_view);
+    Vector3 offset = light - cascade->origin;
+    bool inside = cascade->fitted && cascade->extent == extent &&
+        fabsf(offset.x) + radius <= extent && fabsf(offset.y) + radius <= extent && fabsf(offset.z) + radius <= extent;
+    if (inside)
+        return;
+
+    // Snapping keeps texels at fixed world positions, so re-centring doesn't make edges crawl
+    float texel = 2.0f * extent / f_shadows.resolution;
+    cascade->origin.x = floorf(light.x / texel + 0.5f) * texel;
+    cascade->origin.y = floorf(light.y / texel + 0.5f) * texel;
+    cascade->origin.z = floorf(light.z / texel + 0.5f) * texel;
+    cascade->extent = extent;
+    cascade->texel = texel;
+
+    Vector3 o = cascade->origin;
+    Matrix ortho = MatrixOrtho(o.x - extent, o.x + extent, o.y - extent, o.y + extent, -(o.z + extent), -(o.z - extent));
+    cascade->light_proj = f_shadows.light_view * ortho;
+    cascade->fitted = true;
+    cascade->static_dirty = true;
+}
+
+static void DrawCasters(const ShadowCascade& cascade, bool is_static, int* draws)
+{
+    for (const ShadowCaster& caster : f_shadows.casters)
+    {
+        if (!caster.alive || caster.is_static != is_static)
+            continue;
+        if (!CasterInCascade(caster.bounds, cascade))
+        {
+            f_shadows.stats.culled++;
+            continue;
+        }
+
+        SendMat4(caster.world * cascade.light_proj, "u_mvp");
+        DrawMesh(*caster.mesh);
+        (*draws)++;
+    }
+}
+
+static bool CascadeHasDynamic(const ShadowCascade& cascade)
+{
+    for (const ShadowCaster& caster : f_shadows.casters)
+    {
+        if (caster.alive && !caster.is_static && CasterInCascade(caster.bounds, cascade))
+            return true;
+    }
+    return false;
+}
+
+void UpdateShadowMaps(Matrix view, Matrix proj)
+{
+    assert(f_shadows.program != GL_NONE);
+    ShadowStats& stats = f_shadows.stats;
+    int static_rerenders = stats.static_rerenders;
+    stats = ShadowStats();
+    stats.static_rerenders = static_rerenders;
+    stats.cascades = f_shadows.cascade_count;
+    stats.casters = (int)(f_shadows.casters.size() - f_shadows.free_casters.size());
+
+    // Cascades stop at the shadow distance
+    float tan_x, tan_y, near_plane, far_plane;
+    bool perspective = PerspectiveParams(proj, &tan_x, &tan_y, &near_plane, &far_plane);
+    assert(perspective && f_shadows.distance > near_plane);
+    far_plane = std::min(far_plane, f_shadows.distance);
+
+    // Practical split scheme: logarithmic near the camera, blended towards uniform further out
+    int count = f_shadows.cascade_count;
+    float splits[SHADOW_MAX_CASCADES + 1];
+    splits[0] = near_plane;
+    for (int i = 1; i <= count; i++)
+    {
+        float t = i / (float)count;
+        float log_split = near_plane * powf(far_plane / near_plane, t);
+        float uniform_split = near_plane + (far_plane - near_plane) * t;
+        splits[i] = f_shadows.lambda * log_split + (1.0f - f_shadows.lambda) * uniform_split;
+    }
+
+    // Smallest sphere around each slice: its centre lies on the view axis, its radius depends only on the
+    // projection & splits, so rotating the camera never resizes a cascade
+    Matrix inv_view = MatrixInvert(view);
+    float k2 = tan_x * tan_x + tan_y * tan_y;
+    for (int i = 0; i < count; i++)
+    {
+        float d0 = splits[i];
+        float d1 = splits[i + 1];
+        float centre = std::min((d0 + d1) * (1.0f + k2) * 0.5f, d1);
+        float radius = sqrtf((d1 - centre) * (d1 - centre) + k2 * d1 * d1);
+        FitCascade(&f_shadows.cascades[i], Vector3Transform({ 0.0f, 0.0f, -centre }, inv_view), radius);
+    }
+
+    GLboolean cull_face = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(SHADOW_SLOPE_BIAS, SHADOW_CONSTANT_BIAS);
+    glEnable(GL_SCISSOR_TEST);
+
+    BeginShader(f_shadows.program);
+    int size = f_shadows.resolution;
+    for (int i = 0; i < count; i++)
+    {
+        ShadowCascade& cascade = f_shadows.cascades[i];
+        int x = (i & 1) * size;
+        int y = (i >> 1) * size;
+        glViewport(x, y, size, size);
+        glScissor(x, y, size, size);
+
+        bool rebuilt = cascade.static_dirty;
+        if (cascade.static_dirty)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, f_shadows.static_fbo);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            DrawCasters(cascade, true, &stats.static_draws);
+            cascade.static_dirty = false;
+            stats.static_tiles++;
+            stats.static_rerenders++;
+        }
+
+        // Untouched static tiles with no dynamic casters (now or last frame) are already in the sampled atlas
+        bool has_dynamic = CascadeHasDynamic(cascade);
+        if (!rebuilt && !has_dynamic && !cascade.dynamic_drawn)
+            continue;
+
+        glCopyImageSubData(f_shadows.static_atlas.id, GL_TEXTURE_2D, 0, x, y, 0,
+            f_shadows.atlas.id, GL_TEXTURE_2D, 0, x, y, 0, size, size, 1);
+        if (has_dynamic)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, f_shadows.fbo);
+            DrawCasters(cascade, false, &stats.dynamic_draws);
+        }
+        cascade.dynamic_drawn = has_dynamic;
+        stats.composed_tiles++;
+    }
+    EndShader();
+
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+    if (cull_face)
+        glEnable(GL_CULL_FACE);
+    glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+    glViewport(0, 0, WindowWidth(), WindowHeight());
+
+    // Receivers go from view space: inverse view, light view & ortho, then NDC into their tile of the atlas
+    GpuShadows gpu{};
+    for (int i = 0; i < count; i++)
+    {
+        const ShadowCascade& cascade = f_shadows.cascades[i];
+        Matrix tile = MatrixScale(0.25f, 0.25f, 0.5f) * MatrixTranslate(0.25f + (i & 1) * 0.5f, 0.25f + (i >> 1) * 0.5f, 0.5f);
+        gpu.cascades[i] = MatrixToFloatV(inv_view * cascade.light_proj * tile);
+        gpu.splits[i] = splits[i + 1];
+        gpu.texels[i] = cascade.texel;
+    }
+    Vector3 direction = Vector3Transform(Vector3Negate(f_shadows.direction), view) - Vector3Transform(Vector3Zeros, view);
+    gpu.direction[0] = direction.x;
+    gpu.direction[1] = direction.y;
+    gpu.direction[2] = direction.z;
+    gpu.color[0] = f_shadows.color.x;
+    gpu.color[1] = f_shadows.color.y;
+    gpu.color[2] = f_shadows.color.z;
+    gpu.params[0] = (float)count;
+    gpu.params[1] = 1.0f / f_shadows.atlas.width;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, f_shadows.buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuShadows), &gpu, GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+}
+
+void BindShadowMaps()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, f_shadows.buffer);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, f_shadows.atlas.id);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+ShadowStats GetShadowStats()
+{
+    return f_shadows.stats;
+}
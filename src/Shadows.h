@@ -0,0 +1,52 @@
+#pragma once
+#include <glad/glad.h>
+#include "raymath.h"
+#include "Mesh.h"
+
+// Cascaded shadow maps for one directional light. The camera frustum (up to the shadow distance) is split into
+// 2-4 cascades, each an orthographic tile of a 2x2 depth atlas. A cascade covers a bounding sphere of its slice,
+// so its size never changes as the camera turns, plus a margin: it only re-centres (texel-snapped) once the
+// camera leaves it. Static casters are rendered into a cached atlas that a cascade re-renders only when it
+// re-centres, the light changes or a static caster inside it moves; each frame the cached tile is copied into
+// the sampled atlas and only dynamic casters are drawn on top. Casters are culled per cascade by their mesh bounds.
+
+constexpr int SHADOW_MAX_CASCADES = 4;
+
+struct ShadowStats
+{
+	int cascades = 0;
+	int casters = 0;
+	int static_tiles = 0;		// Cascades whose cached static shadows were re-rendered this frame
+	int static_draws = 0;
+	int dynamic_draws = 0;
+	int culled = 0;				// Caster-cascade pairs rejected by bounds
+	int composed_tiles = 0;		// Cascades whose sampled tile was rebuilt this frame
+	int static_rerenders = 0;	// Cached tiles re-rendered since creation
+};
+
+// resolution is per cascade tile; the atlases are twice that on each side
+void CreateShadowMaps(int resolution = 1024, int cascades = 4);
+void DestroyShadowMaps();
+
+// direction points from the light into the scene. Changing it invalidates every cached cascade.
+void SetShadowLight(Vector3 direction, Vector3 color);
+
+// Cascades end at this view depth (clamped to the projection's far plane)
+void SetShadowDistance(float distance);
+
+// Blend between logarithmic (1) and uniform (0) cascade splits
+void SetShadowSplitLambda(float lambda);
+
+// mesh must outlive the caster. Moving a static caster re-renders the cascades it left & entered.
+int AddShadowCaster(const Mesh& mesh, Matrix world, bool is_static);
+void SetShadowCasterWorld(int caster, Matrix world);
+void RemoveShadowCaster(int caster);
+
+// Main thread, once per frame before the shadowed draws: fits the cascades to the camera and renders what changed.
+// proj must be a symmetric perspective (MatrixPerspective). Leaves the default framebuffer bound.
+void UpdateShadowMaps(Matrix view, Matrix proj);
+
+// Binds the atlas (texture unit 1) & cascade data (storage buffer binding 3) for the shadowed draws that follow
+void BindShadowMaps();
+
+ShadowStats GetShadowStats();
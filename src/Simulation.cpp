@@ -0,0 +1,228 @@
+#include "Simulation.h"
+#include "Timing.h"
+#include "Jobs.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+// Behind by more than this many ticks (a debugger break, a stalled machine), the clock jumps forward instead of catching up
+constexpr int SIM_MAX_CATCH_UP = 5;
+
+// Set in the triple buffer's shared index when it holds a snapshot the reader hasn't seen
+constexpr int SIM_FRESH = 4;
+
+struct Simulation
+{
+    Scene* scene = nullptr;
+    SimulationTick tick = nullptr;
+    void* data = nullptr;
+    double dt = 0.0;
+
+    std::thread thread;
+    std::atomic<bool> quit{ false };
+
+    // Triple buffer: the writer fills back, the reader owns front, and they trade through shared
+    SimSnapshot snapshots[3];
+    int back = 0;
+    std::atomic<int> shared{ 1 };
+    int front = 2;
+    std::vector<Matrix> last;   // Previous tick's worlds by id (writer only)
+
+    std::mutex input_mutex;
+    SimInput input;             // Pending; the mouse delta resets when a tick takes it
+
+    std::atomic<uint64_t> ticks{ 0 };
+    std::atomic<uint64_t> skipped{ 0 };
+    std::atomic<double> tick_seconds{ 0.0 };
+};
+
+static Simulation f_sim;
+
+// Returns whether anything moved since the previous tick
+static bool Publish(uint64_t tick, double time)
+{
+    const Scene& scene = *f_sim.scene;
+    SimSnapshot& snapshot = f_sim.snapshots[f_sim.back];
+    size_t count = scene.ids.size();
+
+    // assign/resize keep their capacity, so a steady node count never allocates
+    snapshot.tick = tick;
+    snapshot.time = time;
+    snapshot.current.resize(count);
+    for (size_t id = 0; id < count; id++)
+        snapshot.current[id] = scene.worlds[scene.slots[id]];
+
+    // Nodes added this tick have no history; they start at rest
+    size_t known = f_sim.last.size();
+    f_sim.last.resize(count);
+    for (size_t id = known; id < count; id++)
+        f_sim.last[id] = snapshot.current[id];
+    snapshot.previous.assign(f_sim.last.begin(), f_sim.last.end());
+    f_sim.last.assign(snapshot.current.begin(), snapshot.current.end());
+    bool moved = memcmp(snapshot.previous.data(), snapshot.current.data(), count * sizeof(Matrix)) != 0;
+
+    f_sim.back = f_sim.shared.exchange(f_sim.back | SIM_FRESH, std::memory_order_acq_rel) & ~SIM_FRESH;
+    return moved;
+}
+
+static void SimulationMain()
+{
+    // Scene updates spread over the workers instead of starting threads every tick
+    JoinJobSystem();
+    SimInput input;
+    FixedTimestep timestep;
+    timestep.step = f_sim.dt;
+    timestep.max_steps = SIM_MAX_CATCH_UP;
+    double last = TimeSeconds();
+    uint64_t tick = 0;
+    bool moved = false;
+
+    while (!f_sim.quit.load(std::memory_order_acquire))
+    {
+        double now = TimeSeconds();
+        double owed = timestep.accumulator + (now - last);
+        int steps = AdvanceFixedTimestep(&timestep, now - last);
+        last = now;
+        if (steps == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(timestep.step - timestep.accumulator));
+            continue;
+        }
+
+        // Past the catch-up limit the rest is dropped: the clock jumps forward
+        uint64_t due = (uint64_t)(owed / timestep.step);
+        if (due > (uint64_t)steps)
+            f_sim.skipped.fetch_add(due - steps, std::memory_order_relaxed);
+
+        for (int step = 0; step < steps; step++)
+        {
+            {
+                std::lock_guard<std::mutex> lock(f_sim.input_mutex);
+                input = f_sim.input;
+                f_sim.input.mouse_delta = Vector2Zeros;
+            }
+
+            double begin = TimeSeconds();
+            f_sim.tick(f_sim.data, f_sim.scene, input, (float)timestep.step);
+            UpdateScene(f_sim.scene);
+            bool was_moving = moved;
+
+            // Scheduled time: the leftover accumulator is how far now is past the last of this batch
+            double time = now - timestep.accumulator - (steps - 1 - step) * timestep.step;
+            moved = Publish(++tick, time);
+            double cost = TimeSeconds() - begin;
+
+            // One more frame after motion stops, so the interpolation lands on the final pose
+            if (moved || was_moving)
+                RequestRedraw();
+
+            // Running average over roughly the last second
+            double average = f_sim.tick_seconds.load(std::memory_order_relaxed);
+            f_sim.tick_seconds.store(average + (cost - average) * f_sim.dt, std::memory_order_relaxed);
+            f_sim.ticks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    LeaveJobSystem();
+}
+
+void CreateSimulation(Scene* scene, SimulationTick tick, void* data, int ticks_per_second)
+{
+    assert(f_sim.scene == nullptr && scene != nullptr && tick != nullptr && ticks_per_second > 0);
+    f_sim.scene = scene;
+    f_sim.tick = tick;
+    f_sim.data = data;
+    f_sim.dt = 1.0 / ticks_per_second;
+    f_sim.back = 0;
+    f_sim.shared = 1;
+    f_sim.front = 2;
+    f_sim.input = SimInput();
+    f_sim.ticks = 0;
+    f_sim.skipped = 0;
+    f_sim.quit = false;
+
+    UpdateScene(scene);
+    Publish(0, TimeSeconds());
+    f_sim.thread = std::thread(SimulationMain);
+}
+
+void DestroySimulation()
+{
+    f_sim.quit.store(true, std::memory_order_release);
+    f_sim.thread.join();
+    for (SimSnapshot& snapshot : f_sim.snapshots)
+        snapshot = SimSnapshot();
+    f_sim.last.clear();
+    f_sim.scene = nullptr;
+}
+
+void SubmitSimulationInput()
+{
+    Vector2 delta = GetMouseDelta();
+    std::lock_guard<std::mutex> lock(f_sim.input_mutex);
+    for (int key = 0; key < KEY_COUNT; key++)
+        f_sim.input.keys[key] = IsKeyDown(key);
+    f_sim.input.mouse_delta += delta;
+}
+
+SimView AcquireSimulationView()
+{
+    if (f_sim.shared.load(std::memory_order_relaxed) & SIM_FRESH)
+        f_sim.front = f_sim.shared.exchange(f_sim.front, std::memory_order_acq_rel) & ~SIM_FRESH;
+
+    // Rendering one tick in the past keeps the render time between previous and current
+    SimView view;
+    view.snapshot = &f_sim.snapshots[f_sim.front];
+    view.alpha = Clamp((float)((TimeSeconds() - view.snapshot->time) / f_sim.dt), 0.0f, 1.0f);
+    return view;
+}
+
+// Inverse of Scene's LocalMatrix: scale is the length of each basis column
+static void Decompose(const Matrix& m, Vector3* translation, Quaternion* rotation, Vector3* scale)
+{
+    *translation = { m.m12, m.m13, m.m14 };
+    *scale = { Vector3Length({ m.m0, m.m1, m.m2 }), Vector3Length({ m.m4, m.m5, m.m6 }), Vector3Length({ m.m8, m.m9, m.m10 }) };
+
+    Matrix r = MatrixIdentity();
+    r.m0 = m.m0 / scale->x; r.m1 = m.m1 / scale->x; r.m2 = m.m2 / scale->x;
+    r.m4 = m.m4 / scale->y; r.m5 = m.m5 / scale->y; r.m6 = m.m6 / scale->y;
+    r.m8 = m.m8 / scale->z; r.m9 = m.m9 / scale->z; r.m10 = m.m10 / scale->z;
+    *rotation = QuaternionFromMatrix(r);
+}
+
+Matrix SimulationNodeWorld(const SimView& view, int node)
+{
+    const SimSnapshot& snapshot = *view.snapshot;
+    assert(node >= 0 && node < (int)snapshot.current.size());
+    const Matrix& a = snapshot.previous[node];
+    const Matrix& b = snapshot.current[node];
+    if (view.alpha >= 1.0f || memcmp(&a, &b, sizeof(Matrix)) == 0)
+        return b;
+
+    Vector3 ta, tb, sa, sb;
+    Quaternion ra, rb;
+    Decompose(a, &ta, &ra, &sa);
+    Decompose(b, &tb, &rb, &sb);
+
+    Vector3 t = Vector3Lerp(ta, tb, view.alpha);
+    Quaternion r = QuaternionSlerp(ra, rb, view.alpha);
+    Vector3 s = Vector3Lerp(sa, sb, view.alpha);
+
+    Matrix m = QuaternionToMatrix(r);
+    m.m0 *= s.x; m.m1 *= s.x; m.m2 *= s.x;
+    m.m4 *= s.y; m.m5 *= s.y; m.m6 *= s.y;
+    m.m8 *= s.z; m.m9 *= s.z; m.m10 *= s.z;
+    m.m12 = t.x; m.m13 = t.y; m.m14 = t.z;
+    return m;
+}
+
+SimulationStats GetSimulationStats()
+{
+    SimulationStats stats;
+    stats.ticks = f_sim.ticks.load(std::memory_order_relaxed);
+    stats.skipped = f_sim.skipped.load(std::memory_order_relaxed);
+    stats.tick_ms = f_sim.tick_seconds.load(std::memory_order_relaxed) * 1e3;
+    return stats;
+}
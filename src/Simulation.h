@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "raymath.h"
+#include "Scene.h"
+#include "Window.h"
+
+// Fixed-tick simulation on its own thread, decoupled from rendering.
+// Each tick consumes the input gathered since the last one, advances the scene through a user callback,
+// updates it and publishes an immutable snapshot of every node's world matrix through a lock-free triple buffer.
+// The render thread takes the newest snapshot each frame and interpolates between its two ticks,
+// so a slow frame never delays a tick and a fast one still sees smooth motion.
+
+// Input as of the tick (GLFW events stay on the main thread; SubmitSimulationInput forwards them)
+struct SimInput
+{
+	bool keys[KEY_COUNT]{};		// Held
+	Vector2 mouse_delta{};		// Accumulated since the previous tick
+};
+
+// Worlds indexed by node id, as of the snapshot's tick and the tick before it
+struct SimSnapshot
+{
+	uint64_t tick = 0;
+	double time = 0.0;			// Scheduled time of the tick, on TimeSeconds()
+	std::vector<Matrix> previous;
+	std::vector<Matrix> current;
+};
+
+// Snapshot owned by the render thread until the next AcquireSimulationView
+struct SimView
+{
+	const SimSnapshot* snapshot = nullptr;
+	float alpha = 1.0f;			// 0 = previous tick, 1 = current
+};
+
+struct SimulationStats
+{
+	uint64_t ticks = 0;
+	uint64_t skipped = 0;		// Ticks dropped after falling too far behind
+	double tick_ms = 0.0;		// Average tick cost (callback + UpdateScene + publish)
+};
+
+typedef void (*SimulationTick)(void* data, Scene* scene, const SimInput& input, float dt);
+
+// The simulation thread owns scene until DestroySimulation; nothing else may touch it in between.
+// Publishes tick 0 before returning, so a view is available immediately.
+void CreateSimulation(Scene* scene, SimulationTick tick, void* data, int ticks_per_second = 60);
+void DestroySimulation();
+
+// Main thread, once per frame after events are polled
+void SubmitSimulationInput();
+
+// Main thread: swaps in the newest snapshot (if any) and places the render time one tick behind it
+SimView AcquireSimulationView();
+
+// Node's world interpolated between the view's two ticks (translation & scale lerped, rotation slerped)
+Matrix SimulationNodeWorld(const SimView& view, int node);
+
+SimulationStats GetSimulationStats();
@@ -0,0 +1,153 @@
+#include "Texture.h"
+#include "TextureUpload.h"
+#include "Residency.h"
+#include <cassert>
+
+static GLuint f_texture = GL_NONE;
+static GLenum f_target = GL_NONE;
+
+void CreateTextureStorage(Texture* texture, int width, int height, int levels, GLenum format)
+{
+    assert(texture->id == GL_NONE);
+    texture->format = format;
+    texture->width = width;
+    texture->height = height;
+    texture->levels = levels;
+
+    // Immutable storage lets the driver allocate every level up-front & skip completeness checks at draw-time
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glTexStorage2D(GL_TEXTURE_2D, levels, format, width, height);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+}
+
+void LoadTexture(Texture* texture, const Image& image)
+{
+    assert(image.pixels != nullptr);
+
+    std::vector<Image> mips;
+    GenerateMipmaps(image, &mips);
+    CreateTextureStorage(texture, image.width, image.height, (int)mips.size() + 1);
+
+    // Rows are tightly packed RGBA8, so the default unpack alignment of 4 already matches
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+    for (int level = 1; level < texture->levels; level++)
+    {
+        const Image& mip = mips[level - 1];
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mip.width, mip.height, GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels);
+    }
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+    UnloadMipmaps(&mips);
+}
+
+static GLenum BlockFormatGL(BlockFormat format)
+{
+    switch (format)
+    {
+    case BLOCK_FORMAT_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BLOCK_FORMAT_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BLOCK_FORMAT_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:
+        assert(false);
+        return GL_NONE;
+    }
+}
+
+static BlockFormat GLBlockFormat(GLenum format)
+{
+    switch (format)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return BLOCK_FORMAT_BC1;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return BLOCK_FORMAT_BC3;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM: return BLOCK_FORMAT_BC7;
+    default:
+        assert(false);
+        return BLOCK_FORMAT_COUNT;
+    }
+}
+
+static void UploadCompressedLevels(Texture* texture, const std::vector<CompressedImage>& levels)
+{
+    CreateTextureStorage(texture, levels[0].width, levels[0].height, (int)levels.size(), BlockFormatGL(levels[0].format));
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    for (int level = 0; level < texture->levels; level++)
+    {
+        const CompressedImage& data = levels[level];
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, data.width, data.height,
+            texture->format, (GLsizei)data.blocks.size(), data.blocks.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+}
+
+void LoadTextureCompressed(Texture* texture, const Image& image, BlockFormat format)
+{
+    assert(image.pixels != nullptr);
+
+    // Same pixels in a different format or quality must not share a cache entry
+    const BlockQuality quality = BLOCK_QUALITY_NORMAL;
+    uint64_t key = HashImage(image) ^ ((uint64_t)(format + 1) * 0x9E3779B97F4A7C15ull) ^
+        ((uint64_t)(quality + 1) * 0xC2B2AE3D27D4EB4Full);
+    std::vector<CompressedImage> levels;
+    if (!LoadCompressedCache(TEXTURE_CACHE_DIRECTORY, key, format, &levels))
+    {
+        std::vector<Image> mips;
+        GenerateMipmaps(image, &mips);
+
+        levels.resize(mips.size() + 1);
+        CompressImage(image, format, quality, &levels[0]);
+        for (size_t i = 0; i < mips.size(); i++)
+            CompressImage(mips[i], format, quality, &levels[i + 1]);
+
+        UnloadMipmaps(&mips);
+        SaveCompressedCache(TEXTURE_CACHE_DIRECTORY, key, levels);
+    }
+
+    UploadCompressedLevels(texture, levels);
+    texture->cache_key = key;
+}
+
+bool ReloadTextureCompressed(Texture* texture)
+{
+    assert(texture->cache_key != 0 && texture->target == GL_TEXTURE_2D);
+    std::vector<CompressedImage> levels;
+    if (!LoadCompressedCache(TEXTURE_CACHE_DIRECTORY, texture->cache_key, GLBlockFormat(texture->format), &levels) ||
+        levels[0].width != texture->width || levels[0].height != texture->height)
+        return false;
+
+    texture->id = GL_NONE;
+    UploadCompressedLevels(texture, levels);
+    return true;
+}
+
+void UnloadTexture(Texture* texture)
+{
+    UntrackTexture(*texture);
+    CancelTextureUpload(texture->id);
+    glDeleteTextures(1, &texture->id);
+    *texture = {};
+}
+
+void BeginTexture(const Texture& texture)
+{
+    assert(f_texture == GL_NONE);
+    GLuint id = UseResidentTexture(texture.id);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(texture.target, id);
+    f_texture = id;
+    f_target = texture.target;
+}
+
+void EndTexture()
+{
+    assert(f_texture != GL_NONE);
+    glBindTexture(f_target, GL_NONE);
+    f_texture = GL_NONE;
+    f_target = GL_NONE;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/glad.h>
+#include "Image.h"
+#include "BlockCompression.h"
+
+// S3TC isn't core GL, but every desktop driver exposes it (EXT_texture_compression_s3tc)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Compressed levels are cached here, keyed by source pixels + format
+#define TEXTURE_CACHE_DIRECTORY "./assets/cache"
+
+// Immutable (glTexStorage2D/3D) texture with a full mip chain
+struct Texture
+{
+	GLuint id = GL_NONE;
+	GLenum target = GL_TEXTURE_2D;	// GL_TEXTURE_2D_ARRAY for atlases
+	GLenum format = GL_RGBA8;		// Internal format
+	int width = 0;
+	int height = 0;
+	int levels = 0;
+	int layers = 1;
+	uint64_t cache_key = 0;			// Texture cache entry holding every level (0 if not from the cache)
+};
+
+// Allocates immutable storage for levels mips (contents undefined until uploaded)
+void CreateTextureStorage(Texture* texture, int width, int height, int levels, GLenum format = GL_RGBA8);
+
+// Builds the mip chain on the CPU (multithreaded) and uploads every level
+void LoadTexture(Texture* texture, const Image& image);
+
+// Like LoadTexture, but block-compresses every level (4-8x less VRAM & bandwidth).
+// Encoding is skipped when the texture cache already holds this image in this format.
+void LoadTextureCompressed(Texture* texture, const Image& image, BlockFormat format);
+
+// Re-creates a compressed texture from its cache entry (see Residency.h) under a new id.
+// The previous id is the caller's to delete; false (and texture unchanged) if the entry is gone.
+bool ReloadTextureCompressed(Texture* texture);
+void UnloadTexture(Texture* texture);
+
+// Binds to texture unit 0
+void BeginTexture(const Texture& texture);
+void EndTexture();
@@ -0,0 +1,313 @@
+#include "TextureUpload.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+
+// Ring offsets are kept cache-line aligned so memcpy into the mapping stays on aligned stores
+constexpr size_t UPLOAD_ALIGNMENT = 64;
+
+struct UploadJob
+{
+    GLuint texture = GL_NONE;
+    std::vector<Image> levels;  // [0] is the base image, owned by the job until uploaded
+    int level = 0;              // Level currently uploading (counts down to 0)
+    int row = 0;                // Next row to upload within that level
+};
+
+// A range of the ring the GPU may still be reading from
+struct UploadRegion
+{
+    size_t begin = 0;
+    size_t end = 0;
+    GLsync fence = nullptr;
+};
+
+struct TextureUploads
+{
+    GLuint pbo = GL_NONE;
+    uint8_t* mapped = nullptr;  // Persistent mapping, nullptr when falling back to per-upload maps
+    size_t size = 0;
+    size_t head = 0;
+    size_t budget = 0;
+
+    std::deque<UploadRegion> in_flight;
+    std::deque<UploadJob> jobs;
+    TextureUploadStats stats;
+};
+
+static TextureUploads f_uploads;
+
+void CreateTextureUploads(size_t ring_bytes, size_t frame_budget)
+{
+    assert(f_uploads.pbo == GL_NONE);
+    f_uploads.size = ring_bytes;
+    f_uploads.budget = frame_budget;
+    f_uploads.head = 0;
+
+    glGenBuffers(1, &f_uploads.pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, f_uploads.pbo);
+
+    // Persistent + coherent mapping needs GL 4.4, otherwise map each upload unsynchronized (fences still guard reuse)
+    if (GLAD_GL_VERSION_4_4)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, ring_bytes, nullptr, flags);
+        f_uploads.mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ring_bytes, flags));
+    }
+    else
+    {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, ring_bytes, nullptr, GL_STREAM_DRAW);
+        printf("Warning: GL 4.4 unavailable, texture uploads will map the staging ring per upload\n");
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+}
+
+void DestroyTextureUploads()
+{
+    for (UploadJob& job : f_uploads.jobs)
+        UnloadMipmaps(&job.levels);
+    f_uploads.jobs.clear();
+
+    for (UploadRegion& region : f_uploads.in_flight)
+        glDeleteSync(region.fence);
+    f_uploads.in_flight.clear();
+
+    if (f_uploads.mapped != nullptr)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, f_uploads.pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+        f_uploads.mapped = nullptr;
+    }
+
+    glDeleteBuffers(1, &f_uploads.pbo);
+    f_uploads.pbo = GL_NONE;
+    f_uploads.stats = {};
+}
+
+void SetTextureUploadBudget(size_t frame_budget)
+{
+    f_uploads.budget = frame_budget;
+}
+
+void LoadTextureAsync(Texture* texture, Image* image)
+{
+    assert(f_uploads.pbo != GL_NONE);
+    assert(image->pixels != nullptr);
+
+    // A whole row must fit in the ring or the upload could never make progress
+    assert((size_t)image->width * sizeof(Color) <= f_uploads.size);
+
+    std::vector<Image> mips;
+    GenerateMipmaps(*image, &mips);
+
+    UploadJob job;
+    job.levels.reserve(mips.size() + 1);
+    job.levels.push_back(*image);
+    job.levels.insert(job.levels.end(), mips.begin(), mips.end());
+    *image = {};
+
+    CreateTextureStorage(texture, job.levels[0].width, job.levels[0].height, (int)job.levels.size());
+    job.texture = texture->id;
+    job.level = texture->levels - 1;
+    job.row = 0;
+
+    // Nothing below the smallest level is valid yet; BASE_LEVEL walks down as levels complete
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.level);
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+    for (const Image& level : job.levels)
+        f_uploads.stats.bytes_pending += (size_t)level.width * level.height * sizeof(Color);
+    f_uploads.jobs.push_back(std::move(job));
+}
+
+void CancelTextureUpload(GLuint texture)
+{
+    for (auto it = f_uploads.jobs.begin(); it != f_uploads.jobs.end();)
+    {
+        if (it->texture != texture)
+        {
+            ++it;
+            continue;
+        }
+
+        for (int level = 0; level <= it->level; level++)
+        {
+            const Image& image = it->levels[level];
+            size_t rows = level == it->level ? image.height - it->row : image.height;
+            f_uploads.stats.bytes_pending -= rows * image.width * sizeof(Color);
+        }
+        UnloadMipmaps(&it->levels);
+        it = f_uploads.jobs.erase(it);
+    }
+}
+
+// Returns how many contiguous bytes (up to want) can be written at *offset without touching in-flight regions
+static size_t ReserveRing(size_t want, size_t* offset)
+{
+    if (f_uploads.in_flight.empty())
+        f_uploads.head = 0;
+
+    size_t head = f_uploads.head;
+    if (f_uploads.in_flight.empty())
+    {
+        *offset = 0;
+        return std::min(want, f_uploads.size);
+    }
+
+    // Everything from tail to head is in flight; head == tail means the ring is full
+    size_t tail = f_uploads.in_flight.front().begin;
+    if (head < tail)
+    {
+        *offset = head;
+        return std::min(want, tail - head);
+    }
+
+    if (head > tail)
+    {
+        size_t to_end = f_uploads.size - head;
+        if (to_end >= want || to_end >= tail)
+        {
+            *offset = head;
+            return std::min(want, to_end);
+        }
+
+        // Wrap: the unused end of the ring is skipped until the in-flight regions behind it retire
+        f_uploads.head = 0;
+        *offset = 0;
+        return std::min(want, tail);
+    }
+
+    return 0;
+}
+
+static void RetireUploads()
+{
+    while (!f_uploads.in_flight.empty())
+    {
+        GLenum status = glClientWaitSync(f_uploads.in_flight.front().fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        glDeleteSync(f_uploads.in_flight.front().fence);
+        f_uploads.in_flight.pop_front();
+    }
+}
+
+void UpdateTextureUploads()
+{
+    RetireUploads();
+    f_uploads.stats.bytes_this_frame = 0;
+    if (f_uploads.jobs.empty())
+    {
+        f_uploads.stats.textures_pending = 0;
+        f_uploads.stats.fences_in_flight = (int)f_uploads.in_flight.size();
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, f_uploads.pbo);
+    size_t budget = f_uploads.budget;
+    while (!f_uploads.jobs.empty())
+    {
+        UploadJob& job = f_uploads.jobs.front();
+        Image& image = job.levels[job.level];
+        size_t row_bytes = (size_t)image.width * sizeof(Color);
+        size_t rows_left = (size_t)(image.height - job.row);
+
+        // Always make progress by at least one row per frame, even if a row exceeds the budget
+        size_t rows = std::min(rows_left, budget / row_bytes);
+        if (rows == 0)
+        {
+            if (f_uploads.stats.bytes_this_frame > 0)
+                break;
+            rows = 1;
+        }
+
+        size_t offset = 0;
+        rows = std::min(rows, ReserveRing(rows * row_bytes, &offset) / row_bytes);
+        if (rows == 0)
+            break;
+
+        size_t bytes = rows * row_bytes;
+        const Color* src = image.pixels + (size_t)job.row * image.width;
+        if (f_uploads.mapped != nullptr)
+        {
+            memcpy(f_uploads.mapped + offset, src, bytes);
+        }
+        else
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+            void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes, flags);
+            memcpy(dst, src, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        // With a pixel-unpack buffer bound, the "pointer" argument is an offset into it
+        glBindTexture(GL_TEXTURE_2D, job.texture);
+        glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, job.row, image.width, (GLsizei)rows,
+            GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offset));
+
+        UploadRegion region;
+        region.begin = offset;
+        region.end = offset + bytes;
+        region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        f_uploads.in_flight.push_back(region);
+        f_uploads.head = std::min(f_uploads.size, (region.end + UPLOAD_ALIGNMENT - 1) & ~(UPLOAD_ALIGNMENT - 1));
+
+        job.row += (int)rows;
+        budget -= std::min(budget, bytes);
+        f_uploads.stats.bytes_this_frame += bytes;
+        f_uploads.stats.bytes_pending -= bytes;
+
+        // Commands execute in order, so the new base level is only sampled after its upload lands
+        if (job.row == image.height)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.level);
+            UnloadImage(&image);
+            job.level--;
+            job.row = 0;
+            if (job.level < 0)
+                f_uploads.jobs.pop_front();
+        }
+        glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+        if (budget == 0)
+            break;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+
+    f_uploads.stats.textures_pending = (int)f_uploads.jobs.size();
+    f_uploads.stats.fences_in_flight = (int)f_uploads.in_flight.size();
+}
+
+void FinishTextureUploads()
+{
+    while (!f_uploads.jobs.empty())
+    {
+        UpdateTextureUploads();
+        if (f_uploads.in_flight.empty())
+            continue;
+
+        GLenum status = glClientWaitSync(f_uploads.in_flight.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            printf("Warning: texture uploads stalled, %i textures still pending\n", (int)f_uploads.jobs.size());
+            break;
+        }
+    }
+    RetireUploads();
+}
+
+bool TextureUploadsPending()
+{
+    return !f_uploads.jobs.empty();
+}
+
+TextureUploadStats GetTextureUploadStats()
+{
+    return f_uploads.stats;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include "Texture.h"
+
+// Streams texture data to the GPU through a ring of pixel-unpack buffer memory.
+// Pixels are copied into the ring and uploaded with glTexSubImage2D from buffer offsets;
+// fences tell us when a region of the ring can be reused, so the CPU never waits on the GPU.
+// Levels are uploaded smallest-first and GL_TEXTURE_BASE_LEVEL follows them,
+// so a streaming texture is always safe to draw (just blurry until it finishes).
+
+struct TextureUploadStats
+{
+	size_t bytes_this_frame = 0;	// Bytes copied into the ring during the last update
+	size_t bytes_pending = 0;		// Bytes queued but not yet copied
+	int textures_pending = 0;
+	int fences_in_flight = 0;
+};
+
+// ring_bytes is the staging memory size, frame_budget caps the bytes uploaded per UpdateTextureUploads()
+void CreateTextureUploads(size_t ring_bytes, size_t frame_budget);
+void DestroyTextureUploads();
+
+void SetTextureUploadBudget(size_t frame_budget);
+
+// Allocates immutable storage immediately and queues every mip level.
+// Takes ownership of image's pixels (image is left empty).
+void LoadTextureAsync(Texture* texture, Image* image);
+
+// Drops queued work for a texture that's about to be destroyed
+void CancelTextureUpload(GLuint texture);
+
+// Call once per frame (on the GL thread) to retire fences and issue uploads up to the budget
+void UpdateTextureUploads();
+
+// Issues every queued upload before returning (loading screens, headless runs). Where the ring is full it waits for
+// the oldest upload, flushing so its fence is submitted; gives up with a warning if the GPU takes over a second.
+void FinishTextureUploads();
+
+bool TextureUploadsPending();
+TextureUploadStats GetTextureUploadStats();
@@ -0,0 +1,184 @@
+#include "Timing.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TIMING_SSE2 1
+#endif
+
+using TimingClock = std::chrono::steady_clock;
+
+static int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(TimingClock::now().time_since_epoch()).count();
+}
+
+constexpr double FRAME_DELTA_MAX = 0.25;
+constexpr double FRAME_DELTA_SMOOTHING = 0.1;
+
+struct FrameClock
+{
+    int64_t epoch = Now();
+    int64_t frame_begin = 0;
+    int64_t frame_index = 0;
+    double delta = 0.0;
+    double smoothed = 0.0;
+
+    int64_t cap_period = 0;         // 0 = uncapped
+    int64_t cap_target = 0;         // Earliest present of the next frame
+    int64_t spin = 2000000;         // 2ms covers Windows' default ~1ms sleep granularity plus scheduling slop
+
+    int64_t pending_input = 0;      // Earliest input dispatched during the current poll
+    int64_t polled_input = 0;       // Earliest input the frame being built has consumed
+
+    double latencies[LATENCY_SAMPLES]{};
+    int latency_count = 0;
+    int latency_next = 0;
+};
+
+static FrameClock f_clock;
+
+int64_t TimeTicks()
+{
+    return Now() - f_clock.epoch;
+}
+
+double TicksToSeconds(int64_t ticks)
+{
+    return ticks * 1e-9;
+}
+
+int64_t SecondsToTicks(double seconds)
+{
+    return (int64_t)(seconds * 1e9);
+}
+
+double TimeSeconds()
+{
+    return TicksToSeconds(TimeTicks());
+}
+
+void SetFrameRateCap(double fps)
+{
+    f_clock.cap_period = fps > 0.0 ? SecondsToTicks(1.0 / fps) : 0;
+    f_clock.cap_target = TimeTicks();
+}
+
+void SetFramePacingSpin(double spin_ms)
+{
+    f_clock.spin = SecondsToTicks(spin_ms * 1e-3);
+}
+
+void PaceFrame()
+{
+    if (f_clock.cap_period == 0)
+        return;
+
+    int64_t now = TimeTicks();
+    int64_t target = f_clock.cap_target;
+    if (target - now > f_clock.spin)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(target - now - f_clock.spin));
+
+    while (TimeTicks() < target)
+    {
+#if TIMING_SSE2
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // Keep a steady cadence, but don't bank time after a slow frame (that would allow a burst of fast ones)
+    now = TimeTicks();
+    f_clock.cap_target = std::max(target + f_clock.cap_period, now);
+}
+
+void MarkPresent()
+{
+    int64_t now = TimeTicks();
+    if (f_clock.polled_input != 0)
+    {
+        f_clock.latencies[f_clock.latency_next] = TicksToSeconds(now - f_clock.polled_input) * 1e3;
+        f_clock.latency_next = (f_clock.latency_next + 1) % LATENCY_SAMPLES;
+        f_clock.latency_count = std::min(f_clock.latency_count + 1, LATENCY_SAMPLES);
+        f_clock.polled_input = 0;
+    }
+
+    double delta = f_clock.frame_index > 0 ? TicksToSeconds(now - f_clock.frame_begin) : 0.0;
+    f_clock.delta = std::min(delta, FRAME_DELTA_MAX);
+    f_clock.smoothed = f_clock.frame_index > 1 ?
+        f_clock.smoothed + (f_clock.delta - f_clock.smoothed) * FRAME_DELTA_SMOOTHING :
+        f_clock.delta;
+    f_clock.frame_begin = now;
+    f_clock.frame_index++;
+}
+
+void MarkInputsPolled()
+{
+    if (f_clock.polled_input == 0)
+        f_clock.polled_input = f_clock.pending_input;
+    f_clock.pending_input = 0;
+}
+
+void MarkInput()
+{
+    if (f_clock.pending_input == 0)
+        f_clock.pending_input = TimeTicks();
+}
+
+double FrameDelta()
+{
+    return f_clock.delta;
+}
+
+double SmoothedFrameDelta()
+{
+    return f_clock.smoothed;
+}
+
+int64_t FrameIndex()
+{
+    return f_clock.frame_index;
+}
+
+int AdvanceFixedTimestep(FixedTimestep* timestep, double delta)
+{
+    timestep->accumulator += delta;
+    int steps = (int)(timestep->accumulator / timestep->step);
+    if (steps > timestep->max_steps)
+    {
+        steps = timestep->max_steps;
+        timestep->accumulator = 0.0;
+    }
+    else
+        timestep->accumulator -= timestep->step * steps;
+    return steps;
+}
+
+float FixedTimestepAlpha(const FixedTimestep& timestep)
+{
+    return (float)(timestep.accumulator / timestep.step);
+}
+
+LatencyStats GetInputLatency()
+{
+    LatencyStats stats;
+    stats.samples = f_clock.latency_count;
+    if (stats.samples == 0)
+        return stats;
+
+    double sorted[LATENCY_SAMPLES];
+    std::copy(f_clock.latencies, f_clock.latencies + stats.samples, sorted);
+    std::sort(sorted, sorted + stats.samples);
+
+    double sum = 0.0;
+    for (int i = 0; i < stats.samples; i++)
+        sum += sorted[i];
+    stats.min_ms = sorted[0];
+    stats.max_ms = sorted[stats.samples - 1];
+    stats.average_ms = sum / stats.samples;
+    stats.p99_ms = sorted[std::min(stats.samples - 1, stats.samples * 99 / 100)];
+    return stats;
+}
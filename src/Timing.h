@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+
+// Frame clock and pacing. Time is kept as int64 nanosecond ticks from a monotonic counter
+// (QueryPerformanceCounter on Windows), so precision doesn't degrade however long the app runs;
+// seconds are only derived as doubles relative to the start of the process.
+
+int64_t TimeTicks();
+double TicksToSeconds(int64_t ticks);
+int64_t SecondsToTicks(double seconds);
+
+// Seconds since the first call into the timing module, usable from any thread
+double TimeSeconds();
+
+// Window.cpp's Loop() drives these; everything else reads the results
+void PaceFrame();				// Before present: sleeps, then spins, until the frame cap allows the next frame
+void MarkPresent();				// After present: closes the frame and records input latency
+void MarkInputsPolled();		// After events are polled: inputs seen so far belong to the next frame
+void MarkInput();				// From input callbacks
+
+// Raw delta is clamped to 250ms so a breakpoint or window drag doesn't produce a huge step
+double FrameDelta();
+double SmoothedFrameDelta();	// Exponential moving average, ~0.1 weight per frame
+int64_t FrameIndex();
+
+// 0 = uncapped (vsync, if any, still applies)
+void SetFrameRateCap(double fps);
+
+// Sleep overshoots by up to the OS timer resolution; the last spin_ms are busy-waited instead
+void SetFramePacingSpin(double spin_ms);
+
+// Fixed-timestep accumulator: feed it each frame's delta, run the returned number of steps,
+// then interpolate rendering by the alpha of the leftover time
+struct FixedTimestep
+{
+	double step = 1.0 / 60.0;
+	double accumulator = 0.0;
+	int max_steps = 8;			// Per frame; the remainder is dropped rather than spiralling
+};
+
+int AdvanceFixedTimestep(FixedTimestep* timestep, double delta);
+float FixedTimestepAlpha(const FixedTimestep& timestep);
+
+// Input-to-present over the last LATENCY_SAMPLES frames that consumed input.
+// Measured from when GLFW dispatches the event (during the poll), so OS queueing before that isn't included.
+constexpr int LATENCY_SAMPLES = 256;
+
+struct LatencyStats
+{
+	int samples = 0;
+	double min_ms = 0.0;
+	double average_ms = 0.0;
+	double p99_ms = 0.0;
+	double max_ms = 0.0;
+};
+
+LatencyStats GetInputLatency();
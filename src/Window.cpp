@@ -7,6 +7,9 @@
 #include <imgui/imgui_impl_opengl3.h>
 
 #include "Window.h"
+#include "Timing.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <iostream>
 #include <memory>
@@ -16,11 +19,8 @@ struct App
 	GLFWwindow* window = nullptr;
     int keys_prev[KEY_COUNT]{};
     int keys_curr[KEY_COUNT]{};
-<<<<<<< Updated upstream
-=======
-    float frame_time_begin = 0.0f;
-    float frame_time_end = 0.0f;
-    float frame_time_delta = 0.0f;
+    int buttons_prev[MOUSE_BUTTON_COUNT]{};
+    int buttons_curr[MOUSE_BUTTON_COUNT]{};
 
     double mouse_prev_x = 0.0;
     double mouse_prev_y = 0.0;
@@ -28,11 +28,56 @@ struct App
 
     double mouse_delta_x = 0.0;
     double mouse_delta_y = 0.0;
->>>>>>> Stashed changes
+
+    bool idle = false;
+    double idle_timeout = 0.5;
+    int input_events = 0;       // Since the last Loop()
+    int settle_frames = 0;      // Frames still owed to ImGui after input
+    std::atomic<bool> redraw{ true };
 } g_app;
 
+// ImGui needs a couple of frames after input for hover & active states to catch up
+constexpr int IDLE_SETTLE_FRAMES = 3;
+
+// Any event that can change what's on screen; ImGui chains onto these, so they see its input too
+void WakeCallback(GLFWwindow* window)
+{
+    g_app.input_events++;
+}
+
+void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+    if (button >= 0 && button < MOUSE_BUTTON_COUNT)
+        g_app.buttons_curr[button] = action;
+    MarkInput();
+    g_app.input_events++;
+}
+
+void ScrollCallback(GLFWwindow* window, double x, double y)
+{
+    MarkInput();
+    g_app.input_events++;
+}
+
+void CharCallback(GLFWwindow* window, unsigned int codepoint)
+{
+    g_app.input_events++;
+}
+
+void FocusCallback(GLFWwindow* window, int focused)
+{
+    g_app.input_events++;
+}
+
+void SizeCallback(GLFWwindow* window, int width, int height)
+{
+    g_app.input_events++;
+}
+
 void MousePosCallback(GLFWwindow* window, double xpos, double ypos)
 {
+    MarkInput();
+    g_app.input_events++;
     if (g_app.mouse_first)
     {
         g_app.mouse_prev_x = xpos;
@@ -40,8 +85,9 @@ void MousePosCallback(GLFWwindow* window, double xpos, double ypos)
         g_app.mouse_first = false;
     }
 
-    g_app.mouse_delta_x = xpos - g_app.mouse_prev_x;
-    g_app.mouse_delta_y = ypos - g_app.mouse_prev_y;
+    // Several events can arrive per poll; Loop() clears the sum before polling
+    g_app.mouse_delta_x += xpos - g_app.mouse_prev_x;
+    g_app.mouse_delta_y += ypos - g_app.mouse_prev_y;
 
     g_app.mouse_prev_x = xpos;
     g_app.mouse_prev_y = ypos;
@@ -50,6 +96,8 @@ void MousePosCallback(GLFWwindow* window, double xpos, double ypos)
 void KeyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     if (action == GLFW_REPEAT) return;
+    MarkInput();
+    g_app.input_events++;
     g_app.keys_curr[key] = action;
     
     // Uncomment to see how key events work!
@@ -101,7 +149,7 @@ void APIENTRY DebugCallback(GLenum source, GLenum type, unsigned int id, GLenum
     std::cout << std::endl;
 }
 
-void CreateWindow(int width, int height, const char* title)
+void CreateWindow(int width, int height, const char* title, bool visible)
 {
     /* Initialize the library */
     assert(glfwInit() == GLFW_TRUE);
@@ -117,6 +165,9 @@ void CreateWindow(int width, int height, const char* title)
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
 #endif
 
+    // Hidden windows still get a context & default framebuffer (headless runs like --regression)
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
     /* Create a windowed mode window and its OpenGL context */
     g_app.window = glfwCreateWindow(width, height, title, NULL, NULL);
     assert(g_app.window != nullptr);
@@ -129,6 +180,13 @@ void CreateWindow(int width, int height, const char* title)
 
     glfwSetKeyCallback(g_app.window, KeyboardCallback);
     glfwSetCursorPosCallback(g_app.window, MousePosCallback);
+    glfwSetMouseButtonCallback(g_app.window, MouseButtonCallback);
+    glfwSetScrollCallback(g_app.window, ScrollCallback);
+    glfwSetCharCallback(g_app.window, CharCallback);
+    glfwSetWindowFocusCallback(g_app.window, FocusCallback);
+    glfwSetFramebufferSizeCallback(g_app.window, SizeCallback);
+    glfwSetWindowRefreshCallback(g_app.window, WakeCallback);
+    glfwSetWindowCloseCallback(g_app.window, WakeCallback);
 #ifdef NDEBUG
 #else
     glEnable(GL_DEBUG_OUTPUT);
@@ -169,9 +227,9 @@ bool WindowShouldClose()
     return glfwWindowShouldClose(g_app.window);
 }
 
-float Time()
+double Time()
 {
-    return glfwGetTime();
+    return TimeSeconds();
 }
 
 void Loop()
@@ -179,12 +237,53 @@ void Loop()
     // Last frame escape down
     // This frame escape up
     memcpy(g_app.keys_prev, g_app.keys_curr, sizeof(int) * KEY_COUNT);
+    memcpy(g_app.buttons_prev, g_app.buttons_curr, sizeof(int) * MOUSE_BUTTON_COUNT);
 
     /* Swap front and back buffers */
+    PaceFrame();
     glfwSwapBuffers(g_app.window);
+    MarkPresent();
 
     /* Poll for and process events */
+    g_app.mouse_delta_x = 0.0;
+    g_app.mouse_delta_y = 0.0;
     glfwPollEvents();
+
+    // Idle: block until something can change the picture (input, RequestRedraw, or the timeout as a heartbeat)
+    bool wake = g_app.input_events > 0 || g_app.settle_frames > 0 || g_app.redraw.exchange(false);
+    if (g_app.idle && !wake)
+    {
+        double deadline = Time() + g_app.idle_timeout;
+        double remaining = g_app.idle_timeout;
+        while (!wake && remaining > 0.0)
+        {
+            glfwWaitEventsTimeout(remaining);
+            wake = g_app.input_events > 0 || g_app.redraw.exchange(false);
+            remaining = deadline - Time();
+        }
+    }
+
+    g_app.settle_frames = g_app.input_events > 0 ? IDLE_SETTLE_FRAMES : std::max(g_app.settle_frames - 1, 0);
+    g_app.input_events = 0;
+    MarkInputsPolled();
+}
+
+void SetIdleMode(bool idle, double timeout)
+{
+    g_app.idle = idle;
+    g_app.idle_timeout = timeout;
+}
+
+bool IdleMode()
+{
+    return g_app.idle;
+}
+
+void RequestRedraw()
+{
+    // Wakes glfwWaitEventsTimeout when called from another thread
+    if (!g_app.redraw.exchange(true))
+        glfwPostEmptyEvent();
 }
 
 void BeginGui()
@@ -217,6 +316,18 @@ bool IsKeyPressed(int key)
         g_app.keys_curr[key] == GLFW_RELEASE;
 }
 
+bool IsMouseButtonDown(int button)
+{
+    return g_app.buttons_curr[button] == GLFW_PRESS;
+}
+
+bool IsMouseButtonPressed(int button)
+{
+    return
+        g_app.buttons_prev[button] == GLFW_PRESS &&
+        g_app.buttons_curr[button] == GLFW_RELEASE;
+}
+
 void DestroyWindow()
 {
     ImGui_ImplOpenGL3_Shutdown();
@@ -243,3 +354,8 @@ Vector2 GetMouseDelta()
 {
     return { (float)g_app.mouse_delta_x, (float)g_app.mouse_delta_y };
 }
+
+Vector2 GetMousePosition()
+{
+    return { (float)g_app.mouse_prev_x, (float)g_app.mouse_prev_y };
+}
@@ -1,7 +1,7 @@
 #pragma once
 #include "raymath.h"
 
-void CreateWindow(int width, int height, const char* title);
+void CreateWindow(int width, int height, const char* title, bool visible = true);
 void DestroyWindow();
 
 int WindowWidth();
@@ -10,16 +10,25 @@ int WindowHeight();
 void SetWindowShouldClose(bool close);
 bool WindowShouldClose();
 
-float Time();
+double Time();			// Seconds since startup (see Timing.h for ticks, pacing & latency)
 void Loop();
 
+// Render on demand: Loop() waits for input or a redraw request instead of returning immediately.
+// Input wakes it (plus a few frames for ImGui to settle); timeout bounds the wait as a heartbeat.
+void SetIdleMode(bool idle, double timeout = 0.5);
+bool IdleMode();
+void RequestRedraw();	// Any thread; the next Loop() returns without waiting
+
 void BeginGui();
 void EndGui();
 
 bool IsKeyDown(int key);		// If a key is heald
 bool IsKeyUp(int key);			// If a key is released
 bool IsKeyPressed(int key);		// If a key is pressed (down then up)
-Vector2 GetMouseDelta();
+bool IsMouseButtonDown(int button);		// If a mouse button is held
+bool IsMouseButtonPressed(int button);	// If a mouse button is clicked (down then up)
+Vector2 GetMouseDelta();		// Cursor movement during the last frame
+Vector2 GetMousePosition();		// Cursor in window pixels, top-left origin
 
 
 #define MOUSE_BUTTON_1         0
@@ -30,10 +39,10 @@ Vector2 GetMouseDelta();
 #define MOUSE_BUTTON_6         5
 #define MOUSE_BUTTON_7         6
 #define MOUSE_BUTTON_8         7
-#define MOUSE_BUTTON_LAST      GLFW_MOUSE_BUTTON_8
-#define MOUSE_BUTTON_LEFT      GLFW_MOUSE_BUTTON_1
-#define MOUSE_BUTTON_RIGHT     GLFW_MOUSE_BUTTON_2
-#define MOUSE_BUTTON_MIDDLE    GLFW_MOUSE_BUTTON_3
+#define MOUSE_BUTTON_LAST      MOUSE_BUTTON_8
+#define MOUSE_BUTTON_LEFT      MOUSE_BUTTON_1
+#define MOUSE_BUTTON_RIGHT     MOUSE_BUTTON_2
+#define MOUSE_BUTTON_MIDDLE    MOUSE_BUTTON_3
 #define MOUSE_BUTTON_COUNT     8
 
 /* Printable keys */
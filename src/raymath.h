@@ -1897,6 +1897,19 @@ RMAPI Matrix MatrixPerspective(double fovY, double aspect, double nearPlane, dou
     return result;
 }
 
+// Get the tangents of the half field of view per axis and the clip planes of a MatrixPerspective() matrix
+// NOTE: m0 & m5 are cot(fov/2) per axis, near & far follow from m10 & m14;
+// returns false if the matrix isn't a symmetric perspective projection
+RMAPI bool PerspectiveParams(Matrix proj, float *tanX, float *tanY, float *nearPlane, float *farPlane)
+{
+    *tanX = 1.0f/proj.m0;
+    *tanY = 1.0f/proj.m5;
+    *nearPlane = proj.m14/(proj.m10 - 1.0f);
+    *farPlane = proj.m14/(proj.m10 + 1.0f);
+
+    return (proj.m8 == 0.0f) && (proj.m9 == 0.0f) && (proj.m11 == -1.0f) && (*nearPlane > 0.0f) && (*farPlane > *nearPlane);
+}
+
 // Get orthographic projection matrix
 RMAPI Matrix MatrixOrtho(double left, double right, double bottom, double top, double nearPlane, double farPlane)
 {